@@ -0,0 +1,224 @@
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace peloton {
+namespace index {
+
+/*
+ * class ChainStats - Distribution of collision chain lengths and duplicate
+ *                    keys in a closed addressing table
+ *
+ * This is computed by scanning the table, and is only used for profiling
+ * and tuning the load factor. Histograms have HISTOGRAM_SIZE buckets, and
+ * bucket i counts chains (keys) of length (duplicate count) i, except that
+ * the last bucket also counts everything larger
+ */
+class ChainStats {
+ public:
+  static constexpr uint64_t HISTOGRAM_SIZE = 16;
+
+  uint64_t slot_count;
+
+  // Number of key value pairs
+  uint64_t entry_count;
+
+  // Number of slots without any entry
+  uint64_t empty_slot_count;
+
+  uint64_t max_chain_length;
+
+  // Number of chains indexed by a sorted array; See TreeifyLongChains
+  uint64_t treeified_slot_count;
+
+  // Number of slots indexed by chain length
+  uint64_t chain_histogram[HISTOGRAM_SIZE];
+
+  // Number of distinct keys
+  uint64_t key_count;
+
+  // Maximum number of values of a single key
+  uint64_t max_duplicate_count;
+
+  // Number of keys indexed by the number of values
+  uint64_t duplicate_histogram[HISTOGRAM_SIZE];
+
+  /*
+   * Constructor - Initializes all counters to zero
+   */
+  ChainStats(uint64_t p_slot_count = 0) :
+    slot_count{p_slot_count},
+    entry_count{0},
+    empty_slot_count{0},
+    max_chain_length{0},
+    treeified_slot_count{0},
+    chain_histogram{},
+    key_count{0},
+    max_duplicate_count{0},
+    duplicate_histogram{} {
+    return;
+  }
+
+  /*
+   * AddChain() - Adds one chain with its keys
+   *
+   * The chain is given as a list of (hash value, pointer to key) pairs, and
+   * is reordered by this function. Keys with the same hash value are grouped
+   * by sorting, and only keys in the same group are compared, so the cost is
+   * linear in the number of keys for a good hash function
+   */
+  template <typename KeyType, typename KeyEqualityChecker>
+  void AddChain(std::vector<std::pair<uint64_t, const KeyType *>> *chain_p,
+                const KeyEqualityChecker &key_eq_obj) {
+    uint64_t length = chain_p->size();
+
+    entry_count += length;
+    if(length == 0) {
+      empty_slot_count++;
+    }
+
+    max_chain_length = std::max(max_chain_length, length);
+    chain_histogram[std::min(length, HISTOGRAM_SIZE - 1)]++;
+
+    std::sort(chain_p->begin(),
+              chain_p->end(),
+              [](const std::pair<uint64_t, const KeyType *> &a,
+                 const std::pair<uint64_t, const KeyType *> &b) {
+                return a.first < b.first;
+              });
+
+    // Keys in [start, end) have the same hash value. Keys that have been
+    // counted are moved to the front of the range
+    uint64_t start = 0;
+    while(start < length) {
+      uint64_t end = start + 1;
+      while((end < length) && \
+            ((*chain_p)[end].first == (*chain_p)[start].first)) {
+        end++;
+      }
+
+      while(start < end) {
+        const KeyType &key = *(*chain_p)[start].second;
+        uint64_t duplicate_count = 1;
+
+        for(uint64_t i = start + 1;i < end;i++) {
+          if(key_eq_obj(key, *(*chain_p)[i].second) == true) {
+            std::swap((*chain_p)[start + duplicate_count], (*chain_p)[i]);
+            duplicate_count++;
+          }
+        }
+
+        AddKey(duplicate_count);
+        start += duplicate_count;
+      }
+    }
+
+    return;
+  }
+
+  /*
+   * AddKey() - Adds a distinct key with the number of its values
+   */
+  void AddKey(uint64_t duplicate_count) {
+    key_count++;
+
+    max_duplicate_count = std::max(max_duplicate_count, duplicate_count);
+    duplicate_histogram[std::min(duplicate_count, HISTOGRAM_SIZE - 1)]++;
+
+    return;
+  }
+
+  /*
+   * GetEmptySlotRatio() - Returns the fraction of slots that are empty
+   */
+  double GetEmptySlotRatio() const {
+    if(slot_count == 0) {
+      return 0.0;
+    }
+
+    return static_cast<double>(empty_slot_count) / slot_count;
+  }
+
+  /*
+   * GetMeanChainLength() - Returns the average length of non-empty chains
+   *
+   * This is the average number of entries walked by a lookup of an existing
+   * key if all chains are accessed equally
+   */
+  double GetMeanChainLength() const {
+    uint64_t non_empty_count = slot_count - empty_slot_count;
+    if(non_empty_count == 0) {
+      return 0.0;
+    }
+
+    return static_cast<double>(entry_count) / non_empty_count;
+  }
+
+  /*
+   * GetMeanDuplicateCount() - Returns the average number of values per key
+   */
+  double GetMeanDuplicateCount() const {
+    if(key_count == 0) {
+      return 0.0;
+    }
+
+    return static_cast<double>(entry_count) / key_count;
+  }
+
+  /*
+   * Print() - Prints all statistics to stdout
+   */
+  void Print(const char *name) const {
+    printf("%s: %lu slots; %lu entries; %lu keys\n",
+           name,
+           slot_count,
+           entry_count,
+           key_count);
+    printf("  Chain length: max %lu; mean (non-empty) %.3lf; "
+           "empty slots %.2lf%%; treeified slots %lu\n",
+           max_chain_length,
+           GetMeanChainLength(),
+           GetEmptySlotRatio() * 100.0,
+           treeified_slot_count);
+    printf("  Values per key: max %lu; mean %.3lf\n",
+           max_duplicate_count,
+           GetMeanDuplicateCount());
+
+    PrintHistogram("Chain length histogram", chain_histogram);
+    PrintHistogram("Values per key histogram", duplicate_histogram);
+
+    return;
+  }
+
+ private:
+
+  /*
+   * PrintHistogram() - Prints non-zero buckets of a histogram
+   */
+  static void PrintHistogram(const char *title, const uint64_t *histogram) {
+    printf("  %s:", title);
+
+    for(uint64_t i = 0;i < HISTOGRAM_SIZE;i++) {
+      if(histogram[i] == 0) {
+        continue;
+      }
+
+      printf(" [%lu%s] %lu",
+             i,
+             (i == HISTOGRAM_SIZE - 1) ? "+" : "",
+             histogram[i]);
+    }
+
+    putchar('\n');
+
+    return;
+  }
+};
+
+} // namespace index
+} // namespace peloton
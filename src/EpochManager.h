@@ -0,0 +1,333 @@
+
+#pragma once
+
+#include <cstdio>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace peloton {
+namespace index {
+
+#include "common.h"
+
+/*
+ * class EpochManager - Epoch based deferred memory reclamation
+ *
+ * Lock-free readers of a data structure could still hold pointers to memory
+ * that has been unlinked by a writer. The writer therefore does not free such
+ * memory immediately, but retires it into the garbage list together with the
+ * epoch in which it is retired. Each reader announces the epoch it observes
+ * before touching the data structure, and clears the announcement after it
+ * has finished. Garbage could be freed as soon as it is older than the
+ * epochs announced by all readers that are currently active
+ *
+ * Readers must register themselves to obtain a thread ID, which is the index
+ * of the slot they announce their epoch in. Slots are padded to the size of
+ * a cache line such that readers do not share cache lines
+ *
+ * The cost for readers is one sequentially consistent store on entering and
+ * one release store on leaving. Writers pay for scanning all slots, which is
+ * amortized by only reclaiming after a number of retires
+ */
+class EpochManager {
+ public:
+
+  // Default maximum number of threads that could be registered
+  static constexpr uint64_t DEFAULT_MAX_THREAD_COUNT = 64;
+
+  // Garbage is reclaimed after this many objects have been retired
+  static constexpr uint64_t RECLAIM_THRESHOLD = 64;
+
+  // The epoch announced by a thread that is not in a critical section
+  static constexpr uint64_t IDLE_EPOCH = UINT64_MAX;
+
+ private:
+
+  // The size of a cache line to pad slots
+  static constexpr uint64_t CACHE_LINE_SIZE = 64;
+
+  /*
+   * class ThreadSlot - Holds the epoch announced by one thread
+   */
+  class ThreadSlot {
+   public:
+    std::atomic<uint64_t> epoch;
+
+    // Whether the slot has been handed out to a thread
+    std::atomic<bool> used;
+
+    // Avoid false sharing between threads
+    char padding[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>) - \
+                 sizeof(std::atomic<bool>)];
+  };
+
+  /*
+   * class GarbageNode - A retired memory chunk and the function to free it
+   */
+  class GarbageNode {
+   public:
+    void *p;
+    void (*free_func)(void *);
+
+    // The epoch in which the memory is retired
+    uint64_t epoch;
+  };
+
+  // This is advanced every time a memory chunk is retired
+  std::atomic<uint64_t> global_epoch;
+
+  ThreadSlot *slot_list_p;
+  uint64_t max_thread_count;
+
+  // Retired memory that has not been freed
+  std::vector<GarbageNode> garbage_list;
+
+  // Protects the garbage list, in case there are multiple writers
+  std::mutex garbage_lock;
+
+  // Number of retires since the last reclamation
+  uint64_t retire_count;
+
+  /*
+   * GetMinActiveEpoch() - Returns the minimum epoch announced by all
+   *                       active threads, or IDLE_EPOCH if no thread is
+   *                       in a critical section
+   */
+  uint64_t GetMinActiveEpoch() const {
+    uint64_t min_epoch = IDLE_EPOCH;
+
+    for(uint64_t i = 0;i < max_thread_count;i++) {
+      uint64_t epoch = slot_list_p[i].epoch.load();
+      if(epoch < min_epoch) {
+        min_epoch = epoch;
+      }
+    }
+
+    return min_epoch;
+  }
+
+  /*
+   * ReclaimLocked() - Frees all garbage that could not be seen by any
+   *                   active thread
+   *
+   * The caller must hold the garbage lock
+   */
+  void ReclaimLocked() {
+    uint64_t min_epoch = GetMinActiveEpoch();
+
+    // Compact the garbage list in-place while freeing
+    uint64_t keep_count = 0;
+    for(uint64_t i = 0;i < garbage_list.size();i++) {
+      GarbageNode &node = garbage_list[i];
+
+      // A thread that announces the same epoch as the garbage might have
+      // entered before the memory is unlinked
+      if(node.epoch < min_epoch) {
+        node.free_func(node.p);
+      } else {
+        garbage_list[keep_count] = node;
+        keep_count++;
+      }
+    }
+
+    garbage_list.resize(keep_count);
+    retire_count = 0;
+
+    return;
+  }
+
+ public:
+
+  /*
+   * Constructor
+   */
+  EpochManager(uint64_t p_max_thread_count = DEFAULT_MAX_THREAD_COUNT) :
+    global_epoch{0},
+    slot_list_p{new ThreadSlot[p_max_thread_count]},
+    max_thread_count{p_max_thread_count},
+    garbage_list{},
+    garbage_lock{},
+    retire_count{0} {
+    static_assert(sizeof(ThreadSlot) == CACHE_LINE_SIZE,
+                  "ThreadSlot must occupy exactly one cache line");
+
+    for(uint64_t i = 0;i < max_thread_count;i++) {
+      slot_list_p[i].epoch.store(IDLE_EPOCH);
+      slot_list_p[i].used.store(false);
+    }
+
+    return;
+  }
+
+  // Threads hold pointers to the slots, so the manager could not be moved
+  EpochManager(const EpochManager &) = delete;
+  EpochManager &operator=(const EpochManager &) = delete;
+
+  /*
+   * Destructor - Frees all garbage regardless of the epoch
+   *
+   * The caller must make sure that no thread is active
+   */
+  ~EpochManager() {
+    for(GarbageNode &node : garbage_list) {
+      node.free_func(node.p);
+    }
+
+    delete[] slot_list_p;
+
+    return;
+  }
+
+  /*
+   * RegisterThread() - Assigns a slot to the calling thread and returns
+   *                    its ID
+   *
+   * This function asserts that there is a free slot
+   */
+  uint64_t RegisterThread() {
+    for(uint64_t i = 0;i < max_thread_count;i++) {
+      bool expected = false;
+      if(slot_list_p[i].used.compare_exchange_strong(expected, true) == true) {
+        return i;
+      }
+    }
+
+    // Too many threads
+    assert(false);
+
+    return max_thread_count;
+  }
+
+  /*
+   * UnregisterThread() - Returns a slot, such that it could be reused by
+   *                      other threads
+   */
+  void UnregisterThread(uint64_t thread_id) {
+    assert(thread_id < max_thread_count);
+    assert(slot_list_p[thread_id].epoch.load() == IDLE_EPOCH);
+
+    slot_list_p[thread_id].used.store(false);
+
+    return;
+  }
+
+  /*
+   * EnterEpoch() - Announces that the thread starts reading shared pointers
+   *
+   * The store must be sequentially consistent such that it could not be
+   * reordered with the loads of shared pointers after it
+   */
+  inline void EnterEpoch(uint64_t thread_id) {
+    assert(thread_id < max_thread_count);
+
+    slot_list_p[thread_id].epoch.store(global_epoch.load());
+
+    return;
+  }
+
+  /*
+   * LeaveEpoch() - Announces that the thread no longer holds any shared
+   *                pointer
+   */
+  inline void LeaveEpoch(uint64_t thread_id) {
+    assert(thread_id < max_thread_count);
+
+    slot_list_p[thread_id].epoch.store(IDLE_EPOCH, std::memory_order_release);
+
+    return;
+  }
+
+  /*
+   * Retire() - Defers freeing a memory chunk that has been unlinked from
+   *            the shared data structure
+   *
+   * The chunk is freed by calling free_func on it when no active thread
+   * could still hold a pointer to it
+   */
+  void Retire(void *p, void (*free_func)(void *)) {
+    std::lock_guard<std::mutex> lock{garbage_lock};
+
+    // Threads entering after this point must have seen the chunk unlinked
+    uint64_t epoch = global_epoch.fetch_add(1);
+
+    garbage_list.push_back(GarbageNode{p, free_func, epoch});
+    retire_count++;
+
+    if(retire_count >= RECLAIM_THRESHOLD) {
+      ReclaimLocked();
+    }
+
+    return;
+  }
+
+  /*
+   * Retire() - Defers calling free() on a memory chunk
+   */
+  void Retire(void *p) {
+    Retire(p, free);
+
+    return;
+  }
+
+  /*
+   * Reclaim() - Frees all garbage that could be freed right now
+   */
+  void Reclaim() {
+    std::lock_guard<std::mutex> lock{garbage_lock};
+    ReclaimLocked();
+
+    return;
+  }
+
+  /*
+   * GetGarbageCount() - Returns the number of retired chunks that have not
+   *                     been freed
+   */
+  uint64_t GetGarbageCount() {
+    std::lock_guard<std::mutex> lock{garbage_lock};
+
+    return garbage_list.size();
+  }
+};
+
+/*
+ * class EpochGuard - Enters an epoch on construction and leaves it on
+ *                    destruction
+ */
+class EpochGuard {
+ private:
+  EpochManager *epoch_manager_p;
+  uint64_t thread_id;
+
+ public:
+
+  /*
+   * Constructor
+   */
+  EpochGuard(EpochManager *p_epoch_manager_p, uint64_t p_thread_id) :
+    epoch_manager_p{p_epoch_manager_p},
+    thread_id{p_thread_id} {
+    epoch_manager_p->EnterEpoch(thread_id);
+
+    return;
+  }
+
+  EpochGuard(const EpochGuard &) = delete;
+  EpochGuard &operator=(const EpochGuard &) = delete;
+
+  /*
+   * Destructor
+   */
+  ~EpochGuard() {
+    epoch_manager_p->LeaveEpoch(thread_id);
+
+    return;
+  }
+};
+
+} // namespace index
+} // namespace peloton
@@ -0,0 +1,395 @@
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <algorithm>
+
+#include "HashTable_OA_KVL.h"
+#include "SpillFile.h"
+
+namespace peloton {
+namespace index {
+
+/*
+ * class HashAggregation - Hash based grouping with a memory budget that
+ *                         spills partitions to disk
+ *
+ * Each input row is a key and a partial aggregate, e.g. a count of 1 and
+ * the value for SUM() and AVG(). Rows of the same key are combined into a
+ * single group in a HashTable_OA_KVL by calling
+ *
+ *   combine_obj(AggregateType *group_p, const AggregateType &partial)
+ *
+ * Groups are hash partitioned into PARTITION_COUNT partitions. When the
+ * table is full and growing it would exceed the memory budget, the
+ * partition with the most groups in memory is spilled: its groups are
+ * written into a SpillFile and removed from the table, and all later rows
+ * of that partition are appended to the file without being combined. The
+ * table then keeps its size, so memory used by the table is bounded by the
+ * budget plus one resize. Each spill file also takes spill_buffer_size
+ * bytes for the write buffer
+ *
+ * Finish() emits groups in memory, frees the table, and then aggregates
+ * every spilled run recursively with the same budget. Partitions of a
+ * deeper level are selected by the next PARTITION_BITS bits of the hash
+ * value, so the run is split again if it still has too many groups. A run
+ * at MAX_LEVEL is aggregated in memory regardless of the budget, since all
+ * hash bits have been used and its keys could not be split any further
+ *
+ * The hash of a row is computed once: AddWithHash() takes a hash computed
+ * by an upstream operator, and the hash is kept in spilled records, so
+ * deeper levels do not hash keys again. The table uses the lowest bits of
+ * the hash as the slot index, while partitions are chosen by the highest
+ * bits after mixing, so keys of the same partition are not clustered in
+ * the table
+ *
+ * If a run could not be written or read back, AddWithHash() or Finish()
+ * returns false. Groups of the run are lost at that point, so the result is
+ * incomplete and the operator should be abandoned
+ *
+ * KeyType and AggregateType must be trivially copyable. Groups are emitted
+ * in no particular order. This class is not thread-safe
+ */
+template <typename KeyType,
+          typename AggregateType,
+          typename CombineFunc,
+          typename KeyHashFunc = std::hash<KeyType>,
+          typename KeyEqualityChecker = std::equal_to<KeyType>>
+class HashAggregation {
+ public:
+  static constexpr uint64_t PARTITION_BITS = 4;
+  static constexpr uint64_t PARTITION_COUNT = 0x1UL << PARTITION_BITS;
+
+  // The deepest level uses the lowest PARTITION_BITS bits
+  static constexpr uint64_t MAX_LEVEL = 64 / PARTITION_BITS - 1;
+
+  // Buffers are smaller than the default, since there could be one for
+  // every partition
+  static constexpr size_t DEFAULT_SPILL_BUFFER_SIZE = 256 * 1024;
+
+  /*
+   * class AggregateRecord - Format of a row in a spilled run
+   */
+  class AggregateRecord {
+   public:
+    KeyType key;
+    uint64_t hash_value;
+    AggregateType agg;
+  };
+
+  using TableType = HashTable_OA_KVL<KeyType,
+                                     AggregateType,
+                                     KeyHashFunc,
+                                     KeyEqualityChecker>;
+
+  using SpillFileType = SpillFile<AggregateRecord>;
+
+ private:
+  TableType table;
+
+  uint64_t memory_budget;
+
+  size_t spill_buffer_size;
+
+  // Recursion level, which decides the hash bits used for partitioning
+  uint64_t level;
+
+  CombineFunc combine_obj;
+  KeyHashFunc key_hash_obj;
+  KeyEqualityChecker key_eq_obj;
+
+  // Number of groups in the table
+  uint64_t group_count;
+
+  // Number of groups in the table of each partition
+  uint64_t partition_group_count[PARTITION_COUNT];
+
+  // Run of each partition, or nullptr if the partition is not spilled
+  SpillFileType *spill_file_list[PARTITION_COUNT];
+
+  // Counters including recursive levels that have finished
+  uint64_t spill_count;
+  uint64_t spilled_record_count;
+  uint64_t max_level;
+
+  /*
+   * GetPartition() - Returns the partition of a hash value at this level
+   *
+   * The hash value is mixed first, since the table only uses the lowest
+   * bits and hash functions such as std::hash<uint64_t> leave higher bits
+   * zero
+   */
+  inline uint64_t GetPartition(uint64_t hash_value) const {
+    hash_value = SimpleInt64Hasher{}(hash_value);
+
+    return (hash_value >> (64 - PARTITION_BITS * (level + 1))) & \
+           (PARTITION_COUNT - 1);
+  }
+
+  /*
+   * IsOverBudget() - Returns whether growing the table would exceed the
+   *                  memory budget
+   */
+  inline bool IsOverBudget() const {
+    if(level == MAX_LEVEL) {
+      return false;
+    }
+
+    return table.GetArrayMemorySize() * 2 > memory_budget;
+  }
+
+  /*
+   * SpillLargestPartition() - Moves groups of the partition with the most
+   *                           groups in memory into a new run
+   *
+   * This is a single scan of the table followed by an in-place rehash.
+   * Returns false if the run could not be written
+   */
+  bool SpillLargestPartition() {
+    uint64_t victim = PARTITION_COUNT;
+    for(uint64_t p = 0;p < PARTITION_COUNT;p++) {
+      if((spill_file_list[p] == nullptr) && \
+         ((victim == PARTITION_COUNT) || \
+          (partition_group_count[p] > partition_group_count[victim]))) {
+        victim = p;
+      }
+    }
+
+    // Spilled partitions have no group in memory, so there is one with
+    // groups if the table is full
+    assert(victim != PARTITION_COUNT);
+    assert(partition_group_count[victim] > 0);
+
+    SpillFileType *file_p = new SpillFileType{spill_buffer_size};
+    spill_file_list[victim] = file_p;
+
+    // Reuse hash values cached in the table, which are the ones passed to
+    // AddWithHash(). Groups are removed even if they could not be written,
+    // so that the count of the partition stays consistent
+    bool append_ok = true;
+    uint64_t deleted_count = \
+      table.DeleteIfWithHash([this, victim, file_p, &append_ok](
+                               const KeyType &key,
+                               uint64_t hash_value,
+                               const AggregateType &agg) {
+        if(GetPartition(hash_value) != victim) {
+          return false;
+        }
+
+        append_ok = file_p->Append(AggregateRecord{key, hash_value, agg}) && \
+                    append_ok;
+
+        return true;
+      });
+
+    assert(deleted_count == partition_group_count[victim]);
+
+    group_count -= partition_group_count[victim];
+    partition_group_count[victim] = 0;
+
+    spill_count++;
+    spilled_record_count += deleted_count;
+
+    return append_ok;
+  }
+
+ public:
+
+  /*
+   * Constructor
+   *
+   * The budget is the maximum number of bytes used by the hash table
+   */
+  HashAggregation(uint64_t p_memory_budget,
+                  const CombineFunc &p_combine_obj = CombineFunc{},
+                  const KeyHashFunc &p_key_hash_obj = KeyHashFunc{},
+                  const KeyEqualityChecker &p_key_eq_obj = \
+                    KeyEqualityChecker{},
+                  size_t p_spill_buffer_size = DEFAULT_SPILL_BUFFER_SIZE,
+                  uint64_t p_level = 0) :
+    table{0, p_key_hash_obj, p_key_eq_obj},
+    memory_budget{p_memory_budget},
+    spill_buffer_size{p_spill_buffer_size},
+    level{p_level},
+    combine_obj{p_combine_obj},
+    key_hash_obj{p_key_hash_obj},
+    key_eq_obj{p_key_eq_obj},
+    group_count{0},
+    partition_group_count{},
+    spill_file_list{},
+    spill_count{0},
+    spilled_record_count{0},
+    max_level{p_level} {
+    static_assert(std::is_trivially_copyable<KeyType>::value && \
+                  std::is_trivially_copyable<AggregateType>::value,
+                  "Keys and aggregates are spilled as raw bytes");
+    assert(level <= MAX_LEVEL);
+
+    return;
+  }
+
+  HashAggregation(const HashAggregation &) = delete;
+  HashAggregation &operator=(const HashAggregation &) = delete;
+
+  /*
+   * Destructor - Removes runs that have not been aggregated
+   */
+  ~HashAggregation() {
+    for(uint64_t p = 0;p < PARTITION_COUNT;p++) {
+      delete spill_file_list[p];
+    }
+
+    return;
+  }
+
+  /*
+   * Add() - Combines a row into its group
+   *
+   * The row is appended to the run if its partition has been spilled.
+   * Returns false if a run could not be written
+   */
+  inline bool Add(const KeyType &key, const AggregateType &agg) {
+    return AddWithHash(key, key_hash_obj(key), agg);
+  }
+
+  /*
+   * AddWithHash() - Combines a row whose hash value has been computed by the
+   *                 caller into its group
+   *
+   * hash_value must be equal to key_hash_obj(key). Returns false if a run
+   * could not be written
+   */
+  bool AddWithHash(const KeyType &key,
+                   uint64_t hash_value,
+                   const AggregateType &agg) {
+    uint64_t partition = GetPartition(hash_value);
+
+    if(spill_file_list[partition] == nullptr) {
+      AggregateType *group_p = table.GetFirstValueWithHash(key, hash_value);
+      if(group_p != nullptr) {
+        combine_obj(group_p, agg);
+
+        return true;
+      }
+
+      // The insert below would grow the table
+      if((group_count == table.GetResizeThreshold()) && \
+         (IsOverBudget() == true)) {
+        if(SpillLargestPartition() == false) {
+          return false;
+        }
+      }
+    }
+
+    // Check again since the partition of the key might just be spilled
+    if(spill_file_list[partition] != nullptr) {
+      spilled_record_count++;
+
+      return spill_file_list[partition]->Append(
+        AggregateRecord{key, hash_value, agg});
+    }
+
+    table.InsertWithHash(key, hash_value, agg);
+
+    group_count++;
+    partition_group_count[partition]++;
+
+    return true;
+  }
+
+  /*
+   * Finish() - Calls the callback on every group and resets the operator
+   *
+   * The callback is called as cb(const KeyType &, const AggregateType &)
+   * exactly once for each distinct key added. Returns false if a run could
+   * not be written or read back, in which case groups of the run and of
+   * runs not aggregated yet are not emitted
+   */
+  template <typename CallbackType>
+  bool Finish(CallbackType cb) {
+    for(auto it = table.begin();it != table.end();++it) {
+      cb(it.GetKey(), *it);
+    }
+
+    // Release the table before aggregating runs
+    table = TableType{0, key_hash_obj, key_eq_obj};
+    group_count = 0;
+
+    for(uint64_t p = 0;p < PARTITION_COUNT;p++) {
+      partition_group_count[p] = 0;
+
+      SpillFileType *file_p = spill_file_list[p];
+      if(file_p == nullptr) {
+        continue;
+      }
+
+      spill_file_list[p] = nullptr;
+
+      HashAggregation child{memory_budget,
+                            combine_obj,
+                            key_hash_obj,
+                            key_eq_obj,
+                            spill_buffer_size,
+                            level + 1};
+
+      bool ok = file_p->Rewind();
+
+      AggregateRecord record;
+      while((ok == true) && (file_p->Read(&record) == true)) {
+        ok = child.AddWithHash(record.key, record.hash_value, record.agg);
+      }
+
+      ok = ok && (file_p->HasFailed() == false);
+      delete file_p;
+
+      ok = ok && child.Finish(cb);
+
+      spill_count += child.spill_count;
+      spilled_record_count += child.spilled_record_count;
+      max_level = std::max(max_level, child.max_level);
+
+      // Runs not aggregated yet are removed by the destructor
+      if(ok == false) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /*
+   * GetGroupCount() - Returns the number of groups in memory
+   */
+  inline uint64_t GetGroupCount() const {
+    return group_count;
+  }
+
+  /*
+   * GetSpillCount() - Returns the number of partitions spilled, including
+   *                   those of recursive levels
+   */
+  inline uint64_t GetSpillCount() const {
+    return spill_count;
+  }
+
+  /*
+   * GetSpilledRecordCount() - Returns the number of records written into
+   *                           runs, including those of recursive levels
+   */
+  inline uint64_t GetSpilledRecordCount() const {
+    return spilled_record_count;
+  }
+
+  /*
+   * GetMaxLevel() - Returns the deepest recursion level reached
+   */
+  inline uint64_t GetMaxLevel() const {
+    return max_level;
+  }
+};
+
+} // namespace index
+} // namespace peloton
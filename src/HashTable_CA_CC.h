@@ -7,6 +7,14 @@
 #include <functional>
 #include <cstring>
 #include <vector>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+#include "OperationStats.h"
+#include "TableEvents.h"
+#include "MemoryBudget.h"
+#include "ChainStats.h"
 
 namespace peloton {
 namespace index {
@@ -39,7 +47,8 @@ template <typename KeyType,
           typename ValueType,
           typename KeyHashFunc = std::hash<KeyType>,
           typename KeyEqualityChecker = std::equal_to<KeyType>,
-          typename LoadFactorCalculator = LoadFactorPercent<400>>
+          typename LoadFactorCalculator = LoadFactorPercent<400>,
+          typename StatsType = NoStats>
 class HashTable_CA_CC {
  private:
    
@@ -131,6 +140,16 @@ class HashTable_CA_CC {
   KeyEqualityChecker key_eq_obj;
   LoadFactorCalculator lfc;
   
+  // Operation counters; See HashTable_OA_KVL
+  StatsType stats;
+  
+  // Receives resize events; Not owned by the table
+  TableEventListener *listener_p;
+  
+  // Limits memory of the table; Not owned by the table. It is charged
+  // GetMemorySize() bytes
+  MemoryBudget *budget_p;
+  
  private:
    
   /*
@@ -196,6 +215,23 @@ class HashTable_CA_CC {
     
     return;
   }
+  
+  /*
+   * RedirectDummySlot() - Makes the slot of the first entry point to the
+   *                       dummy entry of this table
+   *
+   * The slot of the first entry on the linked list points to the dummy
+   * entry, which is embedded in the table object. When the linked list is
+   * moved between table objects this slot must be updated
+   */
+  void RedirectDummySlot() {
+    if(dummy_entry.next_p != nullptr) {
+      uint64_t index = dummy_entry.next_p->hash_value & index_mask;
+      entry_p_list_p[index] = &dummy_entry;
+    }
+    
+    return;
+  }
    
   /*
    * Resize() - Double the size of the array and scatter elements
@@ -208,11 +244,33 @@ class HashTable_CA_CC {
     // Entry count is the number of HashEntry object
     assert(entry_count == resize_threshold);
     
+    Rehash(slot_count << 1);
+    
+    return;
+  }
+  
+  /*
+   * Rehash() - Scatters elements into a new array of the given size
+   *
+   * Entries are relinked rather than copied
+   */
+  void Rehash(uint64_t new_slot_count) {
+    assert((new_slot_count & (new_slot_count - 1)) == 0);
+    
+    uint64_t start_time = stats.GetTime();
+    
+    ResizeEvent event{slot_count, new_slot_count, entry_count, 0, 0};
+    uint64_t event_start_time = 0;
+    if(listener_p != nullptr) {
+      listener_p->OnResizeBegin(event);
+      event_start_time = TableEventListener::GetTime();
+    }
+    
     // We could free it here right now since we traverse the linked
     // list rather than using this array
     delete[] entry_p_list_p;
     
-    slot_count <<= 1;
+    slot_count = new_slot_count;
     index_mask = slot_count - 1;
     
     // Compute the new slot count after updating it
@@ -245,6 +303,14 @@ class HashTable_CA_CC {
       entry_p = next_p;
     }
     
+    stats.Add(StatsCounter::RESIZE);
+    stats.Add(StatsCounter::RESIZE_TIME_NS, stats.GetTime() - start_time);
+    
+    if(listener_p != nullptr) {
+      event.duration_ns = TableEventListener::GetTime() - event_start_time;
+      listener_p->OnResizeEnd(event);
+    }
+    
     return;
   }
   
@@ -261,7 +327,10 @@ class HashTable_CA_CC {
     entry_count{0},
     key_hash_obj{p_key_hash_obj},
     key_eq_obj{p_key_eq_obj},
-    lfc{p_lfc} {
+    lfc{p_lfc},
+    stats{},
+    listener_p{nullptr},
+    budget_p{nullptr} {
     // First round it up to power of 2
     int leading_zero = __builtin_clzl(slot_count);
     int effective_bits = 64 - leading_zero;
@@ -314,15 +383,153 @@ class HashTable_CA_CC {
     // Also free the pointer array
     delete[] entry_p_list_p;
     
+    if(budget_p != nullptr) {
+      budget_p->Release(GetMemorySize());
+    }
+    
+    return;
+  }
+  
+  // The implicit copy would share entries; Use Clone() instead
+  HashTable_CA_CC(const HashTable_CA_CC &) = delete;
+  HashTable_CA_CC &operator=(const HashTable_CA_CC &) = delete;
+  
+  /*
+   * Move Constructor - Takes over the entries of another table in O(1)
+   *
+   * The other table is left without a slot array, and could only be
+   * destroyed or assigned to
+   */
+  HashTable_CA_CC(HashTable_CA_CC &&other) :
+    entry_p_list_p{other.entry_p_list_p},
+    index_mask{other.index_mask},
+    slot_count{other.slot_count},
+    entry_count{other.entry_count},
+    resize_threshold{other.resize_threshold},
+    key_hash_obj{other.key_hash_obj},
+    key_eq_obj{other.key_eq_obj},
+    lfc{other.lfc},
+    stats{std::move(other.stats)},
+    listener_p{other.listener_p},
+    budget_p{other.budget_p} {
+    dummy_entry.next_p = other.dummy_entry.next_p;
+    RedirectDummySlot();
+    
+    other.entry_p_list_p = nullptr;
+    other.dummy_entry.next_p = nullptr;
+    other.index_mask = 0;
+    other.slot_count = 0;
+    other.entry_count = 0;
+    other.resize_threshold = 0;
+    other.listener_p = nullptr;
+    other.budget_p = nullptr;
+    
+    return;
+  }
+  
+  /*
+   * Move Assignment - Swaps content with the other table
+   *
+   * The previous content of this table is freed when the other table
+   * is destroyed
+   */
+  HashTable_CA_CC &operator=(HashTable_CA_CC &&other) {
+    Swap(other);
+    
+    return *this;
+  }
+  
+  /*
+   * Swap() - Swaps content of two tables in O(1)
+   */
+  void Swap(HashTable_CA_CC &other) {
+    std::swap(entry_p_list_p, other.entry_p_list_p);
+    std::swap(dummy_entry.next_p, other.dummy_entry.next_p);
+    std::swap(index_mask, other.index_mask);
+    std::swap(slot_count, other.slot_count);
+    std::swap(entry_count, other.entry_count);
+    std::swap(resize_threshold, other.resize_threshold);
+    std::swap(key_hash_obj, other.key_hash_obj);
+    std::swap(key_eq_obj, other.key_eq_obj);
+    std::swap(lfc, other.lfc);
+    stats.Swap(other.stats);
+    std::swap(listener_p, other.listener_p);
+    std::swap(budget_p, other.budget_p);
+    
+    // Slots still point to the dummy entry of the previous owner
+    RedirectDummySlot();
+    other.RedirectDummySlot();
+    
     return;
   }
+  
+  /*
+   * Clone() - Returns a deep copy of the table
+   *
+   * The copy has the same number of slots, and cached hash values are
+   * reused such that no key is rehashed. Entries are allocated one by one
+   * so they are copy constructed
+   */
+  HashTable_CA_CC Clone() const {
+    HashTable_CA_CC ret{1, key_hash_obj, key_eq_obj, lfc};
+    ret.Rehash(slot_count);
+    
+    for(HashEntry *entry_p = dummy_entry.next_p;
+        entry_p != nullptr;
+        entry_p = entry_p->next_p) {
+      HashEntry *new_entry_p = \
+        new HashEntry{entry_p->hash_value,
+                      entry_p->kv_pair.first,
+                      entry_p->kv_pair.second};
+      
+      ret.InsertIntoSlot(new_entry_p, entry_p->hash_value & ret.index_mask);
+    }
+    
+    ret.entry_count = entry_count;
+    
+    // Counters of the copy start from zero, and it has no listener or
+    // memory budget
+    ret.ResetStats();
+    
+    return ret;
+  }
 
   /*
    * Insert() - Adds a key value pair into the table
    *
    * This operation does not invalidate any iterator on existing entries
+   *
+   * Returns false without inserting if the entry, or the larger slot array
+   * if the table has to grow, does not fit into the memory budget. Always
+   * returns true if there is no budget
+   */
+  inline bool Insert(const KeyType &key, const ValueType &value) {
+    return InsertWithHash(key, key_hash_obj(key), value);
+  }
+  
+  /*
+   * InsertWithHash() - Adds a key value pair whose hash value has been
+   *                    computed by the caller
+   *
+   * hash_value is stored in the entry and used on resize, so every access to
+   * the table must use the same hash function, which is key_hash_obj(key)
+   * if functions that hash the key are also called. The slot index is the
+   * lowest bits of the hash (hash_value & index_mask), so callers could
+   * partition rows by the highest bits of the same hash
    */
-  void Insert(const KeyType &key, const ValueType &value) {
+  bool InsertWithHash(const KeyType &key,
+                      uint64_t hash_value,
+                      const ValueType &value) {
+    uint64_t size = sizeof(HashEntry);
+    if(entry_count == resize_threshold) {
+      // The slot array is doubled
+      size += slot_count * sizeof(HashEntry *);
+    }
+    
+    if((budget_p != nullptr) && (budget_p->TryReserve(size) == false)) {
+      return false;
+    }
+    
     // Let's resize
     if(entry_count == resize_threshold) {
       Resize();
@@ -332,7 +539,6 @@ class HashTable_CA_CC {
       assert(entry_count < resize_threshold);
     }
     
-    uint64_t hash_value = key_hash_obj(key);
     uint64_t index = index_mask & hash_value;
     
     // We do not initialize its next_p since it will not be relied on
@@ -347,7 +553,9 @@ class HashTable_CA_CC {
     // Do not forget this
     entry_count++;
     
-    return;
+    stats.Add(StatsCounter::INSERT);
+    
+    return true;
   }
   
   /*
@@ -357,15 +565,35 @@ class HashTable_CA_CC {
    * Note that this function might cause a resize if during the traversal
    * the delta chain is larger
    */
-  void GetValue(const KeyType &key,
-                std::function<void(const std::pair<KeyType, ValueType> &)> cb) {
-    uint64_t hash_value = key_hash_obj(key);
+  inline void GetValue(
+    const KeyType &key,
+    std::function<void(const std::pair<KeyType, ValueType> &)> cb) {
+    GetValueWithHash(key, key_hash_obj(key), cb);
+    
+    return;
+  }
+  
+  /*
+   * GetValueWithHash() - Invokes the call back on values of a key whose hash
+   *                      value has been computed by the caller, as
+   *                      InsertWithHash()
+   */
+  void GetValueWithHash(
+    const KeyType &key,
+    uint64_t hash_value,
+    std::function<void(const std::pair<KeyType, ValueType> &)> cb) {
     uint64_t index = index_mask & hash_value;
 
     HashEntry *entry_p = entry_p_list_p[index];
     
+    // Number of entries walked and keys compared; Only used for stats
+    uint64_t walk_count = 0;
+    uint64_t compare_count = 0;
+    
     // Special case: If key does not exist just return
     if(entry_p == nullptr) {
+      RecordLookup(walk_count, compare_count);
+      
       return;
     } else {
       entry_p = entry_p->next_p;
@@ -375,18 +603,135 @@ class HashTable_CA_CC {
     // as well as key to find values associated with it
     while((entry_p != nullptr) && \
           ((entry_p->hash_value & index_mask) == index)) {
-            
-      if(key_eq_obj(key, entry_p->kv_pair.first) == true) {
-        cb(entry_p->kv_pair);
+      if(entry_p->hash_value == hash_value) {
+        compare_count++;
+        
+        if(key_eq_obj(key, entry_p->kv_pair.first) == true) {
+          cb(entry_p->kv_pair);
+        }
       }
       
       // Immediately go to the next element
       entry_p = entry_p->next_p;
+      walk_count++;
     }
     
+    RecordLookup(walk_count, compare_count);
+    
     return;
   }
   
+ private:
+  
+  /*
+   * RecordLookup() - Counts a lookup with the number of entries walked and
+   *                  keys compared
+   *
+   * Keys are only compared on entries whose hash value matches
+   */
+  inline void RecordLookup(uint64_t walk_count, uint64_t compare_count) {
+    stats.Add(StatsCounter::LOOKUP);
+    stats.Add(StatsCounter::CHAIN_WALK, walk_count);
+    stats.Add(StatsCounter::KEY_COMPARE, compare_count);
+    
+    return;
+  }
+  
+ public:
+  
+  /*
+   * GetStats() - Returns the current value of operation counters
+   */
+  OperationStatsSnapshot GetStats() const {
+    return stats.GetSnapshot();
+  }
+  
+  /*
+   * ResetStats() - Sets all operation counters to zero
+   */
+  void ResetStats() {
+    stats.Reset();
+    
+    return;
+  }
+  
+  /*
+   * GetMemorySize() - Returns the size of the slot array and all entries
+   *                   in bytes
+   */
+  uint64_t GetMemorySize() const {
+    return slot_count * sizeof(HashEntry *) + entry_count * sizeof(HashEntry);
+  }
+  
+  /*
+   * SetMemoryBudget() - Charges memory of the table to a budget, or removes
+   *                     the budget if nullptr is given
+   *
+   * See HashTable_OA_KVL::SetMemoryBudget()
+   */
+  void SetMemoryBudget(MemoryBudget *p_budget_p) {
+    if(budget_p != nullptr) {
+      budget_p->Release(GetMemorySize());
+    }
+    
+    budget_p = p_budget_p;
+    if(budget_p != nullptr) {
+      budget_p->Charge(GetMemorySize());
+    }
+    
+    return;
+  }
+  
+  /*
+   * SetEventListener() - Registers a listener for resize events, or removes
+   *                      it if nullptr is given
+   *
+   * See HashTable_OA_KVL::SetEventListener()
+   */
+  void SetEventListener(TableEventListener *p_listener_p) {
+    listener_p = p_listener_p;
+    
+    return;
+  }
+  
+  /*
+   * GetChainStats() - Returns the distribution of chain lengths and the
+   *                   number of values per key
+   *
+   * Entries of the same slot are consecutive on the linked list, so chains
+   * are found by a single walk on the list. This is O(n) and only intended
+   * for profiling
+   */
+  ChainStats GetChainStats() const {
+    ChainStats chain_stats{slot_count};
+    std::vector<std::pair<uint64_t, const KeyType *>> chain{};
+    
+    // Slots that have a chain; The rest are empty
+    uint64_t chain_count = 0;
+    
+    const HashEntry *entry_p = dummy_entry.next_p;
+    while(entry_p != nullptr) {
+      uint64_t index = entry_p->hash_value & index_mask;
+      
+      chain.clear();
+      while((entry_p != nullptr) && \
+            ((entry_p->hash_value & index_mask) == index)) {
+        chain.emplace_back(entry_p->hash_value, &entry_p->kv_pair.first);
+        entry_p = entry_p->next_p;
+      }
+      
+      chain_stats.AddChain(&chain, key_eq_obj);
+      chain_count++;
+    }
+    
+    chain.clear();
+    for(uint64_t i = chain_count;i < slot_count;i++) {
+      chain_stats.AddChain(&chain, key_eq_obj);
+    }
+    
+    return chain_stats;
+  }
+  
   /*
    * GetValue() - Return all value elements in a vector
    */
@@ -403,18 +748,177 @@ class HashTable_CA_CC {
     return;
   }
   
- private:
+ public:
    
   /*
-   * class Iterator - Iterates through the hash table
+   * class GenericIterator - Iterates through the hash table
+   *
+   * Since all entries in CA_CC are linked together as a singly linked list
+   * starting at the dummy entry, iterating is just following next_p, and the
+   * iterator is as large as a pointer. The end iterator holds nullptr
+   *
+   * Dereferencing the iterator yields the key value pair with a const key,
+   * as in standard associative containers, since modifying the key would
+   * leave the entry on the wrong collision chain with a stale hash value
    */
-  class Iterator {
-    friend class HashTable_CC_CA;
+  template <typename IteratorValueType>
+  class GenericIterator {
+    friend class HashTable_CA_CC;
+    
+    // Allows conversion from iterator to const_iterator
+    template <typename>
+    friend class GenericIterator;
+    
+   public:
+    
+    // Types required by std::iterator_traits
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename std::remove_const<IteratorValueType>::type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = IteratorValueType *;
+    using reference = IteratorValueType &;
     
    private:
     HashEntry *entry_p;
+    
+   public:
+    
+    /*
+     * Default Constructor - Constructs a singular iterator
+     */
+    GenericIterator() :
+      entry_p{nullptr}
+    {}
+    
+    /*
+     * Constructor
+     */
+    GenericIterator(HashEntry *p_entry_p) :
+      entry_p{p_entry_p}
+    {}
+    
+    /*
+     * Converting Constructor - Builds a const_iterator from an iterator
+     */
+    template <typename OtherValueType,
+              typename = typename std::enable_if<
+                std::is_convertible<OtherValueType *,
+                                    IteratorValueType *>::value>::type>
+    GenericIterator(const GenericIterator<OtherValueType> &other) :
+      entry_p{other.entry_p}
+    {}
+    
+    /*
+     * Prefix operator++() - Advances the iterator by one element
+     */
+    GenericIterator &operator++() {
+      entry_p = entry_p->next_p;
+      
+      return *this;
+    }
+    
+    /*
+     * Postfix operator++() - Advances the iterator by one element
+     *                        and return the value before ++ operation
+     */
+    GenericIterator operator++(int) {
+      GenericIterator ret = *this;
+      
+      entry_p = entry_p->next_p;
+      
+      return ret;
+    }
+    
+    /*
+     * operator==() - Compares two iterators for equality
+     */
+    bool operator==(const GenericIterator &other) const {
+      return entry_p == other.entry_p;
+    }
+    
+    /*
+     * operator!=() - Compares two iterators for non-equality
+     */
+    bool operator!=(const GenericIterator &other) const {
+      return entry_p != other.entry_p;
+    }
+    
+    /*
+     * operator*() - Returns a reference to the key value pair
+     *
+     * The pair stored in the entry is viewed with a const key; Both pair
+     * types have the same layout
+     */
+    reference operator*() const {
+      return reinterpret_cast<reference>(entry_p->kv_pair);
+    }
+    
+    /*
+     * operator->() - Member access on the key value pair
+     */
+    pointer operator->() const {
+      return reinterpret_cast<pointer>(&entry_p->kv_pair);
+    }
   };
-
+  
+  // The key value pair seen through iterators
+  using IteratorPairType = std::pair<const KeyType, ValueType>;
+  
+  static_assert((sizeof(IteratorPairType) == \
+                 sizeof(std::pair<KeyType, ValueType>)) && \
+                (alignof(IteratorPairType) == \
+                 alignof(std::pair<KeyType, ValueType>)),
+                "Stored pairs are viewed as pairs with a const key");
+  
+  // Iterators that conform to the standard naming
+  using iterator = GenericIterator<IteratorPairType>;
+  using const_iterator = GenericIterator<const IteratorPairType>;
+  
+  /*
+   * begin() - Returns an iterator to the first entry in the linked list
+   *
+   * This is a constant time operation since the first entry is always
+   * after the dummy entry
+   */
+  inline iterator begin() {
+    return iterator{dummy_entry.next_p};
+  }
+  
+  /*
+   * end() - Returns an iterator past the last entry in the linked list
+   */
+  inline iterator end() {
+    return iterator{nullptr};
+  }
+  
+  /*
+   * begin() const - Returns a const_iterator to the first entry
+   */
+  inline const_iterator begin() const {
+    return const_iterator{dummy_entry.next_p};
+  }
+  
+  /*
+   * end() const - Returns a const_iterator past the last entry
+   */
+  inline const_iterator end() const {
+    return const_iterator{nullptr};
+  }
+  
+  /*
+   * cbegin() - Returns a const_iterator even if the table is not const
+   */
+  inline const_iterator cbegin() const {
+    return begin();
+  }
+  
+  /*
+   * cend() - Returns a const_iterator to the end even if the table is
+   *          not const
+   */
+  inline const_iterator cend() const {
+    return end();
+  }
 };
 
 }
@@ -7,6 +7,16 @@
 #include <functional>
 #include <cstring>
 #include <vector>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <algorithm>
+#include <new>
+
+#include "OperationStats.h"
+#include "TableEvents.h"
+#include "MemoryBudget.h"
+#include "ChainStats.h"
 
 namespace peloton {
 namespace index {
@@ -30,12 +40,32 @@ namespace index {
  *      list traversal.
  *   4. Iterator implementation is more complicated and requires more than the
  *      size of an ordinary pointer
+ *
+ * Chains could be self-organizing: GetFirstValue() consults the
+ * ChainReorderPolicy (see NoChainReorder) and could move the entry found to
+ * the head of its chain, which shortens lookups of hot keys
+ *
+ * If TreeifyPolicy is enabled (see TreeifyLongChains), a chain that reaches
+ * the threshold is indexed by an array of its entries sorted by hash value
+ * and key, which GetValue() and GetFirstValue() search by binary search.
+ * Entries stay on the chain, so iteration is not affected. The index is
+ * rebuilt on every rehash, so a chain that has been split below the
+ * threshold is converted back into a plain chain
+ *
+ * Entries are allocated one by one on insert, so entries of a chain end up
+ * far apart in memory. Compact() relocates all entries into a contiguous
+ * slab in bucket order, such that a chain occupies adjacent cache lines and
+ * a full scan is sequential. It could be called after every rehash by
+ * SetCompactOnResize()
  */
 template <typename KeyType,
           typename ValueType,
           typename KeyHashFunc = std::hash<KeyType>,
           typename KeyEqualityChecker = std::equal_to<KeyType>,
-          typename LoadFactorCalculator = LoadFactorPercent<400>>
+          typename LoadFactorCalculator = LoadFactorPercent<400>,
+          typename StatsType = NoStats,
+          typename ChainReorderPolicy = NoChainReorder,
+          typename TreeifyPolicy = NoTreeify>
 class HashTable_CA_SCC {
  private:
    
@@ -45,6 +75,13 @@ class HashTable_CA_SCC {
   // Let the first array fill one entire page
   static constexpr uint64_t INIT_SLOT_COUNT = PAGE_SIZE / sizeof(void *);
   
+ public:
+  
+  // Default number of chain walks in flight for GetValueInterleaved()
+  static constexpr uint64_t DEFAULT_INTERLEAVE_GROUP_SIZE = 8;
+  
+ private:
+  
   /*
    * class HashEntry - The hash entry for holding key and value
    *
@@ -79,11 +116,49 @@ class HashTable_CA_SCC {
       next_p{p_next_p},
       kv_pair{key, value}
     {}
+    
+    /*
+     * Constructor - Moves key and value from an entry being relocated
+     */
+    HashEntry(uint64_t p_hash_value,
+              HashEntry *p_next_p,
+              std::pair<KeyType, ValueType> &&p_kv_pair) :
+      hash_value{p_hash_value},
+      next_p{p_next_p},
+      kv_pair{std::move(p_kv_pair)}
+    {}
+  };
+  
+  /*
+   * class Slab - A block of entries allocated by Compact()
+   */
+  class Slab {
+   public:
+    HashEntry *entry_list_p;
+    uint64_t entry_count;
+  };
+  
+  /*
+   * class ChainIndex - Length of a chain and its sorted index
+   *
+   * This is only maintained if TreeifyPolicy is enabled
+   */
+  class ChainIndex {
+   public:
+    uint64_t length;
+    
+    // Entries on the chain sorted by hash value and key; Entries with
+    // the same key are in the same order as on the chain. This is nullptr
+    // if the chain is shorter than the threshold
+    std::vector<HashEntry *> *sorted_list_p;
   };
   
   // This is an array holding HashEntry * as the head of a collision chain
   HashEntry **entry_p_list_p;
   
+  // Index of each chain, or nullptr if TreeifyPolicy is not enabled
+  ChainIndex *chain_index_list_p;
+  
   // Used to mask off insignificant bits for computing the index
   uint64_t index_mask;
   
@@ -105,8 +180,220 @@ class HashTable_CA_SCC {
   KeyEqualityChecker key_eq_obj;
   LoadFactorCalculator lfc;
   
+  // Operation counters; See HashTable_OA_KVL
+  StatsType stats;
+  
+  // Receives resize events; Not owned by the table
+  TableEventListener *listener_p;
+  
+  // Limits memory of the table; Not owned by the table. It is charged
+  // GetMemorySize() bytes
+  MemoryBudget *budget_p;
+  
+  // Decides whether an entry found is moved to the chain head
+  ChainReorderPolicy chain_reorder;
+  
+  // Decides whether chains are indexed, and compares keys for the index
+  TreeifyPolicy treeify;
+  
+  // Slabs holding entries relocated by Compact(), including those taken
+  // over from merged tables. Entries not in a slab are allocated by new
+  std::vector<Slab> slab_list;
+  
+  // Whether Compact() is called after every rehash
+  bool compact_on_resize;
+  
  private:
-   
+  
+  /*
+   * FreeEntry() - Destroys an entry and frees its memory unless it is in
+   *               a slab
+   *
+   * There are only a few slabs since Compact() moves all entries into one
+   */
+  void FreeEntry(HashEntry *entry_p) {
+    for(const Slab &slab : slab_list) {
+      if((entry_p >= slab.entry_list_p) && \
+         (entry_p < slab.entry_list_p + slab.entry_count)) {
+        entry_p->~HashEntry();
+        
+        return;
+      }
+    }
+    
+    delete entry_p;
+    
+    return;
+  }
+  
+  /*
+   * FreeSlabs() - Frees memory of all slabs
+   *
+   * Entries in the slabs must have been destroyed
+   */
+  void FreeSlabs() {
+    for(const Slab &slab : slab_list) {
+      ::operator delete(slab.entry_list_p);
+    }
+    
+    slab_list.clear();
+    
+    return;
+  }
+  
+  /*
+   * IsEntryLess() - Compares entries by hash value and then key
+   */
+  inline bool IsEntryLess(const HashEntry *a_p, const HashEntry *b_p) const {
+    if(a_p->hash_value != b_p->hash_value) {
+      return a_p->hash_value < b_p->hash_value;
+    }
+    
+    return treeify(a_p->kv_pair.first, b_p->kv_pair.first);
+  }
+  
+  /*
+   * SearchSortedList() - Returns the index of the first entry on a sorted
+   *                      list that is not less than the hash value and key
+   *
+   * The number of entries compared is added to walk_count_p
+   */
+  uint64_t SearchSortedList(const std::vector<HashEntry *> &sorted_list,
+                            uint64_t hash_value,
+                            const KeyType &key,
+                            uint64_t *walk_count_p) const {
+    uint64_t low = 0;
+    uint64_t high = sorted_list.size();
+    
+    while(low < high) {
+      uint64_t mid = (low + high) >> 1;
+      const HashEntry *entry_p = sorted_list[mid];
+      
+      (*walk_count_p)++;
+      
+      if((entry_p->hash_value < hash_value) || \
+         ((entry_p->hash_value == hash_value) && \
+          (treeify(entry_p->kv_pair.first, key) == true))) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    
+    return low;
+  }
+  
+  /*
+   * Treeify() - Builds the sorted index of a chain
+   */
+  void Treeify(uint64_t index) {
+    ChainIndex *chain_index_p = chain_index_list_p + index;
+    assert(chain_index_p->sorted_list_p == nullptr);
+    
+    std::vector<HashEntry *> *sorted_list_p = new std::vector<HashEntry *>{};
+    sorted_list_p->reserve(chain_index_p->length);
+    
+    for(HashEntry *entry_p = entry_p_list_p[index];
+        entry_p != nullptr;
+        entry_p = entry_p->next_p) {
+      sorted_list_p->push_back(entry_p);
+    }
+    
+    // Stable sort keeps values of the same key in chain order
+    std::stable_sort(sorted_list_p->begin(),
+                     sorted_list_p->end(),
+                     [this](const HashEntry *a_p, const HashEntry *b_p) {
+                       return IsEntryLess(a_p, b_p);
+                     });
+    
+    chain_index_p->sorted_list_p = sorted_list_p;
+    
+    return;
+  }
+  
+  /*
+   * IndexNewHead() - Updates the index after an entry is linked as the head
+   *                  of a chain
+   *
+   * The chain is treeified if it reaches the threshold
+   */
+  void IndexNewHead(HashEntry *entry_p, uint64_t index) {
+    if(TreeifyPolicy::IS_ENABLED == false) {
+      return;
+    }
+    
+    ChainIndex *chain_index_p = chain_index_list_p + index;
+    chain_index_p->length++;
+    
+    std::vector<HashEntry *> *sorted_list_p = chain_index_p->sorted_list_p;
+    if(sorted_list_p != nullptr) {
+      // The head is the newest entry, and it goes before entries with the
+      // same key to keep the chain order
+      uint64_t walk_count = 0;
+      uint64_t pos = SearchSortedList(*sorted_list_p,
+                                      entry_p->hash_value,
+                                      entry_p->kv_pair.first,
+                                      &walk_count);
+      sorted_list_p->insert(sorted_list_p->begin() + pos, entry_p);
+    } else if(chain_index_p->length >= TreeifyPolicy::TREEIFY_THRESHOLD) {
+      Treeify(index);
+    }
+    
+    return;
+  }
+  
+  /*
+   * FreeChainIndex() - Frees the index of all chains
+   */
+  void FreeChainIndex() {
+    if(chain_index_list_p == nullptr) {
+      return;
+    }
+    
+    for(uint64_t i = 0;i < slot_count;i++) {
+      delete chain_index_list_p[i].sorted_list_p;
+    }
+    
+    delete[] chain_index_list_p;
+    chain_index_list_p = nullptr;
+    
+    return;
+  }
+  
+  /*
+   * BuildChainIndex() - Builds the index of all chains from scratch
+   *
+   * Chains that are shorter than the threshold are not treeified, which
+   * is how chains are converted back after being split by a rehash
+   */
+  void BuildChainIndex() {
+    assert(chain_index_list_p == nullptr);
+    
+    if(TreeifyPolicy::IS_ENABLED == false) {
+      return;
+    }
+    
+    chain_index_list_p = new ChainIndex[slot_count];
+    
+    for(uint64_t i = 0;i < slot_count;i++) {
+      uint64_t length = 0;
+      for(HashEntry *entry_p = entry_p_list_p[i];
+          entry_p != nullptr;
+          entry_p = entry_p->next_p) {
+        length++;
+      }
+      
+      chain_index_list_p[i].length = length;
+      chain_index_list_p[i].sorted_list_p = nullptr;
+      
+      if(length >= TreeifyPolicy::TREEIFY_THRESHOLD) {
+        Treeify(i);
+      }
+    }
+    
+    return;
+  }
+  
   /*
    * Resize() - Double the size of the array and scatter elements
    *            into their new position
@@ -118,11 +405,36 @@ class HashTable_CA_SCC {
     // Entry count is the number of HashEntry object
     assert(entry_count == resize_threshold);
     
+    Rehash(slot_count << 1);
+    
+    return;
+  }
+  
+  /*
+   * Rehash() - Scatters elements into a new array of the given size
+   *
+   * Entries are relinked rather than copied
+   */
+  void Rehash(uint64_t new_slot_count) {
+    assert((new_slot_count & (new_slot_count - 1)) == 0);
+    
+    uint64_t start_time = stats.GetTime();
+    
+    ResizeEvent event{slot_count, new_slot_count, entry_count, 0, 0};
+    uint64_t event_start_time = 0;
+    if(listener_p != nullptr) {
+      listener_p->OnResizeBegin(event);
+      event_start_time = TableEventListener::GetTime();
+    }
+    
+    // The index is rebuilt after entries are scattered
+    FreeChainIndex();
+    
     // Save old pointers in order to traverse using them
     HashEntry **old_p = entry_p_list_p;
     uint64_t old_slot_count = slot_count;
     
-    slot_count <<= 1;
+    slot_count = new_slot_count;
     index_mask = slot_count - 1;
     
     // Compute the new slot count after updating it
@@ -162,6 +474,21 @@ class HashTable_CA_SCC {
     // Must remove it after traversing all slots
     delete[] old_p;
     
+    if(compact_on_resize == true) {
+      // This also builds the index
+      Compact();
+    } else {
+      BuildChainIndex();
+    }
+    
+    stats.Add(StatsCounter::RESIZE);
+    stats.Add(StatsCounter::RESIZE_TIME_NS, stats.GetTime() - start_time);
+    
+    if(listener_p != nullptr) {
+      event.duration_ns = TableEventListener::GetTime() - event_start_time;
+      listener_p->OnResizeEnd(event);
+    }
+    
     return;
   }
   
@@ -174,11 +501,19 @@ class HashTable_CA_SCC {
                    const KeyHashFunc &p_key_hash_obj = KeyHashFunc{},
                    const KeyEqualityChecker &p_key_eq_obj = KeyEqualityChecker{},
                    const LoadFactorCalculator &p_lfc = LoadFactorCalculator{}) :
+    chain_index_list_p{nullptr},
     slot_count{p_slot_count},
     entry_count{0},
     key_hash_obj{p_key_hash_obj},
     key_eq_obj{p_key_eq_obj},
-    lfc{p_lfc} {
+    lfc{p_lfc},
+    stats{},
+    listener_p{nullptr},
+    budget_p{nullptr},
+    chain_reorder{},
+    treeify{},
+    slab_list{},
+    compact_on_resize{false} {
     // First round it up to power of 2
     int leading_zero = __builtin_clzl(slot_count);
     int effective_bits = 64 - leading_zero;
@@ -200,6 +535,8 @@ class HashTable_CA_SCC {
     entry_p_list_p = new HashEntry*[slot_count];
     memset(entry_p_list_p, 0x0, sizeof(void *) * slot_count);
     
+    BuildChainIndex();
+    
     dbg_printf("Slot count = %lu\n", slot_count);
     
     return;
@@ -222,7 +559,7 @@ class HashTable_CA_SCC {
         HashEntry *temp = entry_p->next_p;
 
         // Then free the entry
-        delete entry_p;
+        FreeEntry(entry_p);
 
         // Use this to continue looping
         entry_p = temp;
@@ -232,15 +569,173 @@ class HashTable_CA_SCC {
     // Also free the pointer array
     delete[] entry_p_list_p;
     
+    if(budget_p != nullptr) {
+      budget_p->Release(GetMemorySize());
+    }
+    
+    FreeChainIndex();
+    FreeSlabs();
+    
+    return;
+  }
+  
+  // The implicit copy would share entries; Use Clone() instead
+  HashTable_CA_SCC(const HashTable_CA_SCC &) = delete;
+  HashTable_CA_SCC &operator=(const HashTable_CA_SCC &) = delete;
+  
+  /*
+   * Move Constructor - Takes over the entries of another table in O(1)
+   *
+   * The other table is left without a slot array, and could only be
+   * destroyed or assigned to
+   */
+  HashTable_CA_SCC(HashTable_CA_SCC &&other) :
+    entry_p_list_p{other.entry_p_list_p},
+    chain_index_list_p{other.chain_index_list_p},
+    index_mask{other.index_mask},
+    slot_count{other.slot_count},
+    entry_count{other.entry_count},
+    resize_threshold{other.resize_threshold},
+    key_hash_obj{other.key_hash_obj},
+    key_eq_obj{other.key_eq_obj},
+    lfc{other.lfc},
+    stats{std::move(other.stats)},
+    listener_p{other.listener_p},
+    budget_p{other.budget_p},
+    chain_reorder{other.chain_reorder},
+    treeify{other.treeify},
+    slab_list{std::move(other.slab_list)},
+    compact_on_resize{other.compact_on_resize} {
+    other.entry_p_list_p = nullptr;
+    other.chain_index_list_p = nullptr;
+    other.index_mask = 0;
+    other.slot_count = 0;
+    other.entry_count = 0;
+    other.resize_threshold = 0;
+    other.listener_p = nullptr;
+    other.budget_p = nullptr;
+    other.slab_list.clear();
+    
+    return;
+  }
+  
+  /*
+   * Move Assignment - Swaps content with the other table
+   *
+   * The previous content of this table is freed when the other table
+   * is destroyed
+   */
+  HashTable_CA_SCC &operator=(HashTable_CA_SCC &&other) {
+    Swap(other);
+    
+    return *this;
+  }
+  
+  /*
+   * Swap() - Swaps content of two tables in O(1)
+   *
+   * Iterators remain valid and refer to the same elements, which are now
+   * in the other table
+   */
+  void Swap(HashTable_CA_SCC &other) {
+    std::swap(entry_p_list_p, other.entry_p_list_p);
+    std::swap(chain_index_list_p, other.chain_index_list_p);
+    std::swap(index_mask, other.index_mask);
+    std::swap(slot_count, other.slot_count);
+    std::swap(entry_count, other.entry_count);
+    std::swap(resize_threshold, other.resize_threshold);
+    std::swap(key_hash_obj, other.key_hash_obj);
+    std::swap(key_eq_obj, other.key_eq_obj);
+    std::swap(lfc, other.lfc);
+    stats.Swap(other.stats);
+    std::swap(listener_p, other.listener_p);
+    std::swap(budget_p, other.budget_p);
+    std::swap(chain_reorder, other.chain_reorder);
+    std::swap(treeify, other.treeify);
+    slab_list.swap(other.slab_list);
+    std::swap(compact_on_resize, other.compact_on_resize);
+    
     return;
   }
+  
+  /*
+   * Clone() - Returns a deep copy of the table
+   *
+   * The copy has the same number of slots and the same order on every
+   * collision chain. Entries are allocated one by one so they are copy
+   * constructed
+   */
+  HashTable_CA_SCC Clone() const {
+    HashTable_CA_SCC ret{1, key_hash_obj, key_eq_obj, lfc};
+    ret.Rehash(slot_count);
+    
+    for(uint64_t i = 0;i < slot_count;i++) {
+      // Append to the tail to preserve the order on the chain
+      HashEntry **tail_p_p = ret.entry_p_list_p + i;
+      
+      for(HashEntry *entry_p = entry_p_list_p[i];
+          entry_p != nullptr;
+          entry_p = entry_p->next_p) {
+        *tail_p_p = new HashEntry{entry_p->hash_value,
+                                  nullptr,
+                                  entry_p->kv_pair.first,
+                                  entry_p->kv_pair.second};
+        tail_p_p = &(*tail_p_p)->next_p;
+      }
+    }
+    
+    ret.entry_count = entry_count;
+    
+    // Chains are copied directly, so the index is built afterwards
+    ret.treeify = treeify;
+    ret.compact_on_resize = compact_on_resize;
+    ret.FreeChainIndex();
+    ret.BuildChainIndex();
+    
+    // Counters of the copy start from zero, and it has no listener or
+    // memory budget
+    ret.ResetStats();
+    
+    return ret;
+  }
 
   /*
    * Insert() - Adds a key value pair into the table
    *
    * This operation does not invalidate any iterator on existing entries
+   *
+   * Returns false without inserting if the entry, or the larger slot array
+   * if the table has to grow, does not fit into the memory budget. Always
+   * returns true if there is no budget
+   */
+  inline bool Insert(const KeyType &key, const ValueType &value) {
+    return InsertWithHash(key, key_hash_obj(key), value);
+  }
+  
+  /*
+   * InsertWithHash() - Adds a key value pair whose hash value has been
+   *                    computed by the caller
+   *
+   * hash_value is stored in the entry and used on resize, merge and by
+   * sorted chain indexes, so every access to the table must use the same
+   * hash function; It must be equal to key_hash_obj(key) if functions that
+   * hash the key are also called. The slot index is the lowest bits of the
+   * hash (hash_value & index_mask), so callers could partition rows by the
+   * highest bits of the same hash
    */
-  void Insert(const KeyType &key, const ValueType &value) {
+  bool InsertWithHash(const KeyType &key,
+                      uint64_t hash_value,
+                      const ValueType &value) {
+    uint64_t size = sizeof(HashEntry);
+    if(entry_count == resize_threshold) {
+      // The slot array is doubled
+      size += slot_count * sizeof(HashEntry *);
+    }
+    
+    if((budget_p != nullptr) && (budget_p->TryReserve(size) == false)) {
+      return false;
+    }
+    
     // Let's resize
     if(entry_count == resize_threshold) {
       Resize();
@@ -250,7 +745,6 @@ class HashTable_CA_SCC {
       assert(entry_count < resize_threshold);
     }
     
-    uint64_t hash_value = key_hash_obj(key);
     uint64_t index = index_mask & hash_value;
     
     // We do not initialize its next_p since it will not be relied on
@@ -260,58 +754,799 @@ class HashTable_CA_SCC {
     
     // Assign the entry as the first element of the collision chain
     entry_p_list_p[index] = entry_p;
+    IndexNewHead(entry_p, index);
     
     // Do not forget this
     entry_count++;
     
-    return;
+    stats.Add(StatsCounter::INSERT);
+    
+    return true;
   }
   
   /*
-   * GetValue() - For a given key, invoke the given call back on the key
-   *              value pair associated with the entry
+   * Merge() - Moves all key value pairs of another table into this table
    *
-   * Note that this function might cause a resize if during the traversal
-   * the delta chain is larger
+   * Entries of the other table are relinked onto the chains of this table,
+   * so no key or value is copied and no memory is allocated except for the
+   * slot array which is grown at most once. Since chains do not group values
+   * of the same key, keys existing in both tables need no special handling
+   *
+   * Both tables must use the same hash function, since hash values cached
+   * in entries are reused. The other table is left empty but valid
    */
-  void GetValue(const KeyType &key,
-                std::function<void(const std::pair<KeyType, ValueType> &)> cb) {
-    uint64_t hash_value = key_hash_obj(key);
-    uint64_t index = index_mask & hash_value;
-
-    HashEntry *entry_p = entry_p_list_p[index];
-
-    // Then loop through the collision chain and check hash value
-    // as well as key to find values associated with it
-    while(entry_p != nullptr) {
-            
-      if(key_eq_obj(key, entry_p->kv_pair.first) == true) {
-        cb(entry_p->kv_pair);
+  void Merge(HashTable_CA_SCC &&other) {
+    assert(&other != this);
+    
+    // Memory is moved between budgets afterwards, which could not fail
+    uint64_t old_size = GetMemorySize();
+    uint64_t other_old_size = other.GetMemorySize();
+    
+    // Grow once such that the merged entries do not trigger a resize
+    uint64_t new_slot_count = slot_count;
+    while(lfc(new_slot_count) <= entry_count + other.entry_count) {
+      new_slot_count <<= 1;
+    }
+    
+    if(new_slot_count != slot_count) {
+      Rehash(new_slot_count);
+    }
+    
+    for(uint64_t i = 0;i < other.slot_count;i++) {
+      HashEntry *entry_p = other.entry_p_list_p[i];
+      
+      while(entry_p != nullptr) {
+        uint64_t index = entry_p->hash_value & index_mask;
+        HashEntry *next_p = entry_p->next_p;
+        
+        entry_p->next_p = entry_p_list_p[index];
+        entry_p_list_p[index] = entry_p;
+        IndexNewHead(entry_p, index);
+        
+        entry_p = next_p;
       }
       
-      // Immediately go to the next element
-      entry_p = entry_p->next_p;
+      other.entry_p_list_p[i] = nullptr;
+    }
+    
+    entry_count += other.entry_count;
+    other.entry_count = 0;
+    
+    // All chains of the other table are empty
+    other.FreeChainIndex();
+    other.BuildChainIndex();
+    
+    // Entries in slabs of the other table are now owned by this table
+    slab_list.insert(slab_list.end(),
+                     other.slab_list.begin(),
+                     other.slab_list.end());
+    other.slab_list.clear();
+    
+    if(budget_p != nullptr) {
+      budget_p->Charge(GetMemorySize() - old_size);
+    }
+    
+    if(other.budget_p != nullptr) {
+      other.budget_p->Release(other_old_size - other.GetMemorySize());
     }
     
     return;
   }
   
   /*
-   * GetValue() - Return all value elements in a vector
+   * MergeDisjoint() - Same as Merge()
+   *
+   * This is provided to have the same interface as open addressing tables,
+   * for which merging tables with disjoint key sets is cheaper
    */
-  void GetValue(const KeyType &key, std::vector<ValueType> *value_list_p) {
-    // Call the GetValue() with a call back defined as lambda function
-    // that pushes each individual value into the list
-    GetValue(key,
-             [value_list_p](const std::pair<KeyType, ValueType> &kv_pair) {
-               value_list_p->push_back(kv_pair.second);
-               
-               return;
-             });
+  void MergeDisjoint(HashTable_CA_SCC &&other) {
+    Merge(std::move(other));
     
     return;
   }
-
+  
+  /*
+   * Compact() - Relocates all entries into a single slab in bucket order
+   *
+   * Entries of slot 0 come first in chain order, followed by those of slot 1
+   * and so on. Keys and values are moved into the new slab, and the old
+   * entries and slabs are freed. This takes O(n) time and one allocation
+   *
+   * This function invalidates all iterators and pointers to values
+   */
+  void Compact() {
+    FreeChainIndex();
+    
+    Slab new_slab{nullptr, entry_count};
+    if(entry_count > 0) {
+      new_slab.entry_list_p = static_cast<HashEntry *>(
+        ::operator new(sizeof(HashEntry) * entry_count));
+    }
+    
+    uint64_t next_index = 0;
+    for(uint64_t i = 0;i < slot_count;i++) {
+      // The pointer to be updated when the current entry is relocated
+      HashEntry **prev_next_p_p = entry_p_list_p + i;
+      
+      while(*prev_next_p_p != nullptr) {
+        HashEntry *entry_p = *prev_next_p_p;
+        
+        assert(next_index < entry_count);
+        HashEntry *new_entry_p = \
+          new (new_slab.entry_list_p + next_index) \
+            HashEntry{entry_p->hash_value,
+                      entry_p->next_p,
+                      std::move(entry_p->kv_pair)};
+        next_index++;
+        
+        *prev_next_p_p = new_entry_p;
+        prev_next_p_p = &new_entry_p->next_p;
+        
+        FreeEntry(entry_p);
+      }
+    }
+    
+    assert(next_index == entry_count);
+    
+    FreeSlabs();
+    if(new_slab.entry_list_p != nullptr) {
+      slab_list.push_back(new_slab);
+    }
+    
+    // The index points to entries, so it is rebuilt
+    BuildChainIndex();
+    
+    return;
+  }
+  
+  /*
+   * SetCompactOnResize() - Sets whether Compact() is called after every
+   *                        rehash
+   *
+   * If enabled, an Insert() that triggers a resize invalidates pointers to
+   * values in addition to iterators
+   */
+  void SetCompactOnResize(bool p_compact_on_resize) {
+    compact_on_resize = p_compact_on_resize;
+    
+    return;
+  }
+  
+  /*
+   * GetValue() - For a given key, invoke the given call back on the key
+   *              value pair associated with the entry
+   *
+   * Note that this function might cause a resize if during the traversal
+   * the delta chain is larger
+   */
+  inline void GetValue(
+    const KeyType &key,
+    std::function<void(const std::pair<KeyType, ValueType> &)> cb) {
+    GetValueWithHash(key, key_hash_obj(key), cb);
+    
+    return;
+  }
+  
+  /*
+   * GetValueWithHash() - Invokes the call back on values of a key whose hash
+   *                      value has been computed by the caller, as
+   *                      InsertWithHash()
+   */
+  void GetValueWithHash(
+    const KeyType &key,
+    uint64_t hash_value,
+    std::function<void(const std::pair<KeyType, ValueType> &)> cb) {
+    uint64_t index = index_mask & hash_value;
+
+    HashEntry *entry_p = entry_p_list_p[index];
+    
+    // Number of entries walked and keys compared; Only used for stats
+    uint64_t walk_count = 0;
+    uint64_t compare_count = 0;
+    
+    if((TreeifyPolicy::IS_ENABLED == true) && \
+       (chain_index_list_p[index].sorted_list_p != nullptr)) {
+      const std::vector<HashEntry *> &sorted_list = \
+        *chain_index_list_p[index].sorted_list_p;
+      
+      uint64_t pos = SearchSortedList(sorted_list, hash_value, key, &walk_count);
+      while((pos < sorted_list.size()) && \
+            (sorted_list[pos]->hash_value == hash_value) && \
+            (key_eq_obj(key, sorted_list[pos]->kv_pair.first) == true)) {
+        cb(sorted_list[pos]->kv_pair);
+        
+        pos++;
+        walk_count++;
+      }
+      
+      // The binary search only compares keys of the same hash value
+      RecordLookup(walk_count, walk_count);
+      
+      return;
+    }
+
+    // Then loop through the collision chain and check hash value
+    // as well as key to find values associated with it
+    while(entry_p != nullptr) {
+      if(entry_p->hash_value == hash_value) {
+        compare_count++;
+        
+        if(key_eq_obj(key, entry_p->kv_pair.first) == true) {
+          cb(entry_p->kv_pair);
+        }
+      }
+      
+      // Immediately go to the next element
+      entry_p = entry_p->next_p;
+      walk_count++;
+    }
+    
+    RecordLookup(walk_count, compare_count);
+    
+    return;
+  }
+  
+  /*
+   * GetFirstValue() - Returns a pointer to the first value of the key on its
+   *                   chain, or nullptr if the key does not exist
+   *
+   * Unlike GetValue(), the walk stops at the first match, so its cost
+   * depends on the position of the key. If the reorder policy agrees, the
+   * entry found is moved to the head of the chain. This changes the order
+   * of values of the same key and the order of iteration, but does not
+   * invalidate pointers to values
+   */
+  inline ValueType *GetFirstValue(const KeyType &key) {
+    return GetFirstValueWithHash(key, key_hash_obj(key));
+  }
+  
+  /*
+   * GetFirstValueWithHash() - Returns the first value of a key whose hash
+   *                           value has been computed by the caller
+   */
+  ValueType *GetFirstValueWithHash(const KeyType &key, uint64_t hash_value) {
+    uint64_t index = index_mask & hash_value;
+    
+    // Treeified chains are not reordered since lookups on them do not
+    // depend on the position
+    if((TreeifyPolicy::IS_ENABLED == true) && \
+       (chain_index_list_p[index].sorted_list_p != nullptr)) {
+      const std::vector<HashEntry *> &sorted_list = \
+        *chain_index_list_p[index].sorted_list_p;
+      
+      uint64_t walk_count = 0;
+      uint64_t pos = SearchSortedList(sorted_list, hash_value, key, &walk_count);
+      
+      RecordLookup(walk_count, walk_count);
+      
+      if((pos < sorted_list.size()) && \
+         (sorted_list[pos]->hash_value == hash_value) && \
+         (key_eq_obj(key, sorted_list[pos]->kv_pair.first) == true)) {
+        return &sorted_list[pos]->kv_pair.second;
+      }
+      
+      return nullptr;
+    }
+    
+    // Head of the chain, and the pointer to the entry being checked
+    HashEntry **head_p_p = entry_p_list_p + index;
+    HashEntry **prev_next_p_p = head_p_p;
+    
+    uint64_t position = 0;
+    uint64_t compare_count = 0;
+    while(*prev_next_p_p != nullptr) {
+      HashEntry *entry_p = *prev_next_p_p;
+      
+      if(entry_p->hash_value == hash_value) {
+        compare_count++;
+        
+        if(key_eq_obj(key, entry_p->kv_pair.first) == true) {
+          RecordLookup(position + 1, compare_count);
+          
+          if(chain_reorder(position) == true) {
+            // Unlink and insert at the head
+            *prev_next_p_p = entry_p->next_p;
+            entry_p->next_p = *head_p_p;
+            *head_p_p = entry_p;
+          }
+          
+          return &entry_p->kv_pair.second;
+        }
+      }
+      
+      prev_next_p_p = &entry_p->next_p;
+      position++;
+    }
+    
+    RecordLookup(position, compare_count);
+    
+    return nullptr;
+  }
+  
+ private:
+  
+  /*
+   * RecordLookup() - Counts a lookup with the number of entries walked and
+   *                  keys compared
+   *
+   * Keys are only compared on entries whose hash value matches
+   */
+  inline void RecordLookup(uint64_t walk_count, uint64_t compare_count) {
+    stats.Add(StatsCounter::LOOKUP);
+    stats.Add(StatsCounter::CHAIN_WALK, walk_count);
+    stats.Add(StatsCounter::KEY_COMPARE, compare_count);
+    
+    return;
+  }
+  
+ public:
+  
+  /*
+   * GetStats() - Returns the current value of operation counters
+   */
+  OperationStatsSnapshot GetStats() const {
+    return stats.GetSnapshot();
+  }
+  
+  /*
+   * ResetStats() - Sets all operation counters to zero
+   */
+  void ResetStats() {
+    stats.Reset();
+    
+    return;
+  }
+  
+  /*
+   * GetMemorySize() - Returns the size of the slot array and all entries
+   *                   in bytes
+   *
+   * Chain indices and unused space in slabs are not included
+   */
+  uint64_t GetMemorySize() const {
+    return slot_count * sizeof(HashEntry *) + entry_count * sizeof(HashEntry);
+  }
+  
+  /*
+   * SetMemoryBudget() - Charges memory of the table to a budget, or removes
+   *                     the budget if nullptr is given
+   *
+   * See HashTable_OA_KVL::SetMemoryBudget()
+   */
+  void SetMemoryBudget(MemoryBudget *p_budget_p) {
+    if(budget_p != nullptr) {
+      budget_p->Release(GetMemorySize());
+    }
+    
+    budget_p = p_budget_p;
+    if(budget_p != nullptr) {
+      budget_p->Charge(GetMemorySize());
+    }
+    
+    return;
+  }
+  
+  /*
+   * SetEventListener() - Registers a listener for resize events, or removes
+   *                      it if nullptr is given
+   *
+   * See HashTable_OA_KVL::SetEventListener()
+   */
+  void SetEventListener(TableEventListener *p_listener_p) {
+    listener_p = p_listener_p;
+    
+    return;
+  }
+  
+  /*
+   * GetChainStats() - Returns the distribution of chain lengths and the
+   *                   number of values per key
+   *
+   * This walks every chain, and is only intended for profiling
+   */
+  ChainStats GetChainStats() const {
+    ChainStats chain_stats{slot_count};
+    std::vector<std::pair<uint64_t, const KeyType *>> chain{};
+    
+    for(uint64_t i = 0;i < slot_count;i++) {
+      chain.clear();
+      
+      for(const HashEntry *entry_p = entry_p_list_p[i];
+          entry_p != nullptr;
+          entry_p = entry_p->next_p) {
+        chain.emplace_back(entry_p->hash_value, &entry_p->kv_pair.first);
+      }
+      
+      chain_stats.AddChain(&chain, key_eq_obj);
+      
+      if((TreeifyPolicy::IS_ENABLED == true) && \
+         (chain_index_list_p[i].sorted_list_p != nullptr)) {
+        chain_stats.treeified_slot_count++;
+      }
+    }
+    
+    return chain_stats;
+  }
+  
+  /*
+   * GetValue() - Return all value elements in a vector
+   */
+  void GetValue(const KeyType &key, std::vector<ValueType> *value_list_p) {
+    // Call the GetValue() with a call back defined as lambda function
+    // that pushes each individual value into the list
+    GetValue(key,
+             [value_list_p](const std::pair<KeyType, ValueType> &kv_pair) {
+               value_list_p->push_back(kv_pair.second);
+               
+               return;
+             });
+    
+    return;
+  }
+  
+ private:
+  
+  /*
+   * class InterleavedChainState - The state machine of a collision chain walk
+   *                               that is executed by RunInterleaved()
+   *
+   * The walk suspends once after prefetching the slot, and then once after
+   * prefetching each entry on the chain, since every hop on the chain is
+   * likely a cache miss
+   */
+  template <typename CallbackType>
+  class InterleavedChainState {
+   private:
+    HashTable_CA_SCC *table_p;
+    const KeyType *key_list;
+    CallbackType *cb_p;
+    
+    // Index of the key in the key list and its hash value
+    uint64_t key_index;
+    uint64_t hash_value;
+    
+    // The slot being read before the walk begins; nullptr after that
+    HashEntry **slot_p;
+    
+    // The entry to be examined in the next step
+    HashEntry *entry_p;
+    
+   public:
+    
+    /*
+     * Init() - Sets up the context shared by all tasks
+     */
+    void Init(HashTable_CA_SCC *p_table_p,
+              const KeyType *p_key_list,
+              CallbackType *p_cb_p) {
+      table_p = p_table_p;
+      key_list = p_key_list;
+      cb_p = p_cb_p;
+      
+      return;
+    }
+    
+    /*
+     * Start() - Computes the slot and prefetches it
+     */
+    void Start(uint64_t p_key_index) {
+      key_index = p_key_index;
+      
+      hash_value = table_p->key_hash_obj(key_list[key_index]);
+      slot_p = table_p->entry_p_list_p + (hash_value & table_p->index_mask);
+      
+      PrefetchForRead(slot_p);
+      
+      return;
+    }
+    
+    /*
+     * Step() - Reads the slot or examines one entry on the chain, and
+     *          prefetches the next entry
+     */
+    bool Step() {
+      if(slot_p != nullptr) {
+        entry_p = *slot_p;
+        slot_p = nullptr;
+      } else {
+        if((entry_p->hash_value == hash_value) && \
+           (table_p->key_eq_obj(key_list[key_index],
+                                entry_p->kv_pair.first) == true)) {
+          (*cb_p)(key_index, entry_p->kv_pair);
+        }
+        
+        entry_p = entry_p->next_p;
+      }
+      
+      // End of the chain
+      if(entry_p == nullptr) {
+        return true;
+      }
+      
+      PrefetchForRead(entry_p);
+      
+      return false;
+    }
+  };
+  
+ public:
+  
+  /*
+   * GetValueInterleaved() - Searches a batch of keys, interleaving their
+   *                         chain walks to overlap cache misses
+   *
+   * For each key value pair whose key is in the key list, the call back is
+   * invoked as:
+   *
+   *   cb(key_index, const std::pair<KeyType, ValueType> &)
+   *
+   * Call backs for different keys are interleaved, but those for the same
+   * key are invoked in the same order as GetValue()
+   *
+   * group_size is the number of chain walks in flight
+   */
+  template <uint64_t group_size = DEFAULT_INTERLEAVE_GROUP_SIZE,
+            typename CallbackType>
+  void GetValueInterleaved(const KeyType *key_list,
+                           uint64_t key_count,
+                           CallbackType cb) {
+    InterleavedChainState<CallbackType> state_list[group_size];
+    for(uint64_t i = 0;i < group_size;i++) {
+      state_list[i].Init(this, key_list, &cb);
+    }
+    
+    RunInterleaved<group_size>(state_list, key_count);
+    
+    // Chain walks of interleaved lookups are not counted
+    stats.Add(StatsCounter::LOOKUP, key_count);
+    
+    return;
+  }
+  
+  /*
+   * class GenericIterator - Iterates through the hash table
+   *
+   * Since collision chains are not connected across slots, the iterator
+   * remembers the slot it is currently on as well as the end of the slot
+   * array, and when it reaches the end of a chain, it scans forward for the
+   * next non-empty slot. The end iterator has entry_p being nullptr and
+   * slot_p pointing to the end of the slot array
+   *
+   * Dereferencing the iterator yields the key value pair with a const key,
+   * as in standard associative containers, since modifying the key would
+   * leave the entry on the wrong collision chain with a stale hash value
+   */
+  template <typename IteratorValueType>
+  class GenericIterator {
+    friend class HashTable_CA_SCC;
+    
+    // Allows conversion from iterator to const_iterator
+    template <typename>
+    friend class GenericIterator;
+    
+   public:
+    
+    // Types required by std::iterator_traits
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename std::remove_const<IteratorValueType>::type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = IteratorValueType *;
+    using reference = IteratorValueType &;
+    
+   private:
+    // The slot that entry_p is on
+    HashEntry **slot_p;
+    
+    // One past the last slot in the array
+    HashEntry **slot_end_p;
+    
+    // The current entry; nullptr for the end iterator
+    HashEntry *entry_p;
+    
+    /*
+     * SkipEmptySlots() - If the current entry is nullptr, then move to the
+     *                    first entry of the next non-empty slot
+     *
+     * If there is no more non-empty slot then the iterator becomes
+     * the end iterator
+     */
+    void SkipEmptySlots() {
+      while(entry_p == nullptr) {
+        slot_p++;
+        if(slot_p == slot_end_p) {
+          break;
+        }
+        
+        entry_p = *slot_p;
+      }
+      
+      return;
+    }
+    
+   public:
+    
+    /*
+     * Default Constructor - Constructs a singular iterator
+     */
+    GenericIterator() :
+      slot_p{nullptr},
+      slot_end_p{nullptr},
+      entry_p{nullptr}
+    {}
+    
+    /*
+     * Constructor
+     */
+    GenericIterator(HashEntry **p_slot_p,
+                    HashEntry **p_slot_end_p,
+                    HashEntry *p_entry_p) :
+      slot_p{p_slot_p},
+      slot_end_p{p_slot_end_p},
+      entry_p{p_entry_p}
+    {}
+    
+    /*
+     * Converting Constructor - Builds a const_iterator from an iterator
+     */
+    template <typename OtherValueType,
+              typename = typename std::enable_if<
+                std::is_convertible<OtherValueType *,
+                                    IteratorValueType *>::value>::type>
+    GenericIterator(const GenericIterator<OtherValueType> &other) :
+      slot_p{other.slot_p},
+      slot_end_p{other.slot_end_p},
+      entry_p{other.entry_p}
+    {}
+    
+    /*
+     * Prefix operator++() - Advances the iterator by one element
+     *
+     * This is not constant time since we might need to skip empty slots
+     */
+    GenericIterator &operator++() {
+      entry_p = entry_p->next_p;
+      SkipEmptySlots();
+      
+      return *this;
+    }
+    
+    /*
+     * Postfix operator++() - Advances the iterator by one element
+     *                        and return the value before ++ operation
+     */
+    GenericIterator operator++(int) {
+      GenericIterator ret = *this;
+      
+      ++(*this);
+      
+      return ret;
+    }
+    
+    /*
+     * operator==() - Compares two iterators for equality
+     *
+     * Since every entry is on exactly one chain, comparing the entry pointer
+     * is sufficient. All end iterators have nullptr as the entry
+     */
+    bool operator==(const GenericIterator &other) const {
+      return entry_p == other.entry_p;
+    }
+    
+    /*
+     * operator!=() - Compares two iterators for non-equality
+     */
+    bool operator!=(const GenericIterator &other) const {
+      return entry_p != other.entry_p;
+    }
+    
+    /*
+     * operator*() - Returns a reference to the key value pair
+     *
+     * The pair stored in the entry is viewed with a const key; Both pair
+     * types have the same layout
+     */
+    reference operator*() const {
+      return reinterpret_cast<reference>(entry_p->kv_pair);
+    }
+    
+    /*
+     * operator->() - Member access on the key value pair
+     */
+    pointer operator->() const {
+      return reinterpret_cast<pointer>(&entry_p->kv_pair);
+    }
+    
+    /*
+     * GetHashValue() - Returns the hash value of the key stored in the entry
+     *
+     * This allows the entry to be moved into another table or a spill file
+     * without hashing the key again
+     */
+    uint64_t GetHashValue() const {
+      return entry_p->hash_value;
+    }
+  };
+  
+  // The key value pair seen through iterators
+  using IteratorPairType = std::pair<const KeyType, ValueType>;
+  
+  static_assert((sizeof(IteratorPairType) == \
+                 sizeof(std::pair<KeyType, ValueType>)) && \
+                (alignof(IteratorPairType) == \
+                 alignof(std::pair<KeyType, ValueType>)),
+                "Stored pairs are viewed as pairs with a const key");
+  
+  // Iterators that conform to the standard naming
+  using iterator = GenericIterator<IteratorPairType>;
+  using const_iterator = GenericIterator<const IteratorPairType>;
+  
+ private:
+  
+  /*
+   * BuildBeginIterator() - Returns an iterator on the first entry of the
+   *                        first non-empty slot
+   */
+  template <typename IteratorType>
+  IteratorType BuildBeginIterator() const {
+    IteratorType it{entry_p_list_p, entry_p_list_p + slot_count, *entry_p_list_p};
+    
+    // If the first slot is empty then scan forward
+    it.SkipEmptySlots();
+    
+    return it;
+  }
+  
+ public:
+  
+  /*
+   * begin() - Returns an iterator to the first entry in the table
+   *
+   * This operation is linear to the number of empty slots before the first
+   * non-empty one
+   */
+  inline iterator begin() {
+    return BuildBeginIterator<iterator>();
+  }
+  
+  /*
+   * end() - Returns an iterator past the last entry of the table
+   */
+  inline iterator end() {
+    return iterator{entry_p_list_p + slot_count,
+                    entry_p_list_p + slot_count,
+                    nullptr};
+  }
+  
+  /*
+   * begin() const - Returns a const_iterator to the first entry
+   */
+  inline const_iterator begin() const {
+    return BuildBeginIterator<const_iterator>();
+  }
+  
+  /*
+   * end() const - Returns a const_iterator past the last entry
+   */
+  inline const_iterator end() const {
+    return const_iterator{entry_p_list_p + slot_count,
+                          entry_p_list_p + slot_count,
+                          nullptr};
+  }
+  
+  /*
+   * cbegin() - Returns a const_iterator even if the table is not const
+   */
+  inline const_iterator cbegin() const {
+    return begin();
+  }
+  
+  /*
+   * cend() - Returns a const_iterator to the end even if the table is
+   *          not const
+   */
+  inline const_iterator cend() const {
+    return end();
+  }
 };
 
 }
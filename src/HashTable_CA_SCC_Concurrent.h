@@ -0,0 +1,666 @@
+
+#pragma once
+
+#include <cstdio>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <functional>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "EpochManager.h"
+#include "OperationStats.h"
+
+namespace peloton {
+namespace index {
+
+#include "common.h"
+
+/*
+ * class HashTable_CA_SCC_Concurrent - Concurrent version of HashTable_CA_SCC
+ *                                     with a spinlock embedded in each slot
+ *
+ * The directory array holds the head pointer of each collision chain. Since
+ * HashEntry objects are at least 8 byte aligned, the lowest bit of the head
+ * pointer is always zero, and it is used as the spinlock of the slot:
+ *
+ *   1. Writers lock a slot by setting the bit with CAS, link the new entry
+ *      in front of the chain, and then store the new head pointer with the
+ *      bit cleared, which publishes the entry and unlocks the slot in one
+ *      release store
+ *   2. Readers never lock. They mask off the bit and traverse the chain using
+ *      acquire loads on next pointers. An entry is never modified after it is
+ *      published, so readers either see it entirely or not at all
+ *
+ * Resize() is serialized by a global mutex. The thread doing resize locks
+ * the slots of the current directory one by one, which waits for writers
+ * that are inside a slot and stops new ones, and splits each chain into the
+ * two slots of a new directory. Entries are never modified after they are
+ * published, so the trailing run of a chain whose entries all go to the same
+ * new slot is shared by both directories, and only entries before the run
+ * are copied. Readers walking the old chains are therefore not disturbed.
+ * Slots in the old directory are never unlocked after the new directory is
+ * published, and writers waiting on them retry on the new directory. The old
+ * directory and the entries that have been copied are freed through the
+ * epoch manager after all threads that could have seen them are gone.
+ * Writers resize after leaving their epoch and reclaim right after
+ * publishing the new directory, so at most the generations still being read
+ * are kept
+ *
+ * The number of entries is not counted by a shared counter on every insert,
+ * which would put all writers on one cache line. Each thread counts its own
+ * inserts, and adds them to the shared counter and checks the resize
+ * threshold once every COUNT_BATCH_SIZE inserts
+ *
+ * All threads, readers and writers, must register to obtain a thread ID
+ * which is passed to every operation. Like HashTable_CA_SCC this table does
+ * not support removal
+ */
+template <typename KeyType,
+          typename ValueType,
+          typename KeyHashFunc = std::hash<KeyType>,
+          typename KeyEqualityChecker = std::equal_to<KeyType>,
+          typename LoadFactorCalculator = LoadFactorPercent<400>,
+          typename StatsType = NoStats>
+class HashTable_CA_SCC_Concurrent {
+ private:
+
+  // The size of a typical page
+  static constexpr uint64_t PAGE_SIZE = 4096;
+
+  // Let the first array fill one entire page
+  static constexpr uint64_t INIT_SLOT_COUNT = PAGE_SIZE / sizeof(void *);
+
+  // The bit in the slot that works as a spinlock
+  static constexpr uintptr_t LOCK_BIT = 0x1;
+
+  // Number of failed attempts to lock before yielding the CPU
+  static constexpr uint64_t SPIN_COUNT_BEFORE_YIELD = 64;
+
+  // Number of inserts a thread counts locally before adding them to the
+  // shared entry count
+  static constexpr uint64_t COUNT_BATCH_SIZE = 64;
+
+  // The size of a cache line to pad per-thread counters
+  static constexpr uint64_t CACHE_LINE_SIZE = 64;
+
+  /*
+   * class HashEntry - The hash entry for holding key and value
+   */
+  class HashEntry {
+   public:
+    // Hash value for fast objecy comparison
+    uint64_t hash_value;
+
+    // Pointer to the next entry in the collision chain
+    std::atomic<HashEntry *> next_p;
+
+    std::pair<KeyType, ValueType> kv_pair;
+
+    /*
+     * Constructor
+     */
+    HashEntry(uint64_t p_hash_value,
+              HashEntry *p_next_p,
+              const KeyType &key,
+              const ValueType &value) :
+      hash_value{p_hash_value},
+      next_p{p_next_p},
+      kv_pair{key, value}
+    {}
+  };
+
+  static_assert(alignof(HashEntry) > LOCK_BIT,
+                "The lowest bit of entry pointers must be zero");
+
+  /*
+   * class Directory - The slot array together with its size
+   *
+   * Size, mask and threshold are stored with the array such that threads
+   * always observe a consistent combination by loading one pointer
+   */
+  class Directory {
+   public:
+    uint64_t slot_count;
+    uint64_t index_mask;
+
+    // Resize is triggered when the entry count exceeds this, which is when
+    // HashTable_CA_SCC resizes
+    uint64_t resize_threshold;
+
+    // Each slot is a HashEntry pointer with the lock bit
+    std::atomic<uintptr_t> slot_list[0];
+
+    /*
+     * GetNew() - Allocates a directory with all slots being empty and
+     *            unlocked
+     */
+    static Directory *GetNew(uint64_t slot_count, uint64_t resize_threshold) {
+      Directory *dir_p = static_cast<Directory *>(
+        malloc(sizeof(Directory) + sizeof(std::atomic<uintptr_t>) * slot_count));
+      assert(dir_p != nullptr);
+
+      dir_p->slot_count = slot_count;
+      dir_p->index_mask = slot_count - 1;
+      dir_p->resize_threshold = resize_threshold;
+
+      for(uint64_t i = 0;i < slot_count;i++) {
+        dir_p->slot_list[i].store(0, std::memory_order_relaxed);
+      }
+
+      return dir_p;
+    }
+
+    /*
+     * FreeWithEntries() - Frees the directory and all entries on its chains
+     *
+     * This is used by the destructor. Lock bits are ignored
+     */
+    static void FreeWithEntries(void *p) {
+      Directory *dir_p = static_cast<Directory *>(p);
+
+      for(uint64_t i = 0;i < dir_p->slot_count;i++) {
+        HashEntry *entry_p = GetEntry(dir_p->slot_list[i].load());
+
+        while(entry_p != nullptr) {
+          HashEntry *next_p = entry_p->next_p.load();
+          delete entry_p;
+          entry_p = next_p;
+        }
+      }
+
+      free(dir_p);
+
+      return;
+    }
+  };
+
+  /*
+   * class ThreadCounter - Inserts of a thread not yet added to entry_count
+   *
+   * Only the owner thread writes the counter. Counters are padded such that
+   * threads do not share cache lines
+   */
+  class ThreadCounter {
+   public:
+    std::atomic<uint64_t> pending_count;
+
+    char padding[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+  };
+
+  // The current directory; Threads load this with acquire semantics
+  std::atomic<Directory *> dir_p;
+
+  // Number of HashEntry in this hash table, excluding those pending in
+  // per-thread counters
+  std::atomic<uint64_t> entry_count;
+
+  // One counter for each thread ID
+  ThreadCounter *thread_counter_list;
+  uint64_t max_thread_count;
+
+  // Serializes resizing threads
+  std::mutex resize_lock;
+
+  // Specialized function for computing hash and comparison
+  KeyHashFunc key_hash_obj;
+  KeyEqualityChecker key_eq_obj;
+  LoadFactorCalculator lfc;
+
+  // Defers freeing of directories and entries replaced by resize
+  EpochManager epoch_manager;
+
+  // Operation counters; Updated by readers, so it must be mutable
+  mutable StatsType stats;
+
+ private:
+
+  /*
+   * GetEntry() - Masks off the lock bit of a slot
+   */
+  static HashEntry *GetEntry(uintptr_t slot) {
+    return reinterpret_cast<HashEntry *>(slot & ~LOCK_BIT);
+  }
+
+  /*
+   * FreeEntryList() - Frees entries copied by a resize and the list itself
+   *
+   * This is the free function of the epoch manager for copied entries
+   */
+  static void FreeEntryList(void *p) {
+    std::vector<HashEntry *> *entry_list_p = \
+      static_cast<std::vector<HashEntry *> *>(p);
+
+    for(HashEntry *entry_p : *entry_list_p) {
+      delete entry_p;
+    }
+
+    delete entry_list_p;
+
+    return;
+  }
+
+  /*
+   * LockSlot() - Spins until the slot is locked by the current thread, and
+   *              returns the head pointer of the chain
+   *
+   * If the directory is replaced while spinning, the slot might never be
+   * unlocked, and this function returns false without locking
+   */
+  bool LockSlot(Directory *p, std::atomic<uintptr_t> *slot_p, HashEntry **head_p) {
+    uint64_t spin_count = 0;
+
+    while(1) {
+      uintptr_t slot = slot_p->load(std::memory_order_relaxed);
+
+      if((slot & LOCK_BIT) == 0) {
+        if(slot_p->compare_exchange_weak(slot,
+                                         slot | LOCK_BIT,
+                                         std::memory_order_acquire,
+                                         std::memory_order_relaxed) == true) {
+          *head_p = GetEntry(slot);
+
+          return true;
+        }
+      } else if(dir_p.load(std::memory_order_acquire) != p) {
+        return false;
+      }
+
+      spin_count++;
+      if(spin_count % SPIN_COUNT_BEFORE_YIELD == 0) {
+        std::this_thread::yield();
+      }
+    }
+
+    return false;
+  }
+
+  /*
+   * Resize() - Double the size of the directory, and split chains into
+   *            their new positions, sharing trailing runs
+   *
+   * This returns without doing anything if another thread has already
+   * resized the directory the caller saw. The caller must not be in an
+   * epoch, otherwise the old directory could not be reclaimed; old_dir_p is
+   * only dereferenced after it is known to be the current directory
+   */
+  void Resize(Directory *old_dir_p) {
+    std::lock_guard<std::mutex> lock{resize_lock};
+
+    // The address might have been reused by a newer directory that is
+    // not full yet
+    if((dir_p.load() != old_dir_p) || \
+       (entry_count.load() <= old_dir_p->resize_threshold)) {
+      return;
+    }
+
+    uint64_t start_time = stats.GetTime();
+
+    uint64_t slot_count = old_dir_p->slot_count << 1;
+    Directory *new_dir_p = Directory::GetNew(slot_count, lfc(slot_count));
+
+    // Old entries replaced by copies, which are freed with the old directory
+    std::vector<HashEntry *> *copied_list_p = new std::vector<HashEntry *>{};
+
+    for(uint64_t i = 0;i < old_dir_p->slot_count;i++) {
+      HashEntry *entry_p = nullptr;
+      bool ret = LockSlot(old_dir_p, old_dir_p->slot_list + i, &entry_p);
+      assert(ret == true);
+      (void)ret;
+
+      // Find the trailing run of entries that go to the same new slot
+      HashEntry *run_p = nullptr;
+      for(HashEntry *p = entry_p;
+          p != nullptr;
+          p = p->next_p.load(std::memory_order_relaxed)) {
+        if((run_p == nullptr) || \
+           (((p->hash_value ^ run_p->hash_value) & new_dir_p->index_mask) != 0)) {
+          run_p = p;
+        }
+      }
+
+      // Both new slots of this chain are empty, so the run becomes the tail
+      // of its new chain. The new directory is not yet visible so no
+      // synchronization is needed
+      if(run_p != nullptr) {
+        new_dir_p->slot_list[run_p->hash_value & new_dir_p->index_mask].store(
+          reinterpret_cast<uintptr_t>(run_p), std::memory_order_relaxed);
+      }
+
+      // Copy entries before the run
+      while(entry_p != run_p) {
+        std::atomic<uintptr_t> *new_slot_p = \
+          new_dir_p->slot_list + (entry_p->hash_value & new_dir_p->index_mask);
+
+        HashEntry *new_entry_p = \
+          new HashEntry{entry_p->hash_value,
+                        GetEntry(new_slot_p->load(std::memory_order_relaxed)),
+                        entry_p->kv_pair.first,
+                        entry_p->kv_pair.second};
+        new_slot_p->store(reinterpret_cast<uintptr_t>(new_entry_p),
+                          std::memory_order_relaxed);
+
+        copied_list_p->push_back(entry_p);
+        entry_p = entry_p->next_p.load(std::memory_order_relaxed);
+      }
+    }
+
+    // Writers spinning on the old directory will notice this
+    dir_p.store(new_dir_p);
+
+    // Entries in shared runs now belong to the new directory
+    epoch_manager.Retire(old_dir_p, free);
+    epoch_manager.Retire(copied_list_p, FreeEntryList);
+
+    // Retire() only reclaims after many retires, which a table never
+    // reaches by resizing, so previous generations would stay allocated
+    epoch_manager.Reclaim();
+
+    stats.Add(StatsCounter::RESIZE);
+    stats.Add(StatsCounter::RESIZE_TIME_NS, stats.GetTime() - start_time);
+
+    return;
+  }
+
+ public:
+
+  /*
+   * Constructor
+   *
+   * max_thread_count is the maximum number of threads that could be
+   * registered at the same time
+   */
+  HashTable_CA_SCC_Concurrent(uint64_t slot_count = INIT_SLOT_COUNT,
+                              uint64_t max_thread_count = \
+                                EpochManager::DEFAULT_MAX_THREAD_COUNT,
+                              const KeyHashFunc &p_key_hash_obj = KeyHashFunc{},
+                              const KeyEqualityChecker &p_key_eq_obj = KeyEqualityChecker{},
+                              const LoadFactorCalculator &p_lfc = LoadFactorCalculator{}) :
+    entry_count{0},
+    thread_counter_list{new ThreadCounter[max_thread_count]},
+    max_thread_count{max_thread_count},
+    key_hash_obj{p_key_hash_obj},
+    key_eq_obj{p_key_eq_obj},
+    lfc{p_lfc},
+    epoch_manager{max_thread_count},
+    stats{} {
+    // Round it up to a power of 2
+    uint64_t rounded_slot_count = 1;
+    while(rounded_slot_count < slot_count) {
+      rounded_slot_count <<= 1;
+    }
+
+    dir_p.store(Directory::GetNew(rounded_slot_count, lfc(rounded_slot_count)));
+
+    for(uint64_t i = 0;i < max_thread_count;i++) {
+      thread_counter_list[i].pending_count.store(0);
+    }
+
+    dbg_printf("Slot count = %lu\n", rounded_slot_count);
+
+    return;
+  }
+
+  // Threads hold pointers into the table, so it could not be copied
+  // or moved
+  HashTable_CA_SCC_Concurrent(const HashTable_CA_SCC_Concurrent &) = delete;
+  HashTable_CA_SCC_Concurrent &operator=(const HashTable_CA_SCC_Concurrent &) = delete;
+
+  /*
+   * Destructor - Frees the directory and all entries
+   *
+   * The caller must make sure that no thread is accessing the table
+   */
+  ~HashTable_CA_SCC_Concurrent() {
+    Directory::FreeWithEntries(dir_p.load());
+    delete[] thread_counter_list;
+
+    return;
+  }
+
+  /*
+   * RegisterThread() - Returns a thread ID for the calling thread
+   */
+  uint64_t RegisterThread() {
+    return epoch_manager.RegisterThread();
+  }
+
+  /*
+   * UnregisterThread() - Releases a thread ID
+   *
+   * Inserts counted by the thread are added to the shared count
+   */
+  void UnregisterThread(uint64_t thread_id) {
+    assert(thread_id < max_thread_count);
+
+    std::atomic<uint64_t> &pending_count = \
+      thread_counter_list[thread_id].pending_count;
+    entry_count.fetch_add(pending_count.load(std::memory_order_relaxed));
+    pending_count.store(0, std::memory_order_relaxed);
+
+    epoch_manager.UnregisterThread(thread_id);
+
+    return;
+  }
+
+  /*
+   * Insert() - Adds a key value pair into the table
+   *
+   * Only the slot the key is hashed to is locked
+   */
+  inline void Insert(uint64_t thread_id,
+                     const KeyType &key,
+                     const ValueType &value) {
+    InsertWithHash(thread_id, key, key_hash_obj(key), value);
+
+    return;
+  }
+
+  /*
+   * InsertWithHash() - Adds a key value pair whose hash value has been
+   *                    computed by the caller
+   *
+   * hash_value is stored in the entry and used on resize, so every access to
+   * the table must use the same hash function, which is key_hash_obj(key)
+   * if functions that hash the key are also called. The slot index is the
+   * lowest bits of the hash, so callers could partition rows by the highest
+   * bits of the same hash
+   */
+  void InsertWithHash(uint64_t thread_id,
+                      const KeyType &key,
+                      uint64_t hash_value,
+                      const ValueType &value) {
+    // Allocate outside of the critical section
+    HashEntry *entry_p = new HashEntry{hash_value, nullptr, key, value};
+    assert(entry_p != nullptr);
+
+    // The directory to resize, or nullptr if the table is not full
+    Directory *full_dir_p = nullptr;
+
+    {
+      EpochGuard guard{&epoch_manager, thread_id};
+
+      while(1) {
+        Directory *p = dir_p.load(std::memory_order_acquire);
+        std::atomic<uintptr_t> *slot_p = \
+          p->slot_list + (hash_value & p->index_mask);
+
+        HashEntry *head_p = nullptr;
+        if(LockSlot(p, slot_p, &head_p) == false) {
+          // The directory has been replaced; retry on the new one
+          continue;
+        }
+
+        entry_p->next_p.store(head_p, std::memory_order_relaxed);
+
+        // Publish the entry and unlock the slot
+        slot_p->store(reinterpret_cast<uintptr_t>(entry_p),
+                      std::memory_order_release);
+
+        break;
+      }
+
+      // Only the owner thread writes the counter
+      std::atomic<uint64_t> &pending_count = \
+        thread_counter_list[thread_id].pending_count;
+      uint64_t pending = pending_count.load(std::memory_order_relaxed) + 1;
+
+      if(pending < COUNT_BATCH_SIZE) {
+        pending_count.store(pending, std::memory_order_relaxed);
+      } else {
+        pending_count.store(0, std::memory_order_relaxed);
+
+        // Compare against the current directory, since the one we inserted
+        // into might have been replaced, and its threshold is outdated
+        uint64_t count = entry_count.fetch_add(pending) + pending;
+        Directory *p = dir_p.load(std::memory_order_acquire);
+        if(count > p->resize_threshold) {
+          full_dir_p = p;
+        }
+      }
+    }
+
+    stats.Add(StatsCounter::INSERT);
+
+    // Resize outside of the epoch, such that the directory retired by it
+    // could be reclaimed immediately
+    if(full_dir_p != nullptr) {
+      Resize(full_dir_p);
+    }
+
+    return;
+  }
+
+  /*
+   * GetValue() - For a given key, invoke the given call back on the key
+   *              value pair associated with the entry
+   *
+   * This does not lock, and could run concurrently with writers and resize
+   */
+  template <typename CallbackType>
+  inline void GetValue(uint64_t thread_id, const KeyType &key, CallbackType cb) {
+    GetValueWithHash(thread_id, key, key_hash_obj(key), cb);
+
+    return;
+  }
+
+  /*
+   * GetValueWithHash() - Invokes the call back on values of a key whose hash
+   *                      value has been computed by the caller
+   */
+  template <typename CallbackType>
+  void GetValueWithHash(uint64_t thread_id,
+                        const KeyType &key,
+                        uint64_t hash_value,
+                        CallbackType cb) {
+    EpochGuard guard{&epoch_manager, thread_id};
+
+    Directory *p = dir_p.load(std::memory_order_acquire);
+    HashEntry *entry_p = GetEntry(
+      p->slot_list[hash_value & p->index_mask].load(std::memory_order_acquire));
+
+    // Only used for stats
+    uint64_t walk_count = 0;
+    uint64_t compare_count = 0;
+
+    while(entry_p != nullptr) {
+      walk_count++;
+
+      // Keys are only compared if the hash values match
+      if(entry_p->hash_value == hash_value) {
+        compare_count++;
+
+        if(key_eq_obj(key, entry_p->kv_pair.first) == true) {
+          cb(entry_p->kv_pair);
+        }
+      }
+
+      entry_p = entry_p->next_p.load(std::memory_order_acquire);
+    }
+
+    stats.Add(StatsCounter::LOOKUP);
+    stats.Add(StatsCounter::CHAIN_WALK, walk_count);
+    stats.Add(StatsCounter::KEY_COMPARE, compare_count);
+
+    return;
+  }
+
+  /*
+   * GetValue() - Return all value elements in a vector
+   */
+  void GetValue(uint64_t thread_id,
+                const KeyType &key,
+                std::vector<ValueType> *value_list_p) {
+    GetValue(thread_id,
+             key,
+             [value_list_p](const std::pair<KeyType, ValueType> &kv_pair) {
+               value_list_p->push_back(kv_pair.second);
+             });
+
+    return;
+  }
+
+  /*
+   * GetEntryCount() - Returns the number of key value pairs
+   *
+   * This is exact if no insert is running
+   */
+  uint64_t GetEntryCount() const {
+    uint64_t count = entry_count.load();
+    for(uint64_t i = 0;i < max_thread_count;i++) {
+      count += thread_counter_list[i].pending_count.load(std::memory_order_relaxed);
+    }
+
+    return count;
+  }
+
+  /*
+   * GetSlotCount() - Returns the number of slots in the current directory
+   */
+  uint64_t GetSlotCount() const {
+    return dir_p.load()->slot_count;
+  }
+
+  /*
+   * GetStats() - Returns the current value of operation counters
+   *
+   * Counters are summed over all threads
+   */
+  OperationStatsSnapshot GetStats() const {
+    return stats.GetSnapshot();
+  }
+
+  /*
+   * ResetStats() - Sets all operation counters to zero
+   */
+  void ResetStats() {
+    stats.Reset();
+
+    return;
+  }
+
+  /*
+   * ReclaimMemory() - Frees retired directories and entries that are no
+   *                   longer accessed by any reader
+   */
+  void ReclaimMemory() {
+    epoch_manager.Reclaim();
+
+    return;
+  }
+
+  /*
+   * GetRetiredDirectoryCount() - Returns the number of directories replaced
+   *                              by resize that have not been freed
+   */
+  uint64_t GetRetiredDirectoryCount() {
+    return epoch_manager.GetGarbageCount();
+  }
+};
+
+} // namespace index
+} // namespace peloton
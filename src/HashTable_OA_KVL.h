@@ -8,6 +8,13 @@
 #include <type_traits>
 #include <cstring>
 #include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+
+#include "OperationStats.h"
+#include "TableEvents.h"
+#include "MemoryBudget.h"
 
 namespace peloton {
 namespace index {
@@ -37,12 +44,33 @@ namespace index {
  *      of requiring out-of-band memory and maintenance overhead for inserting
  *      keys
  *
+ * Operations are counted by StatsType, which is NoStats by default such that
+ * counting is compiled away; Use CountingStats to count probes, key
+ * comparisons, KVL growths and resizes
+ *
+ * With MatchPolicy being TrackMatches, every value has a match bit, which
+ * is set by GetValueAndMark() and read by ForEachUnmatched() to implement
+ * right and full outer joins. Bits of inline values are kept in a bitmap
+ * allocated after the entry array, and bits of KVL values after the values
+ * of the KVL. NoMatchTracking allocates no bitmap
+ *
+ * Probes never wrap around to the beginning of the array. Instead the array
+ * has a tail of extra entries after the entry_count home slots, such that a
+ * probe starting near the end continues into the tail. The last entry of
+ * the tail is never used and stays free, which stops every search probe
+ * without a bound check. An insert that would need that entry resizes the
+ * table, unless the table is less than half way to the resize threshold,
+ * in which case the cluster is due to colliding hash values and the tail
+ * is doubled instead. A rehash or merge, which could not fail, also doubles
+ * the tail
  */
 template <typename KeyType,
           typename ValueType,
           typename KeyHashFunc = std::hash<KeyType>,
           typename KeyEqualityChecker = std::equal_to<KeyType>,
-          typename LoadFactorCalculator = LoadFactorHalfFull>
+          typename LoadFactorCalculator = LoadFactorHalfFull,
+          typename StatsType = NoStats,
+          typename MatchPolicy = NoMatchTracking>
 class HashTable_OA_KVL {
  private:
   // This is the minimum entry count
@@ -55,8 +83,92 @@ class HashTable_OA_KVL {
   // Number of slots in a KeyValueList when first allocated
   static constexpr uint32_t KVL_INIT_VALUE_COUNT = 4;
   
+  // Size of a cache line which is used to decide when an interleaved probe
+  // should suspend
+  static constexpr uint64_t CACHE_LINE_SIZE = 64;
+  
+  // Number of entries after the home slots when the table is created, i.e.
+  // the maximum probe length from the last home slot, including the free
+  // entry that stops probes
+  static constexpr uint64_t INIT_TAIL_ENTRY_COUNT = 32;
+  
+  // Whether ProbeForSearch() uses the branch free loop, which compares keys
+  // of all entries including free and deleted ones. This is only safe and
+  // cheap for integer keys compared by operator==()
+  static constexpr bool USE_BRANCH_FREE_PROBE = \
+    std::is_integral<KeyType>::value && \
+    std::is_same<KeyEqualityChecker, std::equal_to<KeyType>>::value;
+  
+  // Tags that choose whether Clone() copies entries and KVLs with memcpy()
+  using TrivialEntryTag = std::integral_constant<
+    bool,
+    std::is_trivially_copy_constructible<KeyType>::value &&
+    std::is_trivially_copy_constructible<ValueType>::value>;
+  using TrivialValueTag = std::integral_constant<
+    bool,
+    std::is_trivially_copy_constructible<ValueType>::value>;
+  
+ public:
+  
+  // Default number of probes in flight for GetValueInterleaved()
+  static constexpr uint64_t DEFAULT_INTERLEAVE_GROUP_SIZE = 8;
+  
  private:
   
+  /*
+   * GetMatchBitmapSize() - Returns the size in bytes of a match bitmap with
+   *                        the given number of bits
+   *
+   * The size is 0 if matches are not tracked
+   */
+  static size_t GetMatchBitmapSize(uint64_t bit_count) {
+    if(MatchPolicy::IS_ENABLED == false) {
+      return 0;
+    }
+    
+    return ((bit_count + 63) / 64) * sizeof(uint64_t);
+  }
+  
+  /*
+   * TestMatchBit() - Returns a bit of a match bitmap
+   */
+  static inline bool TestMatchBit(const uint64_t *bitmap, uint64_t index) {
+    return ((bitmap[index / 64] >> (index % 64)) & 0x1UL) == 0x1UL;
+  }
+  
+  /*
+   * AssignMatchBit() - Changes a bit of a match bitmap
+   *
+   * This is not atomic, and is only used while the table is modified
+   */
+  static inline void AssignMatchBit(uint64_t *bitmap,
+                                    uint64_t index,
+                                    bool value) {
+    uint64_t mask = 0x1UL << (index % 64);
+    if(value == true) {
+      bitmap[index / 64] |= mask;
+    } else {
+      bitmap[index / 64] &= ~mask;
+    }
+    
+    return;
+  }
+  
+  /*
+   * SetMatchBit() - Sets a bit of a match bitmap with a relaxed atomic OR
+   *
+   * Concurrent probes could set bits in the same word. The bit is read
+   * first, such that probes of hot keys do not keep writing the cache line
+   */
+  static inline void SetMatchBit(uint64_t *bitmap, uint64_t index) {
+    uint64_t mask = 0x1UL << (index % 64);
+    if((__atomic_load_n(bitmap + index / 64, __ATOMIC_RELAXED) & mask) == 0) {
+      __atomic_fetch_or(bitmap + index / 64, mask, __ATOMIC_RELAXED);
+    }
+    
+    return;
+  }
+  
   /*
    * class KeyValueList - The key value list for holding hash table value
    *                      overflows
@@ -154,6 +266,8 @@ class HashTable_OA_KVL {
         data[to].Init(data[from]);
         // And then destroy the element
         data[from].Fini();
+        
+        MoveMatchBit(from, to);
       }
       
       // This should be done after everything has been finished
@@ -162,6 +276,42 @@ class HashTable_OA_KVL {
       return;
     }
 
+    /*
+     * RemoveIf() - Removes all values that satisfy the predicate, and
+     *              compacts remaining values in-place
+     *
+     * Unlike calling DeleteIndex() repeatedly, each remaining value is moved
+     * at most once. The relative order of remaining values is preserved.
+     * Returns the number of values removed
+     */
+    template <typename Predicate>
+    uint32_t RemoveIf(Predicate &pred) {
+      uint32_t to = 0;
+      
+      for(uint32_t from = 0;from < size;from++) {
+        if(pred(data[from].data) == true) {
+          data[from].Fini();
+          
+          continue;
+        }
+        
+        // Only move if there is a hole before it
+        if(to != from) {
+          data[to].Init(data[from]);
+          data[from].Fini();
+          
+          MoveMatchBit(from, to);
+        }
+        
+        to++;
+      }
+      
+      uint32_t removed_count = size - to;
+      size = to;
+      
+      return removed_count;
+    }
+
     /*
      * GetResized() - Double the size of the current instance and return
      *
@@ -188,6 +338,16 @@ class HashTable_OA_KVL {
         new_kvl_p->FillValue(i, *(data + i));
       }
       
+      // Bits of new slots are zero
+      if(MatchPolicy::IS_ENABLED == true) {
+        std::memset(new_kvl_p->GetMatchBitmap(),
+                    0x00,
+                    GetMatchBitmapSize(new_kvl_p->capacity));
+        std::memcpy(new_kvl_p->GetMatchBitmap(),
+                    GetMatchBitmap(),
+                    GetMatchBitmapSize(capacity));
+      }
+      
       //dbg_printf("Resize finished\n");
       
       return new_kvl_p;
@@ -198,11 +358,46 @@ class HashTable_OA_KVL {
      *                  instance with a certain number of items
      */
     static size_t GetAllocSize(uint32_t data_count) {
-      return sizeof(KeyValueList) + data_count * sizeof(Data<ValueType>);
+      return GetMatchBitmapOffset(data_count) + GetMatchBitmapSize(data_count);
+    }
+    
+    /*
+     * GetMatchBitmapOffset() - Returns the offset of the match bitmap, which
+     *                          is the size of values rounded up to 8 bytes
+     */
+    static size_t GetMatchBitmapOffset(uint32_t data_count) {
+      size_t size = sizeof(KeyValueList) + data_count * sizeof(Data<ValueType>);
+      if(MatchPolicy::IS_ENABLED == false) {
+        return size;
+      }
+      
+      return (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    }
+    
+    /*
+     * GetMatchBitmap() - Returns the match bits of values
+     */
+    uint64_t *GetMatchBitmap() {
+      return reinterpret_cast<uint64_t *>(
+        reinterpret_cast<char *>(this) + GetMatchBitmapOffset(capacity));
+    }
+    
+    /*
+     * MoveMatchBit() - Moves the match bit of a value moved to another index
+     */
+    inline void MoveMatchBit(uint32_t from, uint32_t to) {
+      if(MatchPolicy::IS_ENABLED == true) {
+        uint64_t *bitmap = GetMatchBitmap();
+        AssignMatchBit(bitmap, to, TestMatchBit(bitmap, from));
+      }
+      
+      return;
     }
     
     /*
      * GetNew() - Return a newly constructed list without any initialization
+     *
+     * Match bits are zero
      */
     static KeyValueList *GetNew() {
       KeyValueList *kvl_p = static_cast<KeyValueList *>(
@@ -210,6 +405,12 @@ class HashTable_OA_KVL {
         
       kvl_p->capacity = KVL_INIT_VALUE_COUNT;
       
+      if(MatchPolicy::IS_ENABLED == true) {
+        std::memset(kvl_p->GetMatchBitmap(),
+                    0x00,
+                    GetMatchBitmapSize(KVL_INIT_VALUE_COUNT));
+      }
+      
       return kvl_p;
     }
   };
@@ -370,8 +571,9 @@ class HashTable_OA_KVL {
         }
       } else {
         // If the object is trivially copy constructible then just trivially
-        // copy construct it by a byte copy
-        std::memcpy(other_p, this, sizeof(HashEntry));
+        // copy construct it by a byte copy. The cast avoids -Wclass-memaccess
+        // since Data deletes its assignment
+        std::memcpy(static_cast<void *>(other_p), this, sizeof(HashEntry));
       }
 
       return;
@@ -394,49 +596,75 @@ class HashTable_OA_KVL {
   // Number of active elements
   uint64_t active_entry_count;
   
-  // Total number of entries
+  // Number of home slots, i.e. entries a hash value could be mapped to
   uint64_t entry_count;
   
+  // Number of entries after the home slots; See class comment
+  uint64_t tail_entry_count;
+  
   // We compute threshold for next resizing, and cache it here
   uint64_t resize_threshold;
   
+  // Number of entries marked as deleted
+  uint64_t deleted_entry_count;
+  
   KeyHashFunc key_hash_obj;
   KeyEqualityChecker key_eq_obj;
   LoadFactorCalculator lfc;
   
+  // Operation counters
+  StatsType stats;
+  
+  // Receives resize and growth events; Not owned by the table
+  TableEventListener *listener_p;
+  
+  // Limits memory of the table; Not owned by the table
+  MemoryBudget *budget_p;
+  
+  // Bytes of the array and all KVLs, which are charged to the budget
+  uint64_t memory_size;
+  
  private:
   
   /*
    * GetNextEntry() - Get the next entry
    *
-   * This function takes care of wrapping back and also branch prediction
-   * since wrap back is a rare event, the compiler should have this piece
-   * of information, and arrange code intelligently to let the CPU
-   * favor the branch that is likely to be execute, i.e. no wrapping back
+   * Probes continue into the tail instead of wrapping back, and the free
+   * entry at the end of the tail stops them, so there is no bound check
    *
    * This function should also be inlined such that no actual pointer operation
    * is performed
    */
   inline void GetNextEntry(HashEntry **entry_p_p, uint64_t *index_p) {
-    // Increase them first, since usually we do not need a wrap back
     (*index_p)++;
     (*entry_p_p)++;
     
-    // If the index is already out of bound
-    if(unlikely(*index_p == entry_count)) {
-      *index_p = 0;
-      *entry_p_p = entry_list_p;
-    }
-    
     return;
   }
   
+  /*
+   * GetSlotCount() - Returns the number of entries including the tail
+   */
+  inline uint64_t GetSlotCount() const {
+    return entry_count + tail_entry_count;
+  }
+  
+  /*
+   * GetStopEntry() - Returns the last entry of the tail which is always free
+   */
+  inline HashEntry *GetStopEntry() const {
+    return entry_list_p + GetSlotCount() - 1;
+  }
+  
   /*
    * ProbeForResize() - Given a hash value, probe it in the array and return
    *                    the first HashEntry pointer that is free
    *
    * Since for resizing we only consider free and non-free slots, and there
    * is no deleted slots, probing is pretty easy
+   *
+   * If the probe reaches the end of the tail then the tail is grown, since
+   * the caller could not fail
    */
   HashEntry *ProbeForResize(uint64_t hash_value) {
     // Compute the starting point for probing the hash table
@@ -447,6 +675,12 @@ class HashTable_OA_KVL {
     while(entry_p->IsFree() == false) {
       GetNextEntry(&entry_p, &index);
     }
+    
+    if(unlikely(entry_p == GetStopEntry())) {
+      GrowTail(false);
+      
+      return ProbeForResize(hash_value);
+    }
 
     // It could only be a free entry
     return entry_p;
@@ -472,74 +706,91 @@ class HashTable_OA_KVL {
    *
    * For 3.1 the KVL is allocated and the current inline value
    * is copy constructed onto that list, and the current value is destroyed
+   *
+   * For case 3 existing values of the key could be pruned lazily: If the
+   * inline value satisfies prune_pred then it is destroyed and its storage
+   * is returned; If the KVL is full then values satisfying prune_pred are
+   * removed before deciding whether the KVL should grow. Pruning is only done
+   * at these points such that its cost is amortized by the growth
+   *
+   * If the probe reaches the end of the tail then the table is resized, or
+   * the tail is grown, and the key is probed again
+   *
+   * Returns nullptr without inserting if the KVL could not be allocated or
+   * grown, or the table could not be resized, within the memory budget
    */
-  Data<ValueType> *ProbeForInsert(const KeyType &key) {
-    // Compute the starting point for probing the hash table
-    uint64_t hash_value = key_hash_obj(key);
-    uint64_t index = hash_value & index_mask;
-    HashEntry *entry_p = entry_list_p + index;
-
-    // Keep probing until there is a entry that is not free
-    // Since we always assume the table does not become entirely full,
-    // a free slot could always be inserted
-    while(entry_p->IsProbeEndForInsert() == false) {
-      // If we have found the key, then directly return
-      if(key_eq_obj(key, entry_p->key) == true) {
-        if(entry_p->HasKeyValueList() == false) {
-          KeyValueList *kv_p = KeyValueList::GetNew();
-          assert(kv_p != nullptr);
-
-          // Hook the pointer to the HashEntry
-          entry_p->kv_p = kv_p;
-          
-          // Initialize its header
-          // Size is 2 since we copy the previous one into it and then
-          // another one will be inserted
-          kv_p->size = 2;
-          
-          // Construct in-place
-          kv_p->FillValue(0, entry_p->value);
-          
-          // We know this value object is valid, and now destroy it since
-          // it has been copied into the key value list
-          entry_p->value.Fini();
-          
-          // Return the second element for inserting new values
-          return kv_p->data + 1;
-        } else if(entry_p->kv_p->IsFull()) {
-          // If the size equals capacity then the kv list is full
-          // and we should extend the value list
-          KeyValueList *kv_p = entry_p->kv_p->GetResized();
-          
-          // Call destructor explicitly for all existing values
-          // after we have copy constructed them inside the new array
-          entry_p->kv_p->DestroyAllValues();
+  template <typename PrunePredicate>
+  Data<ValueType> *ProbeForInsert(const KeyType &key,
+                                  uint64_t hash_value,
+                                  PrunePredicate &prune_pred) {
+    stats.Add(StatsCounter::INSERT);
+    
+    HashEntry *entry_p = nullptr;
+    
+    while(true) {
+      // Compute the starting point for probing the hash table
+      uint64_t index = hash_value & index_mask;
+      entry_p = entry_list_p + index;
+      
+      // Number of entries examined and keys compared; Only used for stats
+      uint64_t probe_count = 1;
+      uint64_t compare_count = 0;
+      
+      // Keep probing until there is a entry that is not free
+      // The stop entry at the end of the tail is always free
+      while(entry_p->IsProbeEndForInsert() == false) {
+        // Keys are only compared if the cached hash values match, which
+        // saves dereferencing external keys
+        if(entry_p->hash_value == hash_value) {
+          compare_count++;
           
-          free(entry_p->kv_p);
-          entry_p->kv_p = kv_p;
+          // If we have found the key, then directly return
+          if(key_eq_obj(key, entry_p->key) == true) {
+            stats.Add(StatsCounter::PROBE, probe_count);
+            stats.Add(StatsCounter::KEY_COMPARE, compare_count);
+            
+            return AppendValue(entry_p, prune_pred, true);
+          }
         }
         
-        // Need to get this before increasing size
-        Data<ValueType> *ret = entry_p->kv_p->GetLastElement();
-        
-        // This should be done whether it is resized or not
-        entry_p->kv_p->size++;
-        
-        // This needs to be called no matter whether resize has been
-        // called or not
-        return ret;
+        GetNextEntry(&entry_p, &index);
+        probe_count++;
       }
       
-      GetNextEntry(&entry_p, &index);
+      stats.Add(StatsCounter::PROBE, probe_count);
+      stats.Add(StatsCounter::KEY_COMPARE, compare_count);
+      
+      if(likely(entry_p != GetStopEntry())) {
+        break;
+      }
+      
+      // A resize spreads a cluster only if the hash values differ, so if
+      // the table is not at least half way to the threshold then the
+      // cluster is most likely due to collisions, and the tail grows instead
+      bool ret;
+      if(active_entry_count >= (resize_threshold >> 1)) {
+        ret = Resize();
+      } else {
+        ret = GrowTail(true);
+      }
+      
+      if(ret == false) {
+        return nullptr;
+      }
     }
 
     // After this pointer we know the key and values are not initialized
 
     // This is important!!!
     active_entry_count++;
+    
+    if(entry_p->IsDeleted() == true) {
+      deleted_entry_count--;
+    }
 
     // Change the status first
     entry_p->status = HashEntry::StatusCode::INLINE_VALUE;
+    AssignEntryMatchBit(entry_p, false);
     
     // Then fill in hash and key
     // We leave the value to be filled by the caller
@@ -552,84 +803,546 @@ class HashTable_OA_KVL {
     return &entry_p->value;
   }
   
+  /*
+   * AppendValue() - Returns the storage for a new value after existing
+   *                 values of a valid entry
+   *
+   * If the entry has an inline value then a KVL is allocated and the current
+   * inline value is copy constructed onto that list, and the current value
+   * is destroyed. If the KVL is full then it is grown
+   *
+   * Existing values might be pruned using prune_pred before the KVL is
+   * allocated or grown, as described in ProbeForInsert()
+   *
+   * If check_budget is true and the memory budget refuses the allocation
+   * then nothing is changed and nullptr is returned. Otherwise memory is
+   * charged even if it exceeds the budget
+   */
+  template <typename PrunePredicate>
+  Data<ValueType> *AppendValue(HashEntry *entry_p,
+                               PrunePredicate &prune_pred,
+                               bool check_budget) {
+    assert(entry_p->IsValidEntry() == true);
+    
+    if(entry_p->HasKeyValueList() == false) {
+      // The inline value is replaced by the new value
+      if(prune_pred(entry_p->value.data) == true) {
+        entry_p->value.Fini();
+        AssignEntryMatchBit(entry_p, false);
+        
+        return &entry_p->value;
+      }
+      
+      if(AcquireMemory(KeyValueList::GetAllocSize(KVL_INIT_VALUE_COUNT),
+                       check_budget) == false) {
+        return nullptr;
+      }
+      
+      KeyValueList *kv_p = KeyValueList::GetNew();
+      assert(kv_p != nullptr);
+      
+      stats.Add(StatsCounter::KVL_GROW);
+      NotifyKVLGrow(1, kv_p->capacity, 1);
+
+      // Hook the pointer to the HashEntry
+      entry_p->kv_p = kv_p;
+      
+      // Initialize its header
+      // Size is 2 since we copy the previous one into it and then
+      // another one will be inserted
+      kv_p->size = 2;
+      
+      // Construct in-place
+      kv_p->FillValue(0, entry_p->value);
+      
+      // We know this value object is valid, and now destroy it since
+      // it has been copied into the key value list
+      entry_p->value.Fini();
+      
+      // The bit of the inline value moves into the KVL
+      if(MatchPolicy::IS_ENABLED == true) {
+        uint64_t *entry_bitmap = GetEntryMatchBitmap();
+        uint64_t index = entry_p - entry_list_p;
+        
+        AssignMatchBit(kv_p->GetMatchBitmap(),
+                       0,
+                       TestMatchBit(entry_bitmap, index));
+        AssignMatchBit(entry_bitmap, index, false);
+      }
+      
+      // Return the second element for inserting new values
+      return kv_p->data + 1;
+    } else if(entry_p->kv_p->IsFull() &&
+              (entry_p->kv_p->RemoveIf(prune_pred) == 0)) {
+      // If the size equals capacity then the kv list is full
+      // and we should extend the value list
+      uint32_t capacity = entry_p->kv_p->capacity;
+      if(AcquireMemory(KeyValueList::GetAllocSize(capacity << 1) - \
+                       KeyValueList::GetAllocSize(capacity),
+                       check_budget) == false) {
+        return nullptr;
+      }
+      
+      KeyValueList *kv_p = entry_p->kv_p->GetResized();
+      
+      stats.Add(StatsCounter::KVL_GROW);
+      NotifyKVLGrow(entry_p->kv_p->capacity, kv_p->capacity, kv_p->size);
+      
+      // Call destructor explicitly for all existing values
+      // after we have copy constructed them inside the new array
+      entry_p->kv_p->DestroyAllValues();
+      
+      free(entry_p->kv_p);
+      entry_p->kv_p = kv_p;
+    }
+    
+    // Need to get this before increasing size
+    Data<ValueType> *ret = entry_p->kv_p->GetLastElement();
+    
+    // The slot might hold the bit of a value removed before
+    if(MatchPolicy::IS_ENABLED == true) {
+      AssignMatchBit(entry_p->kv_p->GetMatchBitmap(),
+                     entry_p->kv_p->size,
+                     false);
+    }
+    
+    // This should be done whether it is resized or not
+    entry_p->kv_p->size++;
+    
+    // This needs to be called no matter whether resize has been
+    // called or not
+    return ret;
+  }
+  
+  /*
+   * ProbeForMerge() - Probe the array for the entry of a key with the given
+   *                   hash value
+   *
+   * If the key exists then its entry is returned. Otherwise the first free
+   * or deleted entry on the probe sequence is returned, which is where the
+   * key should be placed. The tail is grown if the probe reaches its end
+   */
+  HashEntry *ProbeForMerge(uint64_t hash_value, const KeyType &key) {
+    uint64_t index = hash_value & index_mask;
+    HashEntry *entry_p = entry_list_p + index;
+    
+    // The first deleted entry, which is reused if the key is not found
+    HashEntry *deleted_entry_p = nullptr;
+
+    while(entry_p->IsProbeEndForSearch() == false) {
+      if(entry_p->IsDeleted() == true) {
+        if(deleted_entry_p == nullptr) {
+          deleted_entry_p = entry_p;
+        }
+      } else if((entry_p->hash_value == hash_value) && \
+                (key_eq_obj(key, entry_p->key) == true)) {
+        return entry_p;
+      }
+
+      GetNextEntry(&entry_p, &index);
+    }
+
+    if(deleted_entry_p != nullptr) {
+      return deleted_entry_p;
+    }
+    
+    if(unlikely(entry_p == GetStopEntry())) {
+      GrowTail(false);
+      
+      return ProbeForMerge(hash_value, key);
+    }
+
+    return entry_p;
+  }
+  
+  /*
+   * ReserveForMerge() - Grows the table once, such that the given number of
+   *                     additional keys could be inserted without a resize
+   */
+  void ReserveForMerge(uint64_t key_count) {
+    uint64_t new_entry_count = entry_count;
+    while(lfc(new_entry_count) <= active_entry_count + key_count) {
+      new_entry_count <<= 1;
+    }
+    
+    if(new_entry_count != entry_count) {
+      AcquireMemory(GetArrayMemorySize(new_entry_count, tail_entry_count) - \
+                    GetArrayMemorySize(),
+                    false);
+      Rehash(new_entry_count);
+    }
+    
+    return;
+  }
+  
   /*
    * ProbeForSearch() - Probe the array to find the entry of given key
    *
    * If the entry is not found then return nullptr. If we are doing an
    * insertion later on then a reprobe is required
    */
-  HashEntry *ProbeForSearch(const KeyType &key) {
+  inline HashEntry *ProbeForSearch(const KeyType &key) {
+    return ProbeForSearch(key, key_hash_obj(key));
+  }
+  
+  /*
+   * ProbeForSearch() - Probe the array with a hash value computed by the
+   *                    caller
+   */
+  HashEntry *ProbeForSearch(const KeyType &key, uint64_t hash_value) {
+    if(USE_BRANCH_FREE_PROBE == true) {
+      return ProbeForSearchBranchFree(key, hash_value);
+    }
+    
     // Compute the starting point for probing the hash table
-    uint64_t index = key_hash_obj(key) & index_mask;
+    uint64_t index = hash_value & index_mask;
     HashEntry *entry_p = entry_list_p + index;
+    
+    // Only used for stats
+    uint64_t probe_count = 1;
+    uint64_t compare_count = 0;
 
     // Keep probing until there is a entry that is not free
     // Since we always assume the table does not become entirely full,
     // a free slot could always be inserted
     while(entry_p->IsProbeEndForSearch() == false) {
       // If we reach here the entry still could be a deleted entry
-      // Check for status of deletion first
+      // Check for status of deletion first, and compare the key only if
+      // the cached hash value matches
       if((entry_p->IsDeleted() == false) && \
-         (key_eq_obj(key, entry_p->key) == true)) {
-        return entry_p;
+         (entry_p->hash_value == hash_value)) {
+        compare_count++;
+        
+        if(key_eq_obj(key, entry_p->key) == true) {
+          RecordSearch(probe_count, compare_count);
+          
+          return entry_p;
+        }
       }
 
       GetNextEntry(&entry_p, &index);
+      probe_count++;
     }
+    
+    RecordSearch(probe_count, compare_count);
 
     // There is no entry
     return nullptr;
   }
   
+  /*
+   * ProbeForSearchBranchFree() - Probes for integer keys without branches
+   *                              that depend on entries
+   *
+   * The general loop branches on whether the entry is free, deleted and
+   * whether the key matches, and with random keys these mispredict on
+   * almost every probe. Here the hit and end conditions of each entry are
+   * computed as flags, and the only branch is the loop exit taken on a hit
+   * or a free entry, i.e. at most one misprediction per probe. Probes do
+   * not wrap around, see class comment
+   */
+  HashEntry *ProbeForSearchBranchFree(const KeyType &key,
+                                      uint64_t hash_value) {
+    HashEntry *entry_p = entry_list_p + (hash_value & index_mask);
+    
+    // Only used for stats
+    uint64_t probe_count = 1;
+    uint64_t compare_count = 0;
+    
+    while(true) {
+      bool is_valid = entry_p->IsValidEntry();
+      bool is_hit = is_valid & key_eq_obj(key, entry_p->key);
+      bool is_end = entry_p->IsProbeEndForSearch();
+      
+      compare_count += is_valid;
+      
+      // A free entry is never a hit, so the flags differ iff the probe
+      // stops. Written as (is_hit || is_end) the compiler splits it into
+      // two branches again
+      if(is_hit != is_end) {
+        break;
+      }
+      
+      entry_p++;
+      probe_count++;
+    }
+    
+    RecordSearch(probe_count, compare_count);
+    
+    // The loop stops at either a free entry or the entry of the key
+    return entry_p->IsFree() ? nullptr : entry_p;
+  }
+  
+  /*
+   * RecordSearch() - Counts a search with the number of entries examined
+   *                  and keys compared
+   */
+  inline void RecordSearch(uint64_t probe_count, uint64_t compare_count) {
+    stats.Add(StatsCounter::LOOKUP);
+    stats.Add(StatsCounter::PROBE, probe_count);
+    stats.Add(StatsCounter::KEY_COMPARE, compare_count);
+    
+    return;
+  }
+  
   /*
    * GetHashEntryListStatic() - Allocates a hash entry list given the number of
-   *                            HashEntry objects
+   *                            HashEntry objects, including the tail
    *
    * This will first call malloc() to initialize memory and then initialize
-   * status code for each entry to FREE
+   * status code for each entry to FREE. If the branch free probe is used then
+   * keys of free entries are set to zero, since it compares them
    *
-   * Note that this function allocates a chunk of memory of entry_count +
+   * Note that this function allocates a chunk of memory of slot_count +
    * entries, in a sense that we use the last entry as a sentinel to support
    * iterating through the entire hash table, i.e. the iterator must stop on
    * the sentinel entry (so it is initialized to INLINE_VALUE)
    */
-  static HashEntry *GetHashEntryListStatic(uint64_t entry_count) {
-    HashEntry *entry_list_p = \
-      static_cast<HashEntry *>(aligned_malloc_64(sizeof(HashEntry) * (1 + entry_count)));
+  static HashEntry *GetHashEntryListStatic(uint64_t slot_count) {
+    HashEntry *entry_list_p = static_cast<HashEntry *>(
+      aligned_malloc_64(sizeof(HashEntry) * (1 + slot_count) +
+                        GetMatchBitmapSize(slot_count)));
       
-    for(uint64_t i = 0;i < entry_count;i++) {
+    for(uint64_t i = 0;i < slot_count;i++) {
       entry_list_p[i].status = HashEntry::StatusCode::FREE;
+      
+      if(USE_BRANCH_FREE_PROBE == true) {
+        entry_list_p[i].key.Init();
+      }
     }
     
     // This will be the entry pointed to by the end() iterator
     // and also it stops iteration
     // "remaining" will be set to 1 when iterator hits this entry
     // so we know comparison between them yields true
-    entry_list_p[entry_count].status = HashEntry::StatusCode::INLINE_VALUE;
+    entry_list_p[slot_count].status = HashEntry::StatusCode::INLINE_VALUE;
+    
+    // Free entries have no unmatched value
+    std::memset(GetEntryMatchBitmap(entry_list_p, slot_count),
+                0xFF,
+                GetMatchBitmapSize(slot_count));
     
     return entry_list_p;
   }
   
   /*
-   * Resize() - Double the size of the table, and do a reprobe for every
-   *            existing element
+   * GetEntryMatchBitmap() - Returns the match bitmap of an entry array,
+   *                         which is allocated after the sentinel entry
    *
-   * This function allocates a new array and frees the old array, and calls
-   * copy constructor for each valid entry remaining in the old array into
-   * the new array
+   * The bit of an entry is set if the entry has no unmatched inline value,
+   * i.e. it is free or deleted, or its inline value has been matched. It is
+   * always clear for an entry with a KVL, whose values have their own bits.
+   * So ForEachUnmatched() only visits entries whose bit is clear
    */
-  void Resize() {
-    entry_count <<= 1;
-    index_mask = entry_count - 1;
+  static inline uint64_t *GetEntryMatchBitmap(HashEntry *p_entry_list_p,
+                                              uint64_t p_slot_count) {
+    return reinterpret_cast<uint64_t *>(p_entry_list_p + p_slot_count + 1);
+  }
+  
+  inline uint64_t *GetEntryMatchBitmap() const {
+    return GetEntryMatchBitmap(entry_list_p, GetSlotCount());
+  }
+  
+  /*
+   * AssignEntryMatchBit() - Changes the match bit of an entry, if matches
+   *                         are tracked
+   */
+  inline void AssignEntryMatchBit(HashEntry *entry_p, bool value) {
+    if(MatchPolicy::IS_ENABLED == true) {
+      AssignMatchBit(GetEntryMatchBitmap(), entry_p - entry_list_p, value);
+    }
     
-    // Use the user provided call back to compute the load factor
-    resize_threshold = lfc(entry_count);
+    return;
+  }
+  
+  /*
+   * NotifyKVLGrow() - Calls the listener if the new capacity of a value list
+   *                   reaches the threshold
+   */
+  void NotifyKVLGrow(uint32_t old_capacity,
+                     uint32_t new_capacity,
+                     uint32_t value_count) {
+    if((listener_p != nullptr) && \
+       (new_capacity >= listener_p->kvl_grow_threshold)) {
+      listener_p->OnKVLGrow(KVLGrowEvent{old_capacity,
+                                         new_capacity,
+                                         value_count});
+    }
+    
+    return;
+  }
+  
+  /*
+   * NotifyTombstone() - Calls the listener if the last delete made the ratio
+   *                     of deleted entries reach the threshold
+   *
+   * This is called after a deleted entry is created by DeleteKey() and
+   * Delete(), but not DeleteIf() which removes all tombstones afterwards
+   */
+  void NotifyTombstone() {
+    if(listener_p == nullptr) {
+      return;
+    }
+    
+    double threshold = listener_p->tombstone_ratio * entry_count;
+    if((deleted_entry_count >= threshold) && \
+       (deleted_entry_count - 1 < threshold)) {
+      listener_p->OnTombstoneThreshold(TombstoneEvent{entry_count,
+                                                      active_entry_count,
+                                                      deleted_entry_count});
+    }
+    
+    return;
+  }
+  
+  /*
+   * AcquireMemory() - Adds memory that is going to be allocated, and charges
+   *                   it to the budget if there is one
+   *
+   * If check_budget is true and the budget refuses the reservation then
+   * false is returned, and nothing should be allocated. Otherwise memory is
+   * charged without checking the limit
+   */
+  bool AcquireMemory(uint64_t size, bool check_budget) {
+    if(budget_p != nullptr) {
+      if(check_budget == false) {
+        budget_p->Charge(size);
+      } else if(budget_p->TryReserve(size) == false) {
+        return false;
+      }
+    }
+    
+    memory_size += size;
+    
+    return true;
+  }
+  
+  /*
+   * ReleaseMemory() - Subtracts memory that has been freed, and returns it
+   *                   to the budget
+   */
+  void ReleaseMemory(uint64_t size) {
+    assert(memory_size >= size);
+    
+    if(budget_p != nullptr) {
+      budget_p->Release(size);
+    }
+    
+    memory_size -= size;
+    
+    return;
+  }
+  
+  /*
+   * Resize() - Double the size of the table, and do a reprobe for every
+   *            existing element
+   *
+   * Returns false without resizing if the memory budget refuses the larger
+   * array
+   */
+  bool Resize() {
+    if(AcquireMemory(GetArrayMemorySize(entry_count << 1, tail_entry_count) - \
+                     GetArrayMemorySize(),
+                     true) == false) {
+      return false;
+    }
+    
+    Rehash(entry_count << 1);
+    
+    return true;
+  }
+  
+  /*
+   * GrowTail() - Doubles the number of entries after the home slots
+   *
+   * Entries stay at the same index, so no key is reprobed. Returns false
+   * without growing if check_budget is true and the memory budget refuses
+   * the larger array
+   */
+  bool GrowTail(bool check_budget) {
+    uint64_t old_slot_count = GetSlotCount();
+    uint64_t new_tail_entry_count = tail_entry_count << 1;
+    
+    if(AcquireMemory(GetArrayMemorySize(entry_count, new_tail_entry_count) - \
+                     GetArrayMemorySize(),
+                     check_budget) == false) {
+      return false;
+    }
     
-    // Preserve the old entry list and allocate a new one
     HashEntry *old_entry_list_p = entry_list_p;
+    uint64_t *old_bitmap = GetEntryMatchBitmap();
+    
+    tail_entry_count = new_tail_entry_count;
+    entry_list_p = GetHashEntryListStatic(GetSlotCount());
+    assert(entry_list_p != nullptr);
+    
+    for(uint64_t i = 0;i < old_slot_count;i++) {
+      HashEntry *entry_p = old_entry_list_p + i;
+      if(entry_p->IsValidEntry() == true) {
+        entry_p->CopyTo(entry_list_p + i);
+        entry_p->Fini();
+      } else if(entry_p->IsDeleted() == true) {
+        // This keeps the key for the branch free probe
+        entry_p->CopyTo(entry_list_p + i);
+      }
+    }
+    
+    // Bits of the new entries are set, and so are the unused bits of the
+    // last word of the old bitmap
+    if(MatchPolicy::IS_ENABLED == true) {
+      std::memcpy(GetEntryMatchBitmap(),
+                  old_bitmap,
+                  GetMatchBitmapSize(old_slot_count));
+    }
+    
+    free(old_entry_list_p);
+    
+    return true;
+  }
+  
+  /*
+   * Rehash() - Reprobes every existing element into a new array of the
+   *            given size
+   *
+   * This function allocates a new array and frees the old array, and calls
+   * copy constructor for each valid entry remaining in the old array into
+   * the new array. Deleted entries are not carried over, so rehashing into
+   * an array of the same size removes all tombstones
+   *
+   * The caller accounts for the change of memory size
+   */
+  void Rehash(uint64_t new_entry_count) {
+    assert((new_entry_count & (new_entry_count - 1)) == 0);
+    
+    uint64_t start_time = stats.GetTime();
+    
+    ResizeEvent event{entry_count,
+                      new_entry_count,
+                      active_entry_count,
+                      deleted_entry_count,
+                      0};
+    uint64_t event_start_time = 0;
+    if(listener_p != nullptr) {
+      listener_p->OnResizeBegin(event);
+      event_start_time = TableEventListener::GetTime();
+    }
+    
+    uint64_t old_slot_count = GetSlotCount();
+    
+    entry_count = new_entry_count;
+    index_mask = entry_count - 1;
+    deleted_entry_count = 0;
+    
+    // Use the user provided call back to compute the load factor
+    resize_threshold = lfc(entry_count);
+    
+    // Preserve the old entry list and allocate a new one
+    HashEntry *old_entry_list_p = entry_list_p;
+    uint64_t *old_bitmap = GetEntryMatchBitmap(old_entry_list_p,
+                                               old_slot_count);
     
     // This will initialize status code for each entry
-    entry_list_p = HashTable_OA_KVL::GetHashEntryListStatic(entry_count);
+    entry_list_p = HashTable_OA_KVL::GetHashEntryListStatic(GetSlotCount());
     assert(entry_list_p != nullptr);
     
     // Use this to iterate through all entries and rehash them into
@@ -647,6 +1360,12 @@ class HashTable_OA_KVL {
         // explicitly
         entry_p->CopyTo(new_entry_p);
         
+        if(MatchPolicy::IS_ENABLED == true) {
+          AssignEntryMatchBit(
+            new_entry_p,
+            TestMatchBit(old_bitmap, entry_p - old_entry_list_p));
+        }
+        
         // And then call destructor explicitly to destroy key AND/OR value
         entry_p->Fini();
       }
@@ -658,6 +1377,14 @@ class HashTable_OA_KVL {
     // Free old list to avoid memory leak
     free(old_entry_list_p);
     
+    stats.Add(StatsCounter::RESIZE);
+    stats.Add(StatsCounter::RESIZE_TIME_NS, stats.GetTime() - start_time);
+    
+    if(listener_p != nullptr) {
+      event.duration_ns = TableEventListener::GetTime() - event_start_time;
+      listener_p->OnResizeEnd(event);
+    }
+    
     return;
   }
   
@@ -764,9 +1491,14 @@ class HashTable_OA_KVL {
                    const KeyEqualityChecker &p_key_eq_obj = KeyEqualityChecker{},
                    const LoadFactorCalculator &p_lfc = LoadFactorCalculator{}) :
     active_entry_count{0},
+    deleted_entry_count{0},
     key_hash_obj{p_key_hash_obj},
     key_eq_obj{p_key_eq_obj},
-    lfc{p_lfc} {
+    lfc{p_lfc},
+    stats{},
+    listener_p{nullptr},
+    budget_p{nullptr},
+    memory_size{0} {
     // First initialize this variable to make it as reasonable as possible
     init_entry_count = GetInitEntryCount(init_entry_count);
                        
@@ -776,11 +1508,15 @@ class HashTable_OA_KVL {
     // Set the threshold by setting the load factor
     resize_threshold = lfc(entry_count);
     
+    tail_entry_count = INIT_TAIL_ENTRY_COUNT;
+    
     // This does not call any constructor of any kind, and we only
     // initialize on demand
-    entry_list_p = GetHashEntryListStatic(entry_count);
+    entry_list_p = GetHashEntryListStatic(GetSlotCount());
     assert(entry_list_p != nullptr);
     
+    memory_size = GetArrayMemorySize();
+    
     dbg_printf("Hash table size = %lu\n", entry_count);
     dbg_printf("Resize threshold = %lu\n", resize_threshold);
     dbg_printf("is_trivially_copy_constructible = %d\n",
@@ -797,18 +1533,223 @@ class HashTable_OA_KVL {
    * their KeyValueList if there is one
    */
   ~HashTable_OA_KVL() {
+    // The table has been moved from
+    if(entry_list_p == nullptr) {
+      return;
+    }
+    
     // Free all key, value and key value list
     FreeAllHashEntries();
     
     // Free the array
-    assert(entry_list_p);
     free(entry_list_p);
     
+    if(budget_p != nullptr) {
+      budget_p->Release(memory_size);
+    }
+    
+    return;
+  }
+  
+  // The implicit copy would share the array and KVLs; Use Clone() instead
+  HashTable_OA_KVL(const HashTable_OA_KVL &) = delete;
+  HashTable_OA_KVL &operator=(const HashTable_OA_KVL &) = delete;
+  
+  /*
+   * Move Constructor - Takes over the array of another table in O(1)
+   *
+   * The other table is left without an array, and could only be destroyed
+   * or assigned to
+   */
+  HashTable_OA_KVL(HashTable_OA_KVL &&other) :
+    entry_list_p{other.entry_list_p},
+    index_mask{other.index_mask},
+    active_entry_count{other.active_entry_count},
+    entry_count{other.entry_count},
+    tail_entry_count{other.tail_entry_count},
+    resize_threshold{other.resize_threshold},
+    deleted_entry_count{other.deleted_entry_count},
+    key_hash_obj{other.key_hash_obj},
+    key_eq_obj{other.key_eq_obj},
+    lfc{other.lfc},
+    stats{std::move(other.stats)},
+    listener_p{other.listener_p},
+    budget_p{other.budget_p},
+    memory_size{other.memory_size} {
+    other.entry_list_p = nullptr;
+    other.index_mask = 0;
+    other.active_entry_count = 0;
+    other.entry_count = 0;
+    other.tail_entry_count = 0;
+    other.resize_threshold = 0;
+    other.deleted_entry_count = 0;
+    other.listener_p = nullptr;
+    other.budget_p = nullptr;
+    other.memory_size = 0;
+    
+    return;
+  }
+  
+  /*
+   * Move Assignment - Swaps content with the other table
+   *
+   * The previous content of this table is freed when the other table
+   * is destroyed
+   */
+  HashTable_OA_KVL &operator=(HashTable_OA_KVL &&other) {
+    Swap(other);
+    
+    return *this;
+  }
+  
+  /*
+   * Swap() - Swaps content of two tables in O(1)
+   *
+   * Iterators remain valid and refer to the same elements, which are now
+   * in the other table
+   */
+  void Swap(HashTable_OA_KVL &other) {
+    std::swap(entry_list_p, other.entry_list_p);
+    std::swap(index_mask, other.index_mask);
+    std::swap(active_entry_count, other.active_entry_count);
+    std::swap(entry_count, other.entry_count);
+    std::swap(tail_entry_count, other.tail_entry_count);
+    std::swap(resize_threshold, other.resize_threshold);
+    std::swap(deleted_entry_count, other.deleted_entry_count);
+    std::swap(key_hash_obj, other.key_hash_obj);
+    std::swap(key_eq_obj, other.key_eq_obj);
+    std::swap(lfc, other.lfc);
+    stats.Swap(other.stats);
+    std::swap(listener_p, other.listener_p);
+    std::swap(budget_p, other.budget_p);
+    std::swap(memory_size, other.memory_size);
+    
+    return;
+  }
+  
+  /*
+   * Clone() - Returns a deep copy of the table
+   *
+   * Counters of the copy start from zero, and it has no event listener or
+   * memory budget. The copy has the same size and layout as this table, so
+   * no key is rehashed. If both key and value are trivially copyable then
+   * the entry array and each KVL is copied with memcpy(); Otherwise copy
+   * constructors are called for each key and value
+   */
+  HashTable_OA_KVL Clone() const {
+    HashTable_OA_KVL ret{0, key_hash_obj, key_eq_obj, lfc};
+    
+    // This allocates an array of the same size, including the tail, that
+    // is entirely free. The old array of ret is empty so the tail size it
+    // was allocated with does not matter
+    ret.tail_entry_count = tail_entry_count;
+    ret.Rehash(entry_count);
+    
+    uint64_t slot_count = GetSlotCount();
+    CopyEntryList(ret.entry_list_p, TrivialEntryTag{});
+    
+    std::memcpy(ret.GetEntryMatchBitmap(),
+                GetEntryMatchBitmap(),
+                GetMatchBitmapSize(slot_count));
+    
+    // KVL pointers have been copied, and they are replaced with copies
+    // of the KVL
+    for(uint64_t i = 0;i < slot_count;i++) {
+      HashEntry *entry_p = ret.entry_list_p + i;
+      if(entry_p->HasKeyValueList() == false) {
+        continue;
+      }
+      
+      KeyValueList *kv_p = entry_p->kv_p;
+      size_t alloc_size = KeyValueList::GetAllocSize(kv_p->capacity);
+      KeyValueList *new_kv_p = \
+        static_cast<KeyValueList *>(aligned_malloc_64(alloc_size));
+      
+      CopyKeyValueList(new_kv_p, kv_p, TrivialValueTag{});
+      
+      entry_p->kv_p = new_kv_p;
+    }
+    
+    ret.active_entry_count = active_entry_count;
+    ret.deleted_entry_count = deleted_entry_count;
+    ret.memory_size = memory_size;
+    
+    // Do not count the rehash above
+    ret.ResetStats();
+    
+    return ret;
+  }
+  
+ private:
+  
+  /*
+   * CopyEntryList() - Copies all entries into an array of the same size
+   *                   with memcpy(), if key and value are trivially copyable
+   *
+   * Overloads are chosen by a tag such that memcpy() is not compiled for
+   * types that could not be copied by bytes. The destination is cast since
+   * Data deletes its assignment, which -Wclass-memaccess reports even for
+   * trivial types
+   */
+  void CopyEntryList(HashEntry *dest_p, std::true_type) const {
+    std::memcpy(static_cast<void *>(dest_p),
+                entry_list_p,
+                sizeof(HashEntry) * GetSlotCount());
+    
     return;
   }
   
   /*
-   * GetEntryCount() - Return the number of entries in the array
+   * CopyEntryList() - Copies all entries into an array of the same size
+   *                   by calling copy constructors
+   */
+  void CopyEntryList(HashEntry *dest_p, std::false_type) const {
+    for(uint64_t i = 0;i < GetSlotCount();i++) {
+      entry_list_p[i].CopyTo(dest_p + i);
+    }
+    
+    return;
+  }
+  
+  /*
+   * CopyKeyValueList() - Copies a KVL with memcpy(), if value is trivially
+   *                      copyable
+   */
+  static void CopyKeyValueList(KeyValueList *dest_p,
+                               KeyValueList *kv_p,
+                               std::true_type) {
+    std::memcpy(static_cast<void *>(dest_p),
+                kv_p,
+                KeyValueList::GetAllocSize(kv_p->capacity));
+    
+    return;
+  }
+  
+  /*
+   * CopyKeyValueList() - Copies a KVL by calling copy constructors
+   */
+  static void CopyKeyValueList(KeyValueList *dest_p,
+                               KeyValueList *kv_p,
+                               std::false_type) {
+    dest_p->size = kv_p->size;
+    dest_p->capacity = kv_p->capacity;
+    
+    for(uint32_t j = 0;j < kv_p->size;j++) {
+      dest_p->FillValue(j, kv_p->data[j]);
+    }
+    
+    std::memcpy(dest_p->GetMatchBitmap(),
+                kv_p->GetMatchBitmap(),
+                GetMatchBitmapSize(kv_p->capacity));
+    
+    return;
+  }
+  
+ public:
+  
+  /*
+   * GetEntryCount() - Return the number of entries in the array, not
+   *                   including the tail
    */
   uint64_t GetEntryCount() const {
     return entry_count;
@@ -822,6 +1763,55 @@ class HashTable_OA_KVL {
     return resize_threshold;
   }
   
+  /*
+   * GetArrayMemorySize() - Returns the size of the array in bytes
+   *
+   * Key value lists allocated for duplicated keys are not included. The
+   * tail and the match bitmap of entries are included
+   */
+  uint64_t GetArrayMemorySize() const {
+    return GetArrayMemorySize(entry_count, tail_entry_count);
+  }
+  
+  /*
+   * GetArrayMemorySize() - Returns the size of an array with the given
+   *                        number of entries and tail entries in bytes
+   */
+  static uint64_t GetArrayMemorySize(uint64_t p_entry_count,
+                                     uint64_t p_tail_entry_count) {
+    uint64_t slot_count = p_entry_count + p_tail_entry_count;
+    
+    return slot_count * sizeof(HashEntry) + GetMatchBitmapSize(slot_count);
+  }
+  
+  /*
+   * GetMemorySize() - Returns the size of the array and all key value lists
+   *                   in bytes
+   */
+  uint64_t GetMemorySize() const {
+    return memory_size;
+  }
+  
+  /*
+   * SetMemoryBudget() - Charges memory of the table to a budget, or removes
+   *                     the budget if nullptr is given
+   *
+   * Memory charged to the previous budget is released. The budget must
+   * outlive the table or be removed before destroyed; See MemoryBudget
+   */
+  void SetMemoryBudget(MemoryBudget *p_budget_p) {
+    if(budget_p != nullptr) {
+      budget_p->Release(memory_size);
+    }
+    
+    budget_p = p_budget_p;
+    if(budget_p != nullptr) {
+      budget_p->Charge(memory_size);
+    }
+    
+    return;
+  }
+  
   /*
    * GetLoadFactor() - Returns the current load factor as a double
    *                   between 0.0 - 1.0
@@ -839,22 +1829,107 @@ class HashTable_OA_KVL {
    * This function might invalidate all iterators on the hash table in case
    * of a resize(). If no resize happens then it does not invalidate any
    * valid pointer including the End() pointer
+   *
+   * Returns false without inserting if the table would have to grow the
+   * array or a KVL beyond the memory budget. If the array is full and could
+   * not grow, values are still appended to existing keys. Always returns
+   * true if there is no budget
    */
-  void Insert(const KeyType &key, const ValueType &value) {
+  inline bool Insert(const KeyType &key, const ValueType &value) {
+    return InsertWithHash(key, key_hash_obj(key), value);
+  }
+  
+  /*
+   * InsertWithHash() - Inserts a key-value pair whose hash value has been
+   *                    computed by the caller
+   *
+   * This is used when the hash of a row is computed once and shared by all
+   * operators of a pipeline, e.g. to choose a partition and then to insert.
+   * hash_value is stored in the entry and reused on resize and merge, so
+   * every access to the table must use the same hash function; It must be
+   * equal to key_hash_obj(key) if functions that hash the key, such as
+   * Insert() and GetValue(), are also called. The table only uses the lowest
+   * bits of the hash (hash_value & index_mask) as the slot index, so a
+   * caller that partitions rows by the highest bits of the same hash does
+   * not skew the slots of tables holding one partition
+   */
+  bool InsertWithHash(const KeyType &key,
+                      uint64_t hash_value,
+                      const ValueType &value) {
     if(active_entry_count == resize_threshold) {
-      Resize();
-      // This must hold true for any load factor
-      assert(active_entry_count < resize_threshold);
+      if(Resize() == true) {
+        // This must hold true for any load factor
+        assert(active_entry_count < resize_threshold);
+      } else if(ProbeForSearch(key, hash_value) == nullptr) {
+        // Values could still be appended to an existing key without
+        // growing the array
+        return false;
+      }
     }
     
     // This function fills in hash value and key and chahges the
     // status code automatically if the entry was free or deleted
     // and it returns the pointer to the place where new value should
     // be inserted
-    Data<ValueType> *value_p = ProbeForInsert(key);
+    NoValuePruning no_pruning{};
+    
+    Data<ValueType> *value_p = ProbeForInsert(key, hash_value, no_pruning);
+    if(value_p == nullptr) {
+      return false;
+    }
+    
     value_p->Init(value);
     
-    return;
+    return true;
+  }
+  
+  /*
+   * InsertWithPrune() - Inserts a value into the hash table, and removes
+   *                     existing values of the same key that satisfy the
+   *                     given predicate
+   *
+   * Pruning is lazy: it only happens if the key has an inline value, or the
+   * key value list of the key is full and would otherwise grow. So values
+   * satisfying the predicate might still be present after the insert. This
+   * is used to garbage collect values that are no longer needed (e.g. dead
+   * versions) without paying for a separate scan
+   *
+   * The predicate is called as prune_pred(const ValueType &) and returns
+   * true if the value should be removed. Returns false if the memory budget
+   * is exceeded, as Insert()
+   */
+  template <typename PrunePredicate>
+  inline bool InsertWithPrune(const KeyType &key,
+                              const ValueType &value,
+                              PrunePredicate prune_pred) {
+    return InsertWithPrune(key, key_hash_obj(key), value, prune_pred);
+  }
+  
+  /*
+   * InsertWithPrune() - Inserts with pruning and a hash value computed by
+   *                     the caller, as InsertWithHash()
+   */
+  template <typename PrunePredicate>
+  bool InsertWithPrune(const KeyType &key,
+                       uint64_t hash_value,
+                       const ValueType &value,
+                       PrunePredicate prune_pred) {
+    if(active_entry_count == resize_threshold) {
+      if(Resize() == true) {
+        assert(active_entry_count < resize_threshold);
+      } else if(ProbeForSearch(key, hash_value) == nullptr) {
+        return false;
+      }
+    }
+    
+    Data<ValueType> *value_p = ProbeForInsert(key, hash_value, prune_pred);
+    if(value_p == nullptr) {
+      return false;
+    }
+    
+    value_p->Init(value);
+    
+    return true;
   }
   
  private:
@@ -872,6 +1947,7 @@ class HashTable_OA_KVL {
     // values first
     if(entry_p->HasKeyValueList() == true) {
       entry_p->kv_p->DestroyAllValues();
+      ReleaseMemory(KeyValueList::GetAllocSize(entry_p->kv_p->capacity));
       
       // Free its memory to avoid leak
       free(entry_p->kv_p);
@@ -883,6 +1959,8 @@ class HashTable_OA_KVL {
     // Mark it as deleted - stop point for insertion, but does not
     // terminate probing for value search
     entry_p->status = HashEntry::StatusCode::DELETED;
+    deleted_entry_count++;
+    AssignEntryMatchBit(entry_p, true);
 
     // At last decrease the entry counter
     active_entry_count--;
@@ -900,14 +1978,23 @@ class HashTable_OA_KVL {
    *
    * DeleteKey() invalidates iterators on the entry having key
    */
-  bool DeleteKey(const KeyType &key) {
-    HashEntry *entry_p = ProbeForSearch(key);
+  inline bool DeleteKey(const KeyType &key) {
+    return DeleteKeyWithHash(key, key_hash_obj(key));
+  }
+  
+  /*
+   * DeleteKeyWithHash() - Deletes a key whose hash value has been computed
+   *                       by the caller, as InsertWithHash()
+   */
+  bool DeleteKeyWithHash(const KeyType &key, uint64_t hash_value) {
+    HashEntry *entry_p = ProbeForSearch(key, hash_value);
     if(entry_p == nullptr) {
       return false;
     }
     
     // This also updates active_entry_count
     DeleteEntry(entry_p);
+    NotifyTombstone();
     
     return true;
   }
@@ -919,8 +2006,17 @@ class HashTable_OA_KVL {
    * and the second pointer is returned as the number of elements to
    * fetch as values
    */
-  std::pair<ValueType *, uint32_t> GetValue(const KeyType &key) {
-    HashEntry *entry_p = ProbeForSearch(key);
+  inline std::pair<ValueType *, uint32_t> GetValue(const KeyType &key) {
+    return GetValueWithHash(key, key_hash_obj(key));
+  }
+  
+  /*
+   * GetValueWithHash() - Searches a key whose hash value has been computed
+   *                      by the caller, as InsertWithHash()
+   */
+  std::pair<ValueType *, uint32_t> GetValueWithHash(const KeyType &key,
+                                                    uint64_t hash_value) {
+    HashEntry *entry_p = ProbeForSearch(key, hash_value);
     
     // There could be three results:
     //   1. Key not found, return nullptr and value count = 0
@@ -943,8 +2039,16 @@ class HashTable_OA_KVL {
    * multiple values, to save some overhead if only the first value is cared
    * about
    */
-  ValueType *GetFirstValue(const KeyType &key) {
-    HashEntry *entry_p = ProbeForSearch(key);
+  inline ValueType *GetFirstValue(const KeyType &key) {
+    return GetFirstValueWithHash(key, key_hash_obj(key));
+  }
+  
+  /*
+   * GetFirstValueWithHash() - Gets the first value of a key whose hash value
+   *                           has been computed by the caller
+   */
+  ValueType *GetFirstValueWithHash(const KeyType &key, uint64_t hash_value) {
+    HashEntry *entry_p = ProbeForSearch(key, hash_value);
 
     if(entry_p == nullptr) {
       return nullptr;
@@ -955,6 +2059,158 @@ class HashTable_OA_KVL {
     return &entry_p->value.data;
   }
   
+  /*
+   * GetValueAndMark() - Calls the match function on every value of the key,
+   *                     and sets match bits of values that match
+   *
+   * The match function is called as match_obj(const ValueType &) and
+   * returns whether the value matches the probe row, e.g. whether a
+   * residual join predicate holds; It could also emit the joined row.
+   * Returns the number of values matched
+   *
+   * Bits are set with relaxed atomic operations, so probes could run in
+   * multiple threads concurrently as long as the table is not modified.
+   * ForEachUnmatched() should be called after all probes have finished
+   */
+  template <typename MatchFunc>
+  inline uint32_t GetValueAndMark(const KeyType &key, MatchFunc match_obj) {
+    return GetValueAndMarkWithHash(key, key_hash_obj(key), match_obj);
+  }
+  
+  /*
+   * GetValueAndMarkWithHash() - Marks values of a key whose hash value has
+   *                             been computed by the caller
+   */
+  template <typename MatchFunc>
+  uint32_t GetValueAndMarkWithHash(const KeyType &key,
+                                   uint64_t hash_value,
+                                   MatchFunc match_obj) {
+    static_assert(MatchPolicy::IS_ENABLED == true,
+                  "Matches are tracked only with TrackMatches");
+    
+    HashEntry *entry_p = ProbeForSearch(key, hash_value);
+    if(entry_p == nullptr) {
+      return 0;
+    } else if(entry_p->HasKeyValueList() == false) {
+      if(match_obj(static_cast<const ValueType &>(entry_p->value.data)) == \
+         false) {
+        return 0;
+      }
+      
+      SetMatchBit(GetEntryMatchBitmap(), entry_p - entry_list_p);
+      
+      return 1;
+    }
+    
+    KeyValueList *kv_p = entry_p->kv_p;
+    uint64_t *bitmap = kv_p->GetMatchBitmap();
+    
+    uint32_t match_count = 0;
+    for(uint32_t i = 0;i < kv_p->size;i++) {
+      if(match_obj(static_cast<const ValueType &>(kv_p->data[i].data)) == \
+         true) {
+        SetMatchBit(bitmap, i);
+        match_count++;
+      }
+    }
+    
+    return match_count;
+  }
+  
+  /*
+   * ForEachUnmatched() - Calls the callback on every value whose match bit
+   *                      is not set
+   *
+   * The callback is called as cb(const KeyType &, const ValueType &), which
+   * is how a right or full outer join emits build rows without a match.
+   * The entry bitmap is walked a word at a time, and only clear bits are
+   * visited by counting trailing zeros, so free entries and entries whose
+   * inline value has been matched are skipped without touching the array.
+   * Returns the number of values reported
+   */
+  template <typename CallbackType>
+  uint64_t ForEachUnmatched(CallbackType cb) {
+    static_assert(MatchPolicy::IS_ENABLED == true,
+                  "Matches are tracked only with TrackMatches");
+    
+    const uint64_t *entry_bitmap = GetEntryMatchBitmap();
+    uint64_t word_count = (GetSlotCount() + 63) / 64;
+    uint64_t unmatched_count = 0;
+    
+    for(uint64_t w = 0;w < word_count;w++) {
+      // Bits after the last entry are always set
+      uint64_t pending = ~entry_bitmap[w];
+      
+      while(pending != 0) {
+        HashEntry *entry_p = entry_list_p + w * 64 + __builtin_ctzl(pending);
+        pending &= pending - 1;
+        
+        // Entries without values always have the bit set
+        assert(entry_p->IsValidEntry() == true);
+        
+        if(entry_p->HasKeyValueList() == false) {
+          cb(entry_p->key.data,
+             static_cast<const ValueType &>(entry_p->value.data));
+          unmatched_count++;
+          
+          continue;
+        }
+        
+        KeyValueList *kv_p = entry_p->kv_p;
+        const uint64_t *value_bitmap = kv_p->GetMatchBitmap();
+        
+        for(uint32_t base = 0;base < kv_p->size;base += 64) {
+          uint64_t pending_value = ~value_bitmap[base / 64];
+          if(kv_p->size - base < 64) {
+            pending_value &= (0x1UL << (kv_p->size - base)) - 1;
+          }
+          
+          while(pending_value != 0) {
+            uint32_t i = base + __builtin_ctzl(pending_value);
+            pending_value &= pending_value - 1;
+            
+            cb(entry_p->key.data,
+               static_cast<const ValueType &>(kv_p->data[i].data));
+            unmatched_count++;
+          }
+        }
+      }
+    }
+    
+    return unmatched_count;
+  }
+  
+  /*
+   * ClearMatches() - Clears match bits of all values
+   *
+   * This is needed before reusing a table for another join. Bits of a new
+   * table are clear, and values inserted later start with a clear bit
+   */
+  void ClearMatches() {
+    static_assert(MatchPolicy::IS_ENABLED == true,
+                  "Matches are tracked only with TrackMatches");
+    
+    uint64_t *entry_bitmap = GetEntryMatchBitmap();
+    std::memset(entry_bitmap, 0xFF, GetMatchBitmapSize(GetSlotCount()));
+    
+    for(uint64_t i = 0;i < GetSlotCount();i++) {
+      HashEntry *entry_p = entry_list_p + i;
+      if(entry_p->IsValidEntry() == false) {
+        continue;
+      }
+      
+      AssignMatchBit(entry_bitmap, i, false);
+      
+      if(entry_p->HasKeyValueList() == true) {
+        std::memset(entry_p->kv_p->GetMatchBitmap(),
+                    0x00,
+                    GetMatchBitmapSize(entry_p->kv_p->capacity));
+      }
+    }
+    
+    return;
+  }
+  
   /*
    * GetOnlyInlinedValue() - Return inline values for an entry found
    *
@@ -977,29 +2233,203 @@ class HashTable_OA_KVL {
 
     return &entry_p->value.data;
   }
+  
+ private:
+  
+  /*
+   * class InterleavedProbeState - The state machine of a search probe that
+   *                               is executed by RunInterleaved()
+   *
+   * A probe suspends every time it is about to access a cache line that it
+   * has not touched, after issuing a prefetch for that line. Consecutive
+   * entries on the same cache line are examined without suspension, since
+   * they are already in the cache after the first access. If the key is found
+   * and it has a key value list, the probe suspends one more time to prefetch
+   * the list before the values are handed to the call back
+   */
+  template <typename CallbackType>
+  class InterleavedProbeState {
+   private:
+    HashTable_OA_KVL *table_p;
+    const KeyType *key_list;
+    CallbackType *cb_p;
+    
+    // Index of the key in the key list and its hash value
+    uint64_t key_index;
+    uint64_t hash_value;
+    
+    // Current position of the probe
+    uint64_t index;
+    HashEntry *entry_p;
+    
+    /*
+     * GetLastCacheLine() - Returns the cache line number of the last byte
+     *                      of an entry
+     */
+    static uintptr_t GetLastCacheLine(HashEntry *p) {
+      return (reinterpret_cast<uintptr_t>(p + 1) - 1) / CACHE_LINE_SIZE;
+    }
+    
+   public:
+    
+    /*
+     * Init() - Sets up the context shared by all tasks
+     */
+    void Init(HashTable_OA_KVL *p_table_p,
+              const KeyType *p_key_list,
+              CallbackType *p_cb_p) {
+      table_p = p_table_p;
+      key_list = p_key_list;
+      cb_p = p_cb_p;
+      
+      return;
+    }
+    
+    /*
+     * Start() - Computes the starting point of probing and prefetches it
+     */
+    void Start(uint64_t p_key_index) {
+      key_index = p_key_index;
+      
+      hash_value = table_p->key_hash_obj(key_list[key_index]);
+      index = hash_value & table_p->index_mask;
+      entry_p = table_p->entry_list_p + index;
+      
+      PrefetchForRead(entry_p);
+      
+      return;
+    }
+    
+    /*
+     * Step() - Examines entries until the probe finishes or it reaches
+     *          an entry on a new cache line
+     *
+     * If the key has been found and it has a key value list then the state
+     * is changed to reporting the list, which is marked by index being
+     * beyond the end of the array
+     */
+    bool Step() {
+      if(index == table_p->GetSlotCount()) {
+        (*cb_p)(key_index,
+                std::make_pair(&entry_p->kv_p->data[0].data,
+                               entry_p->kv_p->size));
+        
+        return true;
+      }
+      
+      while(entry_p->IsProbeEndForSearch() == false) {
+        if((entry_p->IsDeleted() == false) && \
+           (entry_p->hash_value == hash_value) && \
+           (table_p->key_eq_obj(key_list[key_index], entry_p->key) == true)) {
+          if(entry_p->HasKeyValueList() == false) {
+            (*cb_p)(key_index, std::make_pair(&entry_p->value.data, 1U));
+            
+            return true;
+          }
+          
+          // Suspend until the key value list is in the cache
+          PrefetchForRead(entry_p->kv_p);
+          index = table_p->GetSlotCount();
+          
+          return false;
+        }
+        
+        uintptr_t prev_line = GetLastCacheLine(entry_p);
+        table_p->GetNextEntry(&entry_p, &index);
+        
+        // The next entry is not fully covered by the line we have touched
+        if(GetLastCacheLine(entry_p) != prev_line) {
+          PrefetchForRead(reinterpret_cast<char *>(entry_p + 1) - 1);
+          
+          return false;
+        }
+      }
+      
+      // Key not found
+      (*cb_p)(key_index, std::make_pair(static_cast<ValueType *>(nullptr), 0U));
+      
+      return true;
+    }
+  };
+  
+ public:
+  
+  /*
+   * GetValueInterleaved() - Searches a batch of keys, interleaving their
+   *                         probes to overlap cache misses
+   *
+   * For each key in the list the call back is invoked exactly once as:
+   *
+   *   cb(key_index, std::pair<ValueType *, uint32_t>)
+   *
+   * where the second argument has the same meaning as the return value of
+   * GetValue(). Call backs are invoked in the order that probes finish, which
+   * is not necessarily the order of keys in the list
+   *
+   * group_size is the number of probes in flight. It should be large enough
+   * to cover the memory latency, but not too large to cause the prefetched
+   * lines to be evicted before being used
+   */
+  template <uint64_t group_size = DEFAULT_INTERLEAVE_GROUP_SIZE,
+            typename CallbackType>
+  void GetValueInterleaved(const KeyType *key_list,
+                           uint64_t key_count,
+                           CallbackType cb) {
+    InterleavedProbeState<CallbackType> state_list[group_size];
+    for(uint64_t i = 0;i < group_size;i++) {
+      state_list[i].Init(this, key_list, &cb);
+    }
+    
+    RunInterleaved<group_size>(state_list, key_count);
+    
+    // Probes of interleaved lookups are not counted
+    stats.Add(StatsCounter::LOOKUP, key_count);
+    
+    return;
+  }
+
+ public:
 
- private:
-  
   /*
-   * class Iterator - Supports iterating on the hash table
+   * class GenericIterator - Supports iterating on the hash table
+   *
+   * This class is a standard forward iterator, which is instanciated twice:
+   * once with ValueType as iterator, and once with const ValueType as
+   * const_iterator. Dereferencing the iterator yields the value, and the key
+   * of the current value could be obtained by calling GetKey()
    *
-   * This class is non-standard iterator implementation:
+   * Note that:
    *
    *   1. The size of the object is larger than the size of a normal iterator
    *      (8 bytes)
-   *   2. The ++ and -- operation is not constant time - in the worst case it
+   *   2. The ++ operation is not constant time - in the worst case it
    *      could be linear on the size of the hash table
    *      *SO PLEASE* do not use the iterator for full scan unless it is
    *      very necessary
    */
-  class Iterator {
+  template <typename IteratorValueType>
+  class GenericIterator {
     friend class HashTable_OA_KVL;
+
+    // Allows conversion from iterator to const_iterator
+    template <typename>
+    friend class GenericIterator;
+
+   public:
+
+    // Types required by std::iterator_traits
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename std::remove_const<IteratorValueType>::type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = IteratorValueType *;
+    using reference = IteratorValueType &;
+
    private:
     // Current hash entry
     HashEntry *entry_p;
-    ValueType *value_p;
+    IteratorValueType *value_p;
     uint32_t remaining;
-    
+
     /*
      * GotoNextEntry() - Moves the cursor to the next valid entry in the
      *                   hash table.
@@ -1015,10 +2445,10 @@ class HashTable_OA_KVL {
       while(entry_p->IsValidEntry() == false) {
         entry_p++;
       }
-      
+
       return;
     }
-    
+
     /*
      * Advance() - Advance the iterator by 1 element
      *
@@ -1029,12 +2459,12 @@ class HashTable_OA_KVL {
       // Move index in the current bucket to the next value
       remaining--;
       value_p++;
-      
+
       // If we have reached the end of the current value list
       // which happens everytime for a single map
       if(remaining == 0) {
         GotoNextEntry();
-        
+
         if(entry_p->HasKeyValueList() == false) {
           // Special case: inlined value storage
           // just direct the pointer to the inlined value
@@ -1046,47 +2476,75 @@ class HashTable_OA_KVL {
           value_p = &entry_p->kv_p->data[0].data;
         }
       }
-      
+
       return;
     }
-    
+
    public:
 
+    /*
+     * Default Constructor - Forward iterators must be default constructible
+     *
+     * The iterator constructed this way is singular, and could only be
+     * assigned to
+     */
+    GenericIterator() :
+      entry_p{nullptr},
+      value_p{nullptr},
+      remaining{0}
+    {}
+
     /*
      * Constructor
      */
-    Iterator(HashEntry *p_entry_p,
-             ValueType *p_value_p,
-             uint32_t p_remaining) :
+    GenericIterator(HashEntry *p_entry_p,
+                    IteratorValueType *p_value_p,
+                    uint32_t p_remaining) :
       entry_p{p_entry_p},
       value_p{p_value_p},
       remaining{p_remaining}
     {}
-    
+
     /*
      * Copy Constructor
      */
-    Iterator(const Iterator &other) :
+    GenericIterator(const GenericIterator &other) :
       entry_p{other.entry_p},
       value_p{other.value_p},
       remaining{other.remaining}
     {}
-    
+
+    /*
+     * Converting Constructor - Builds a const_iterator from an iterator
+     *
+     * The reverse direction is disabled since it would drop the constness
+     * of the value
+     */
+    template <typename OtherValueType,
+              typename = typename std::enable_if<
+                std::is_convertible<OtherValueType *,
+                                    IteratorValueType *>::value>::type>
+    GenericIterator(const GenericIterator<OtherValueType> &other) :
+      entry_p{other.entry_p},
+      value_p{other.value_p},
+      remaining{other.remaining}
+    {}
+
     /*
      * operator=() - Assignment operator
      */
-    Iterator &operator=(const Iterator &other) {
+    GenericIterator &operator=(const GenericIterator &other) {
       entry_p = other.entry_p;
       value_p = other.value_p;
       remaining = other.remaining;
-      
+
       return *this;
     }
 
     /*
     * Prefix operator++() - Advances the iterator by one element
     */
-    Iterator &operator++() {
+    GenericIterator &operator++() {
      Advance();
 
      return *this;
@@ -1099,11 +2557,11 @@ class HashTable_OA_KVL {
     * Note that this operation is slower than the prefix++ since it copy
     * constructs an instance of the value each time it is called
     */
-    Iterator operator++(int) {
+    GenericIterator operator++(int) {
       // Copy construct one
       // Note that this operation is pretty expensive
       // so use prefix ++ as often as possible
-      Iterator ret = *this;
+      GenericIterator ret = *this;
 
       Advance();
 
@@ -1116,47 +2574,75 @@ class HashTable_OA_KVL {
     * Since "remaining" and value_p actually refers to the same thing, we only
     * compare "remaining"
     */
-    bool operator==(const Iterator &other) const {
+    bool operator==(const GenericIterator &other) const {
      return (entry_p == other.entry_p) && \
             (remaining == other.remaining);
     }
-    
+
     /*
      * operator!=() - Compares two iterators for non-equality
      */
-    bool operator!=(const Iterator &other) const {
+    bool operator!=(const GenericIterator &other) const {
       return !(*this == other);
     }
 
     /*
      * operator*() - Pointer dereference
      *
-     * We return a mutable reference of ValueType to the caller
-     * such that the caller is free to modify the value
-     * already stored in the hash table
+     * For iterator we return a mutable reference of ValueType to the caller
+     * such that the caller is free to modify the value already stored in the
+     * hash table. For const_iterator the reference is constant
      */
-    ValueType &operator*() {
+    reference operator*() const {
       return *value_p;
     }
-    
+
+    /*
+     * operator->() - Member access on the value
+     */
+    pointer operator->() const {
+      return value_p;
+    }
+
     /*
      * GetKey() - Returns a constant reference to the key
      *
      * Note that key object stored in the hash table is not allowed to be
      * modified since otherwise the hash entry would be in the wrong position
      */
-    const KeyType &GetKey() {
+    const KeyType &GetKey() const {
       return entry_p->key.data;
     }
+    
+    /*
+     * GetHashValue() - Returns the hash value of the key stored in the entry
+     *
+     * This allows the key to be moved into another table or a spill file
+     * without hashing it again
+     */
+    uint64_t GetHashValue() const {
+      return entry_p->hash_value;
+    }
   };
-  
+
+  // Iterators that conform to the standard naming
+  using iterator = GenericIterator<ValueType>;
+  using const_iterator = GenericIterator<const ValueType>;
+
+  // This is kept for compatibility with the previous naming
+  using Iterator = iterator;
+
  private:
 
   /*
    * BuildIterator() - Given a HashEntry, build an iterator pointing to
    *                   the first element in that entry
+   *
+   * Since HashEntry does not carry constness with it, this function could
+   * be used to build both iterator and const_iterator
    */
-  Iterator BuildIterator(HashEntry *entry_p) {
+  template <typename IteratorType = iterator>
+  IteratorType BuildIterator(HashEntry *entry_p) const {
     ValueType *value_p = &entry_p->value.data;
     uint32_t remaining = 1;
 
@@ -1170,11 +2656,45 @@ class HashTable_OA_KVL {
     }
 
     // Construct an iterator
-    return Iterator{entry_p, value_p, remaining};
+    return IteratorType{entry_p, value_p, remaining};
   }
-  
+
+  /*
+   * GetFirstValidEntry() - Returns the first valid entry in the array, or
+   *                        the sentinel entry if the table is empty
+   */
+  HashEntry *GetFirstValidEntry() const {
+    HashEntry *entry_p = entry_list_p;
+
+    // If the hash table is empty then directly return the sentinel
+    if(active_entry_count == 0) {
+      return entry_p + GetSlotCount();
+    }
+
+    while(entry_p->IsValidEntry() == false) {
+      entry_p++;
+    }
+
+    return entry_p;
+  }
+
+  /*
+   * GetNextValidEntry() - Returns the next valid entry after the given one,
+   *                       or the sentinel entry if there is none
+   */
+  static HashEntry *GetNextValidEntry(HashEntry *entry_p) {
+    entry_p++;
+
+    // The sentinel entry is always valid which stops the loop
+    while(entry_p->IsValidEntry() == false) {
+      entry_p++;
+    }
+
+    return entry_p;
+  }
+
  public:
-  
+
   /*
    * End() - Returns an iterator that points to the end it of the hash table
    *
@@ -1183,9 +2703,9 @@ class HashTable_OA_KVL {
    * object which stops iteration when the iterator reaches there.
    */
   inline Iterator End() {
-    return BuildIterator(entry_list_p + entry_count);
+    return BuildIterator(entry_list_p + GetSlotCount());
   }
-  
+
   /*
    * Begin() - Return an iterator pointing to the first element of a given key
    */
@@ -1206,18 +2726,53 @@ class HashTable_OA_KVL {
    * Begin() - Get an iterator pointing to the beinning of the HashTeble
    */
   inline Iterator Begin() {
-    // If the hash table is empty then directly return end iterator
-    if(active_entry_count == 0) {
-      return End();
-    }
+    // We are guaranteed that this is not the sentinel unless the table
+    // is empty
+    return BuildIterator(GetFirstValidEntry());
+  }
 
-    HashEntry *entry_p = entry_list_p;
-    while(entry_p->IsValidEntry() == false) {
-      entry_p++;
-    }
+  /*
+   * begin() - Standard name of Begin(), which makes range-for and STL
+   *           algorithms work on the hash table
+   */
+  inline iterator begin() {
+    return Begin();
+  }
 
-    // We are guaranteed that this is not the sentinel
-    return BuildIterator(entry_p);
+  /*
+   * end() - Standard name of End()
+   */
+  inline iterator end() {
+    return End();
+  }
+
+  /*
+   * begin() const - Returns a const_iterator to the first element
+   */
+  inline const_iterator begin() const {
+    return BuildIterator<const_iterator>(GetFirstValidEntry());
+  }
+
+  /*
+   * end() const - Returns a const_iterator to the sentinel entry
+   */
+  inline const_iterator end() const {
+    return BuildIterator<const_iterator>(entry_list_p + GetSlotCount());
+  }
+
+  /*
+   * cbegin() - Returns a const_iterator even if the table is not const
+   */
+  inline const_iterator cbegin() const {
+    return begin();
+  }
+
+  /*
+   * cend() - Returns a const_iterator to the end even if the table is
+   *          not const
+   */
+  inline const_iterator cend() const {
+    return end();
   }
 
   /*
@@ -1256,8 +2811,11 @@ class HashTable_OA_KVL {
    *
    * Delete() operation invalidates all iterators on the entry being
    * deleted from, but preserves validity of all other iterators
+   *
+   * The iterator to the element after the deleted one is returned, such
+   * that elements could be deleted while iterating over the table
    */
-  void Delete(const Iterator &it) {
+  iterator Delete(const const_iterator &it) {
     HashEntry *entry_p = it.entry_p;
 
     assert(entry_p->IsValidEntry() == true);
@@ -1265,8 +2823,9 @@ class HashTable_OA_KVL {
     if(entry_p->HasKeyValueList() == false) {
       // This will update active_entry_count
       DeleteEntry(entry_p);
+      NotifyTombstone();
 
-      return;
+      return BuildIterator(GetNextValidEntry(entry_p));
     }
 
     // If not the case then we might be on a key value list
@@ -1278,18 +2837,322 @@ class HashTable_OA_KVL {
       // If the size of the key value list then it is equivalent to
       // having an inlined value - just destroy the entire entry
       DeleteEntry(entry_p);
-    } else {
-      // Otherwise just delete the element pointed to by remaining
-      // which is an index
-      kv_p->DeleteIndex(kv_p->size - it.remaining);
+      NotifyTombstone();
+
+      return BuildIterator(GetNextValidEntry(entry_p));
+    }
+
+    // Otherwise just delete the element pointed to by remaining
+    // which is an index
+    uint32_t index = kv_p->size - it.remaining;
+    kv_p->DeleteIndex(index);
+
+    // Elements after the deleted one have been shifted forward by one
+    if(index < kv_p->size) {
+      return iterator{entry_p, &kv_p->data[index].data, it.remaining - 1};
+    }
+
+    return BuildIterator(GetNextValidEntry(entry_p));
+  }
+
+  /*
+   * DeleteIf() - Removes all values for which the predicate returns true
+   *
+   * The predicate is called as pred(const KeyType &, const ValueType &) on
+   * every value exactly once. Key value lists are compacted in place without
+   * shifting the remaining values more than once, and a key value list left
+   * with a single value is turned back into an inline value. Keys without
+   * any value left are removed
+   *
+   * Removing a key from an open addressing table leaves a tombstone, so if
+   * any key is removed (or there are tombstones from previous deletes) the
+   * table is rehashed in place at the same size after the scan. Therefore
+   * no DELETED entry exists after this function returns, and the cost is
+   * a single scan plus at most one rehash regardless of the number of values
+   * deleted
+   *
+   * This function invalidates all iterators. Returns the number of values
+   * removed
+   */
+  template <typename Predicate>
+  inline uint64_t DeleteIf(Predicate pred) {
+    return DeleteIfWithHash([&pred](const KeyType &key,
+                                    uint64_t,
+                                    const ValueType &value) {
+      return pred(key, value);
+    });
+  }
+
+  /*
+   * DeleteIfWithHash() - Same as DeleteIf(), but the predicate also takes
+   *                      the hash value cached in the entry
+   *
+   * The predicate is called as
+   *
+   *   pred(const KeyType &, uint64_t hash_value, const ValueType &)
+   *
+   * such that callers partitioning keys by hash do not hash them again
+   */
+  template <typename Predicate>
+  uint64_t DeleteIfWithHash(Predicate pred) {
+    uint64_t deleted_count = 0;
+    bool has_tombstone = false;
+
+    for(uint64_t i = 0;i < GetSlotCount();i++) {
+      HashEntry *entry_p = entry_list_p + i;
+
+      if(entry_p->IsValidEntry() == false) {
+        if(entry_p->IsFree() == false) {
+          has_tombstone = true;
+        }
+
+        continue;
+      }
+
+      const KeyType &key = entry_p->key.data;
+      uint64_t hash_value = entry_p->hash_value;
+
+      if(entry_p->HasKeyValueList() == false) {
+        if(pred(key, hash_value, entry_p->value.data) == true) {
+          // This will update active_entry_count
+          DeleteEntry(entry_p);
+
+          deleted_count++;
+          has_tombstone = true;
+        }
+
+        continue;
+      }
+
+      KeyValueList *kv_p = entry_p->kv_p;
+      auto value_pred = [&pred, &key, hash_value](const ValueType &value) {
+        return pred(key, hash_value, value);
+      };
+
+      deleted_count += kv_p->RemoveIf(value_pred);
+
+      if(kv_p->size == 0) {
+        DeleteEntry(entry_p);
+
+        has_tombstone = true;
+      } else if(kv_p->size == 1) {
+        // Move the only value back into the entry to save a pointer
+        // dereference on later lookups
+        entry_p->value.Init(kv_p->data[0]);
+        if(MatchPolicy::IS_ENABLED == true) {
+          AssignEntryMatchBit(entry_p,
+                              TestMatchBit(kv_p->GetMatchBitmap(), 0));
+        }
+        
+        kv_p->DestroyAllValues();
+        ReleaseMemory(KeyValueList::GetAllocSize(kv_p->capacity));
+        free(kv_p);
+
+        entry_p->status = HashEntry::StatusCode::INLINE_VALUE;
+      }
     }
 
+    if(has_tombstone == true) {
+      Rehash(entry_count);
+    }
+
+    return deleted_count;
+  }
+  
+  /*
+   * Merge() - Moves all keys and values of another table into this table
+   *
+   * If a key does not exist in this table then its entry is moved, which
+   * includes the key value list of the entry, so values on the list are not
+   * copied. If the key exists then values are appended after values already
+   * in this table. The table is grown at most once before moving
+   *
+   * Both tables must use the same hash function, since hash values cached
+   * in entries are reused. The other table is left empty but valid
+   */
+  void Merge(HashTable_OA_KVL &&other) {
+    MergeImpl<false>(other);
+    
+    return;
+  }
+  
+  /*
+   * MergeDisjoint() - Moves all keys and values of another table into this
+   *                   table, given that no key exists in both
+   *
+   * This is cheaper than Merge() since keys are not compared, and every
+   * entry of the other table is moved as in a resize. This is the case for
+   * tables built from different hash partitions
+   */
+  void MergeDisjoint(HashTable_OA_KVL &&other) {
+    MergeImpl<true>(other);
+    
+    return;
+  }
+  
+ private:
+  
+  /*
+   * AssignLastValueMatchBit() - Changes the match bit of the last value of
+   *                             an entry with a KVL
+   */
+  inline void AssignLastValueMatchBit(HashEntry *entry_p, bool value) {
+    assert(entry_p->HasKeyValueList() == true);
+    
+    AssignMatchBit(entry_p->kv_p->GetMatchBitmap(),
+                   entry_p->kv_p->size - 1,
+                   value);
+    
+    return;
+  }
+  
+  /*
+   * MergeImpl() - Implements Merge() and MergeDisjoint()
+   */
+  template <bool is_disjoint>
+  void MergeImpl(HashTable_OA_KVL &other) {
+    assert(&other != this);
+    
+    ReserveForMerge(other.active_entry_count);
+    
+    uint64_t remaining = other.active_entry_count;
+    HashEntry *other_entry_p = other.entry_list_p;
+    while(remaining > 0) {
+      if(other_entry_p->IsValidEntry() == false) {
+        other_entry_p++;
+        
+        continue;
+      }
+      
+      remaining--;
+      
+      HashEntry *entry_p = nullptr;
+      if(is_disjoint == true) {
+        entry_p = ProbeForResize(other_entry_p->hash_value);
+      } else {
+        entry_p = ProbeForMerge(other_entry_p->hash_value,
+                                other_entry_p->key.data);
+      }
+      
+      if(entry_p->IsValidEntry() == false) {
+        if(entry_p->IsDeleted() == true) {
+          deleted_entry_count--;
+        }
+        
+        // This copies the pointer to the KVL if there is one
+        other_entry_p->CopyTo(entry_p);
+        active_entry_count++;
+        
+        if(MatchPolicy::IS_ENABLED == true) {
+          AssignEntryMatchBit(
+            entry_p,
+            TestMatchBit(other.GetEntryMatchBitmap(),
+                         other_entry_p - other.entry_list_p));
+        }
+        
+        if(other_entry_p->HasKeyValueList() == true) {
+          uint64_t size = \
+            KeyValueList::GetAllocSize(other_entry_p->kv_p->capacity);
+          other.ReleaseMemory(size);
+          AcquireMemory(size, false);
+        }
+        
+        // Destroy key AND/OR inline value but not the KVL
+        other_entry_p->Fini();
+      } else {
+        NoValuePruning no_pruning{};
+        
+        if(other_entry_p->HasKeyValueList() == false) {
+          AppendValue(entry_p, no_pruning, false)->Init(other_entry_p->value);
+          
+          if(MatchPolicy::IS_ENABLED == true) {
+            AssignLastValueMatchBit(
+              entry_p,
+              TestMatchBit(other.GetEntryMatchBitmap(),
+                           other_entry_p - other.entry_list_p));
+          }
+        } else {
+          KeyValueList *kv_p = other_entry_p->kv_p;
+          for(uint32_t i = 0;i < kv_p->size;i++) {
+            AppendValue(entry_p, no_pruning, false)->Init(kv_p->data[i]);
+            
+            if(MatchPolicy::IS_ENABLED == true) {
+              AssignLastValueMatchBit(
+                entry_p,
+                TestMatchBit(kv_p->GetMatchBitmap(), i));
+            }
+          }
+          
+          kv_p->DestroyAllValues();
+          other.ReleaseMemory(KeyValueList::GetAllocSize(kv_p->capacity));
+          free(kv_p);
+        }
+        
+        other_entry_p->Fini();
+      }
+      
+      other_entry_p++;
+    }
+    
+    // All entries of the other table are free now, including tombstones
+    for(uint64_t i = 0;i < other.GetSlotCount();i++) {
+      other.entry_list_p[i].status = HashEntry::StatusCode::FREE;
+    }
+    
+    std::memset(other.GetEntryMatchBitmap(),
+                0xFF,
+                GetMatchBitmapSize(other.GetSlotCount()));
+    
+    other.active_entry_count = 0;
+    other.deleted_entry_count = 0;
+    
+    // All KVLs of the other table have been moved or freed
+    assert(other.memory_size == other.GetArrayMemorySize());
+    
     return;
   }
   
   // Statistical data
  public:
+  
+  /*
+   * GetStats() - Returns the current value of operation counters
+   *
+   * All counters are zero unless StatsType is CountingStats
+   */
+  OperationStatsSnapshot GetStats() const {
+    return stats.GetSnapshot();
+  }
+  
+  /*
+   * ResetStats() - Sets all operation counters to zero
+   */
+  void ResetStats() {
+    stats.Reset();
+    
+    return;
+  }
    
+  /*
+   * GetDeletedEntryCount() - Returns the number of entries that are marked
+   *                          as deleted, i.e. tombstones
+   */
+  uint64_t GetDeletedEntryCount() const {
+    return deleted_entry_count;
+  }
+  
+  /*
+   * SetEventListener() - Registers a listener for resize and growth events,
+   *                      or removes it if nullptr is given
+   *
+   * The listener must outlive the table or be removed before destroyed
+   */
+  void SetEventListener(TableEventListener *p_listener_p) {
+    listener_p = p_listener_p;
+    
+    return;
+  }
+  
   /*
    * GetMaxSearchSequenceLength() - Return the maximum length of a sequence in
    *                                the hash table
@@ -1308,7 +3171,7 @@ class HashTable_OA_KVL {
     
     // Loop through every entry and reset counter for every end point
     // of searching probe
-    for(uint64_t i = 0;i < entry_count;i++) {
+    for(uint64_t i = 0;i < GetSlotCount();i++) {
       if(entry_p->IsProbeEndForSearch() == true) {
         if(count > max_count) {
           max_count = count;
@@ -1339,7 +3202,7 @@ class HashTable_OA_KVL {
 
     // Loop through every entry and reset counter for every end point
     // of searching probe
-    for(uint64_t i = 0;i < entry_count;i++) {
+    for(uint64_t i = 0;i < GetSlotCount();i++) {
       if(entry_p->IsProbeEndForSearch() == true) {
         // Since we do not count invalid element as sequence of
         // length 1
@@ -1380,18 +3243,13 @@ class HashTable_OA_KVL {
 
     // Loop through every entry and reset counter for every end point
     // of searching probe
-    for(uint64_t i = 0;i < entry_count;i++) {
+    for(uint64_t i = 0;i < GetSlotCount();i++) {
       if(entry_p->IsProbeEndForSearch() == false) {
         uint64_t index = entry_p->hash_value & index_mask;
 
+        // Probes do not wrap back so i is never less than index
         uint64_t distance = i - index;
         
-        // Need to consider wrap back in which case
-        // the i is actually out of bound
-        if(i < index) {
-          distance = i + entry_count - index;
-        }
-        
         if(distance > max_distance) {
           max_distance = distance;
         }
@@ -1414,17 +3272,12 @@ class HashTable_OA_KVL {
 
     // Loop through every entry and reset counter for every end point
     // of searching probe
-    for(uint64_t i = 0;i < entry_count;i++) {
+    for(uint64_t i = 0;i < GetSlotCount();i++) {
       if(entry_p->IsProbeEndForSearch() == false) {
         uint64_t index = entry_p->hash_value & index_mask;
 
+        // Probes do not wrap back so i is never less than index
         uint64_t distance = i - index;
-
-        // Need to consider wrap back in which case
-        // the i is actually out of bound
-        if(i < index) {
-          distance = i + entry_count - index;
-        }
         
         total_distance += distance;
         key_count++;
@@ -1449,18 +3302,13 @@ class HashTable_OA_KVL {
 
     // Loop through every entry and reset counter for every end point
     // of searching probe
-    for(uint64_t i = 0;i < entry_count;i++) {
+    for(uint64_t i = 0;i < GetSlotCount();i++) {
       if(entry_p->IsProbeEndForSearch() == false) {
         uint64_t index = entry_p->hash_value & index_mask;
 
+        // Probes do not wrap back so i is never less than index
         uint64_t distance = i - index;
 
-        // Need to consider wrap back in which case
-        // the i is actually out of bound
-        if(i < index) {
-          distance = i + entry_count - index;
-        }
-
         double diff = (static_cast<uint64_t>(distance) - mean);
         diff_sum += diff * diff;
         
@@ -0,0 +1,359 @@
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include <utility>
+
+#include "HashTable_OA_KVL.h"
+
+namespace peloton {
+namespace index {
+
+/*
+ * class VersionedValue - A value together with the range of timestamps in
+ *                        which it is visible
+ *
+ * The version is visible to a reader with timestamp ts iff
+ * begin_ts <= ts < end_ts. A version that has not been retired has end_ts
+ * set to the maximum timestamp
+ */
+template <typename ValueType>
+class VersionedValue {
+ public:
+  ValueType value;
+  uint64_t begin_ts;
+  uint64_t end_ts;
+
+  /*
+   * IsVisible() - Returns whether the version is visible at a timestamp
+   */
+  inline bool IsVisible(uint64_t ts) const {
+    return (begin_ts <= ts) && (ts < end_ts);
+  }
+};
+
+/*
+ * class HashTable_OA_KVL_MVCC - Open addressing hash table whose values carry
+ *                               begin and end timestamps
+ *
+ * Each value inserted creates a new version that is visible from its begin
+ * timestamp onward, and retiring a value sets the end timestamp of its
+ * current version. Lookups are done with a read timestamp and only return
+ * versions visible at that timestamp
+ *
+ * Versions whose end timestamp is not greater than the garbage collection
+ * timestamp could not be seen by any reader, and are removed lazily while
+ * inserting into the same key, i.e. when the inline value would be turned
+ * into a key value list or when the key value list is full. This keeps the
+ * number of dead versions a reader has to skip bounded without a separate
+ * garbage collection pass
+ *
+ * This class is not thread-safe, in the same way as HashTable_OA_KVL
+ */
+template <typename KeyType,
+          typename ValueType,
+          typename KeyHashFunc = std::hash<KeyType>,
+          typename KeyEqualityChecker = std::equal_to<KeyType>,
+          typename ValueEqualityChecker = std::equal_to<ValueType>,
+          typename LoadFactorCalculator = LoadFactorHalfFull,
+          typename StatsType = NoStats>
+class HashTable_OA_KVL_MVCC {
+ public:
+
+  // End timestamp of versions that have not been retired
+  static constexpr uint64_t MAX_TIMESTAMP = UINT64_MAX;
+
+  using VersionType = VersionedValue<ValueType>;
+
+  using TableType = HashTable_OA_KVL<KeyType,
+                                     VersionType,
+                                     KeyHashFunc,
+                                     KeyEqualityChecker,
+                                     LoadFactorCalculator,
+                                     StatsType>;
+
+ private:
+
+  /*
+   * class DeadVersionChecker - Predicate for pruning versions that are not
+   *                            visible to any reader
+   */
+  class DeadVersionChecker {
+   public:
+    uint64_t gc_ts;
+
+    inline bool operator()(const VersionType &version) const {
+      return version.end_ts <= gc_ts;
+    }
+  };
+
+  TableType table;
+
+  ValueEqualityChecker value_eq_obj;
+
+  // All readers have timestamps not less than this
+  uint64_t gc_ts;
+
+  /*
+   * Constructor - Takes over an existing table of versions
+   */
+  HashTable_OA_KVL_MVCC(TableType &&p_table,
+                        const ValueEqualityChecker &p_value_eq_obj,
+                        uint64_t p_gc_ts) :
+    table{std::move(p_table)},
+    value_eq_obj{p_value_eq_obj},
+    gc_ts{p_gc_ts} {
+    return;
+  }
+
+ public:
+
+  /*
+   * Constructor
+   */
+  HashTable_OA_KVL_MVCC(
+    uint64_t init_entry_count = 0,
+    const KeyHashFunc &p_key_hash_obj = KeyHashFunc{},
+    const KeyEqualityChecker &p_key_eq_obj = KeyEqualityChecker{},
+    const ValueEqualityChecker &p_value_eq_obj = ValueEqualityChecker{},
+    const LoadFactorCalculator &p_lfc = LoadFactorCalculator{}) :
+    table{init_entry_count, p_key_hash_obj, p_key_eq_obj, p_lfc},
+    value_eq_obj{p_value_eq_obj},
+    gc_ts{0} {
+    return;
+  }
+
+  // Moves are done by the underlying table in O(1)
+  HashTable_OA_KVL_MVCC(HashTable_OA_KVL_MVCC &&) = default;
+  HashTable_OA_KVL_MVCC &operator=(HashTable_OA_KVL_MVCC &&) = default;
+
+  /*
+   * Swap() - Swaps content of two tables in O(1)
+   */
+  void Swap(HashTable_OA_KVL_MVCC &other) {
+    table.Swap(other.table);
+    std::swap(value_eq_obj, other.value_eq_obj);
+    std::swap(gc_ts, other.gc_ts);
+
+    return;
+  }
+
+  /*
+   * Clone() - Returns a deep copy of the table including all versions
+   */
+  HashTable_OA_KVL_MVCC Clone() const {
+    return HashTable_OA_KVL_MVCC{table.Clone(), value_eq_obj, gc_ts};
+  }
+
+  /*
+   * SetGarbageCollectionTimestamp() - Sets the timestamp below which no
+   *                                   reader will read
+   *
+   * This is usually the timestamp of the oldest active transaction. Versions
+   * that end at or before this timestamp are pruned on later inserts
+   */
+  void SetGarbageCollectionTimestamp(uint64_t p_gc_ts) {
+    // Readers that have been promised a snapshot could not lose it
+    assert(p_gc_ts >= gc_ts);
+
+    gc_ts = p_gc_ts;
+
+    return;
+  }
+
+  /*
+   * GetGarbageCollectionTimestamp()
+   */
+  inline uint64_t GetGarbageCollectionTimestamp() const {
+    return gc_ts;
+  }
+
+  /*
+   * Insert() - Inserts a new version of a value that becomes visible at
+   *            begin_ts
+   *
+   * Dead versions of the same key might be pruned in this function. Returns
+   * false if the version is not inserted because the memory budget is
+   * exceeded, as HashTable_OA_KVL::Insert()
+   */
+  bool Insert(const KeyType &key, const ValueType &value, uint64_t begin_ts) {
+    assert(begin_ts >= gc_ts);
+
+    return table.InsertWithPrune(key,
+                                 VersionType{value, begin_ts, MAX_TIMESTAMP},
+                                 DeadVersionChecker{gc_ts});
+  }
+
+  /*
+   * InsertWithHash() - Inserts a new version of a key whose hash value has
+   *                    been computed by the caller
+   *
+   * Every access to the table must use the same hash function, as required
+   * by HashTable_OA_KVL::InsertWithHash(). Returns false if the memory
+   * budget is exceeded, as Insert()
+   */
+  bool InsertWithHash(const KeyType &key,
+                      uint64_t hash_value,
+                      const ValueType &value,
+                      uint64_t begin_ts) {
+    assert(begin_ts >= gc_ts);
+
+    return table.InsertWithPrune(key,
+                                 hash_value,
+                                 VersionType{value, begin_ts, MAX_TIMESTAMP},
+                                 DeadVersionChecker{gc_ts});
+  }
+
+  /*
+   * SetMemoryBudget() - Charges memory of the underlying table to a budget,
+   *                     or removes the budget if nullptr is given
+   *
+   * See HashTable_OA_KVL::SetMemoryBudget()
+   */
+  void SetMemoryBudget(MemoryBudget *budget_p) {
+    table.SetMemoryBudget(budget_p);
+
+    return;
+  }
+
+  /*
+   * GetMemorySize() - Returns memory used by the underlying table in bytes
+   */
+  uint64_t GetMemorySize() const {
+    return table.GetMemorySize();
+  }
+
+  /*
+   * Retire() - Makes the current version of a value invisible from end_ts
+   *
+   * Returns true if a version that has not been retired is found for the
+   * key and value. Returns false otherwise
+   */
+  bool Retire(const KeyType &key, const ValueType &value, uint64_t end_ts) {
+    std::pair<VersionType *, uint32_t> ret = table.GetValue(key);
+
+    for(uint32_t i = 0;i < ret.second;i++) {
+      VersionType &version = ret.first[i];
+
+      if((version.end_ts == MAX_TIMESTAMP) && \
+         (value_eq_obj(version.value, value) == true)) {
+        assert(end_ts >= version.begin_ts);
+
+        version.end_ts = end_ts;
+
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /*
+   * GetValue() - Calls the callback on all versions of the key that are
+   *              visible at the read timestamp
+   *
+   * The callback is called as cb(const ValueType &)
+   */
+  template <typename CallbackType>
+  void GetValue(const KeyType &key, uint64_t ts, CallbackType cb) {
+    // Versions pruned might still be read
+    assert(ts >= gc_ts);
+
+    ReportVisible(table.GetValue(key), ts, cb);
+
+    return;
+  }
+
+  /*
+   * GetValueWithHash() - Calls the callback on all visible versions of a key
+   *                      whose hash value has been computed by the caller
+   */
+  template <typename CallbackType>
+  void GetValueWithHash(const KeyType &key,
+                        uint64_t hash_value,
+                        uint64_t ts,
+                        CallbackType cb) {
+    assert(ts >= gc_ts);
+
+    ReportVisible(table.GetValueWithHash(key, hash_value), ts, cb);
+
+    return;
+  }
+
+  /*
+   * GetValue() - Appends all versions of the key visible at the read
+   *              timestamp into the vector
+   */
+  void GetValue(const KeyType &key,
+                uint64_t ts,
+                std::vector<ValueType> *value_list_p) {
+    GetValue(key, ts, [value_list_p](const ValueType &value) {
+      value_list_p->push_back(value);
+    });
+
+    return;
+  }
+
+  /*
+   * GetVersionCount() - Returns the number of versions stored for a key,
+   *                     including those that are no longer visible
+   *
+   * This is mainly used for testing garbage collection
+   */
+  uint32_t GetVersionCount(const KeyType &key) {
+    return table.GetValue(key).second;
+  }
+
+ private:
+
+  /*
+   * ReportVisible() - Calls the callback on versions in the list that are
+   *                   visible at the read timestamp
+   */
+  template <typename CallbackType>
+  static void ReportVisible(std::pair<VersionType *, uint32_t> ret,
+                            uint64_t ts,
+                            CallbackType &cb) {
+    for(uint32_t i = 0;i < ret.second;i++) {
+      const VersionType &version = ret.first[i];
+
+      if(version.IsVisible(ts) == true) {
+        cb(version.value);
+      }
+    }
+
+    return;
+  }
+
+ public:
+
+  /*
+   * GetStats() - Returns operation counters of the underlying table
+   *
+   * Each version is counted as a value of the underlying table
+   */
+  OperationStatsSnapshot GetStats() const {
+    return table.GetStats();
+  }
+
+  /*
+   * ResetStats() - Sets all operation counters to zero
+   */
+  void ResetStats() {
+    table.ResetStats();
+
+    return;
+  }
+
+  /*
+   * GetTable() - Returns the underlying hash table that stores versions
+   */
+  inline TableType *GetTable() {
+    return &table;
+  }
+};
+
+} // namespace index
+} // namespace peloton
@@ -0,0 +1,662 @@
+
+#pragma once
+
+#include <cstdio>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <cstring>
+#include <vector>
+#include <atomic>
+
+#include "EpochManager.h"
+#include "OperationStats.h"
+
+namespace peloton {
+namespace index {
+
+#include "common.h"
+
+/*
+ * class HashTable_OA_KVL_SWMR - Open addressing hash table with Key Value
+ *                               List that allows one writer thread and many
+ *                               lock-free reader threads
+ *
+ * The layout is the same as HashTable_OA_KVL, except that everything readers
+ * could observe is published by the writer with release stores, and read by
+ * readers with acquire loads:
+ *
+ *   1. A new entry is filled with hash value, key and the inline value first,
+ *      and then becomes visible by storing INLINE_VALUE into its status word
+ *   2. A Key Value List is never modified once it is visible, except that
+ *      the writer appends values after its current size and then publishes
+ *      the new size. When the list is full (or an inline value is converted
+ *      into a list), a new list is built and its pointer is stored into the
+ *      status word. The old list is retired to the epoch manager
+ *   3. Resize() builds a new entry array and publishes it by storing the
+ *      pointer to the array. The old array is retired to the epoch manager,
+ *      while key value lists are shared by both arrays
+ *   4. Deleted entries are never reused for other keys, since readers could
+ *      be comparing the key in the entry. They are cleaned up by Resize()
+ *
+ * Readers must register to obtain a reader ID, and pass it to every read
+ * operation, which uses it to announce the epoch it is reading in
+ *
+ * Since keys and values are read by readers while they might be retired by
+ * the writer, KeyType and ValueType must be trivially copyable, and they are
+ * never destroyed explicitly
+ *
+ * Unlike HashTable_OA_KVL this table does not take a MemoryBudget. The
+ * writer grows the array and key value lists without admission, and retired
+ * memory stays allocated until it is reclaimed, so memory usage is not
+ * bounded by a budget and inserts always succeed
+ */
+template <typename KeyType,
+          typename ValueType,
+          typename KeyHashFunc = std::hash<KeyType>,
+          typename KeyEqualityChecker = std::equal_to<KeyType>,
+          typename LoadFactorCalculator = LoadFactorHalfFull,
+          typename StatsType = NoStats>
+class HashTable_OA_KVL_SWMR {
+ private:
+  // This is the minimum entry count
+  static constexpr uint64_t MINIMUM_ENTRY_COUNT = 32;
+
+  // Number of slots in a KeyValueList when first allocated
+  static constexpr uint32_t KVL_INIT_VALUE_COUNT = 4;
+
+  static_assert(std::is_trivially_copyable<KeyType>::value,
+                "SWMR hash table requires trivially copyable keys");
+  static_assert(std::is_trivially_copyable<ValueType>::value,
+                "SWMR hash table requires trivially copyable values");
+
+  /*
+   * class KeyValueList - The key value list for holding values of the
+   *                      same key
+   *
+   * Only the writer modifies the list. Values at index >= size are not
+   * visible to readers and could be written freely
+   */
+  class KeyValueList {
+   public:
+    // Number of values that are visible to readers
+    std::atomic<uint32_t> size;
+
+    // The actual capacity allocated to the list
+    uint32_t capacity;
+
+    ValueType data[0];
+
+    /*
+     * GetAllocSize() - Static function to compute the size of a kv list
+     *                  instance with a certain number of items
+     */
+    static size_t GetAllocSize(uint32_t data_count) {
+      return sizeof(KeyValueList) + data_count * sizeof(ValueType);
+    }
+
+    /*
+     * GetNew() - Returns a new list with the given capacity and size
+     *
+     * Values are not initialized
+     */
+    static KeyValueList *GetNew(uint32_t capacity, uint32_t size) {
+      KeyValueList *kvl_p = static_cast<KeyValueList *>(
+        malloc(KeyValueList::GetAllocSize(capacity)));
+      assert(kvl_p != nullptr);
+
+      kvl_p->size.store(size, std::memory_order_relaxed);
+      kvl_p->capacity = capacity;
+
+      return kvl_p;
+    }
+  };
+
+  /*
+   * class HashEntry - The hash table entry
+   *
+   * The status word either stores a status code, or a pointer to the key
+   * value list, in which case it is larger than all status codes
+   */
+  class HashEntry {
+   public:
+    enum StatusCode : uint64_t {
+      FREE = 0,
+      DELETED = 1,
+      INLINE_VALUE = 2,
+      MULTIPLE_VALUES = 3,
+    };
+
+    std::atomic<uint64_t> status;
+
+    uint64_t hash_value;
+
+    KeyType key;
+    ValueType value;
+
+    /*
+     * GetKeyValueList() - Converts a status word into a list pointer
+     */
+    static KeyValueList *GetKeyValueList(uint64_t status) {
+      assert(status >= MULTIPLE_VALUES);
+
+      return reinterpret_cast<KeyValueList *>(status);
+    }
+  };
+
+  /*
+   * class EntryArray - The array of hash entries together with its size
+   *
+   * Size and mask are stored with the array such that readers always
+   * observe a consistent combination by loading one pointer
+   */
+  class EntryArray {
+   public:
+    // Total number of entries
+    uint64_t entry_count;
+
+    // The bit mask used to convert hash value into an index
+    uint64_t index_mask;
+
+    HashEntry entry_list[0];
+
+    /*
+     * GetNew() - Allocates an array with all entries being free
+     */
+    static EntryArray *GetNew(uint64_t entry_count) {
+      EntryArray *array_p = static_cast<EntryArray *>(
+        malloc(sizeof(EntryArray) + sizeof(HashEntry) * entry_count));
+      assert(array_p != nullptr);
+
+      array_p->entry_count = entry_count;
+      array_p->index_mask = entry_count - 1;
+
+      for(uint64_t i = 0;i < entry_count;i++) {
+        array_p->entry_list[i].status.store(HashEntry::FREE,
+                                            std::memory_order_relaxed);
+      }
+
+      return array_p;
+    }
+  };
+
+  ///////////////////////////////////////////////////////////////////
+  // Data Member Definition
+  ///////////////////////////////////////////////////////////////////
+
+  // The current array; Readers load this with acquire semantics
+  std::atomic<EntryArray *> array_p;
+
+  // Number of entries holding a key. Only accessed by the writer
+  uint64_t active_entry_count;
+
+  // Number of entries that are not free, including deleted ones
+  uint64_t used_entry_count;
+
+  // We compute threshold for next resizing, and cache it here
+  uint64_t resize_threshold;
+
+  KeyHashFunc key_hash_obj;
+  KeyEqualityChecker key_eq_obj;
+  LoadFactorCalculator lfc;
+
+  // Defers freeing of retired arrays and key value lists
+  EpochManager epoch_manager;
+
+  // Operation counters; Readers update them in const functions
+  mutable StatsType stats;
+
+ private:
+
+  /*
+   * ProbeForResize() - Returns the first free entry for a hash value in an
+   *                    array that is not yet visible to readers
+   */
+  static HashEntry *ProbeForResize(EntryArray *p, uint64_t hash_value) {
+    uint64_t index = hash_value & p->index_mask;
+
+    while(p->entry_list[index].status.load(std::memory_order_relaxed) != \
+          HashEntry::FREE) {
+      index = (index + 1) & p->index_mask;
+    }
+
+    return p->entry_list + index;
+  }
+
+  /*
+   * ProbeForSearch() - Returns the entry holding the key in a given array,
+   *                    together with the status word loaded, or nullptr
+   *                    if the key does not exist
+   *
+   * This is called by both readers and the writer. The status is loaded
+   * with acquire semantics, which makes the key and values that were written
+   * before the status is published visible
+   */
+  HashEntry *ProbeForSearch(EntryArray *p,
+                            const KeyType &key,
+                            uint64_t hash_value,
+                            uint64_t *status_p) const {
+    uint64_t index = hash_value & p->index_mask;
+
+    // Only used for stats
+    uint64_t probe_count = 1;
+    uint64_t compare_count = 0;
+
+    while(1) {
+      HashEntry *entry_p = p->entry_list + index;
+      uint64_t status = entry_p->status.load(std::memory_order_acquire);
+
+      if(status == HashEntry::FREE) {
+        RecordSearch(probe_count, compare_count);
+
+        return nullptr;
+      } else if((status != HashEntry::DELETED) && \
+                (entry_p->hash_value == hash_value)) {
+        compare_count++;
+
+        if(key_eq_obj(key, entry_p->key) == true) {
+          RecordSearch(probe_count, compare_count);
+          *status_p = status;
+
+          return entry_p;
+        }
+      }
+
+      index = (index + 1) & p->index_mask;
+      probe_count++;
+    }
+
+    assert(false);
+    return nullptr;
+  }
+
+  /*
+   * RecordSearch() - Counts a search with the number of entries examined
+   *                  and keys compared
+   */
+  inline void RecordSearch(uint64_t probe_count, uint64_t compare_count) const {
+    stats.Add(StatsCounter::LOOKUP);
+    stats.Add(StatsCounter::PROBE, probe_count);
+    stats.Add(StatsCounter::KEY_COMPARE, compare_count);
+
+    return;
+  }
+
+  /*
+   * Resize() - Rebuilds the array and publishes it
+   *
+   * The array is doubled if active entries take more than half of the
+   * threshold; Otherwise the array is rebuilt in the same size to clean up
+   * deleted entries
+   */
+  void Resize() {
+    uint64_t start_time = stats.GetTime();
+
+    EntryArray *old_array_p = array_p.load(std::memory_order_relaxed);
+    uint64_t entry_count = old_array_p->entry_count;
+
+    if(active_entry_count * 2 >= resize_threshold) {
+      entry_count <<= 1;
+    }
+
+    EntryArray *new_array_p = EntryArray::GetNew(entry_count);
+
+    for(uint64_t i = 0;i < old_array_p->entry_count;i++) {
+      HashEntry *entry_p = old_array_p->entry_list + i;
+      uint64_t status = entry_p->status.load(std::memory_order_relaxed);
+
+      if(status >= HashEntry::INLINE_VALUE) {
+        HashEntry *new_entry_p = ProbeForResize(new_array_p,
+                                                entry_p->hash_value);
+
+        // Key value lists are shared between the two arrays
+        new_entry_p->hash_value = entry_p->hash_value;
+        new_entry_p->key = entry_p->key;
+        new_entry_p->value = entry_p->value;
+        new_entry_p->status.store(status, std::memory_order_relaxed);
+      }
+    }
+
+    resize_threshold = lfc(entry_count);
+    used_entry_count = active_entry_count;
+
+    // All entries are written before the array becomes visible
+    array_p.store(new_array_p);
+
+    epoch_manager.Retire(old_array_p);
+
+    stats.Add(StatsCounter::RESIZE);
+    stats.Add(StatsCounter::RESIZE_TIME_NS, stats.GetTime() - start_time);
+
+    return;
+  }
+
+  /*
+   * AppendValue() - Adds a value to an existing entry
+   *
+   * The value is written to the slot after the current size of the key
+   * value list, which is not visible to readers, before the new size is
+   * published. If the list is full or the value is inlined then a new list
+   * is published instead
+   */
+  void AppendValue(HashEntry *entry_p,
+                   uint64_t status,
+                   const ValueType &value) {
+    if(status == HashEntry::INLINE_VALUE) {
+      KeyValueList *kv_p = KeyValueList::GetNew(KVL_INIT_VALUE_COUNT, 2);
+      stats.Add(StatsCounter::KVL_GROW);
+
+      kv_p->data[0] = entry_p->value;
+      kv_p->data[1] = value;
+
+      // Readers either see the inline value or the full list
+      entry_p->status.store(reinterpret_cast<uint64_t>(kv_p),
+                            std::memory_order_release);
+
+      return;
+    }
+
+    KeyValueList *kv_p = HashEntry::GetKeyValueList(status);
+    uint32_t size = kv_p->size.load(std::memory_order_relaxed);
+
+    if(size < kv_p->capacity) {
+      kv_p->data[size] = value;
+      kv_p->size.store(size + 1, std::memory_order_release);
+
+      return;
+    }
+
+    KeyValueList *new_kv_p = KeyValueList::GetNew(kv_p->capacity << 1,
+                                                  size + 1);
+    stats.Add(StatsCounter::KVL_GROW);
+
+    std::memcpy(new_kv_p->data, kv_p->data, sizeof(ValueType) * size);
+    new_kv_p->data[size] = value;
+
+    entry_p->status.store(reinterpret_cast<uint64_t>(new_kv_p),
+                          std::memory_order_release);
+
+    // Readers that loaded the old pointer could still be reading it
+    epoch_manager.Retire(kv_p);
+
+    return;
+  }
+
+ public:
+
+  /*
+   * Constructor
+   *
+   * max_reader_count is the maximum number of readers that could be
+   * registered at the same time
+   */
+  HashTable_OA_KVL_SWMR(uint64_t init_entry_count = 0,
+                        uint64_t max_reader_count = \
+                          EpochManager::DEFAULT_MAX_THREAD_COUNT,
+                        const KeyHashFunc &p_key_hash_obj = KeyHashFunc{},
+                        const KeyEqualityChecker &p_key_eq_obj = KeyEqualityChecker{},
+                        const LoadFactorCalculator &p_lfc = LoadFactorCalculator{}) :
+    active_entry_count{0},
+    used_entry_count{0},
+    key_hash_obj{p_key_hash_obj},
+    key_eq_obj{p_key_eq_obj},
+    lfc{p_lfc},
+    epoch_manager{max_reader_count},
+    stats{} {
+    if(init_entry_count < MINIMUM_ENTRY_COUNT) {
+      init_entry_count = MINIMUM_ENTRY_COUNT;
+    }
+
+    // Round it up to a power of 2
+    uint64_t entry_count = 1;
+    while(entry_count < init_entry_count) {
+      entry_count <<= 1;
+    }
+
+    resize_threshold = lfc(entry_count);
+    array_p.store(EntryArray::GetNew(entry_count));
+
+    dbg_printf("Hash table size = %lu\n", entry_count);
+
+    return;
+  }
+
+  // Readers hold pointers into the table, so it could not be copied
+  // or moved
+  HashTable_OA_KVL_SWMR(const HashTable_OA_KVL_SWMR &) = delete;
+  HashTable_OA_KVL_SWMR &operator=(const HashTable_OA_KVL_SWMR &) = delete;
+
+  /*
+   * Destructor - Frees the array and all key value lists
+   *
+   * Retired arrays and lists are freed by the epoch manager. The caller must
+   * make sure no reader is active
+   */
+  ~HashTable_OA_KVL_SWMR() {
+    EntryArray *p = array_p.load();
+
+    for(uint64_t i = 0;i < p->entry_count;i++) {
+      uint64_t status = p->entry_list[i].status.load();
+      if(status >= HashEntry::MULTIPLE_VALUES) {
+        free(HashEntry::GetKeyValueList(status));
+      }
+    }
+
+    free(p);
+
+    return;
+  }
+
+  /*
+   * RegisterReader() - Returns a reader ID for the calling thread
+   */
+  uint64_t RegisterReader() {
+    return epoch_manager.RegisterThread();
+  }
+
+  /*
+   * UnregisterReader() - Releases a reader ID
+   */
+  void UnregisterReader(uint64_t reader_id) {
+    epoch_manager.UnregisterThread(reader_id);
+
+    return;
+  }
+
+  /*
+   * Insert() - Inserts a value into the hash table
+   *
+   * This could only be called by the writer thread
+   */
+  inline void Insert(const KeyType &key, const ValueType &value) {
+    InsertWithHash(key, key_hash_obj(key), value);
+
+    return;
+  }
+
+  /*
+   * InsertWithHash() - Inserts a value of a key whose hash value has been
+   *                    computed by the caller
+   *
+   * hash_value is stored in the entry and used on resize, so every access to
+   * the table must use the same hash function, which is key_hash_obj(key)
+   * if functions that hash the key are also called. The slot index is the
+   * lowest bits of the hash, so callers could partition rows by the highest
+   * bits of the same hash. This could only be called by the writer thread
+   */
+  void InsertWithHash(const KeyType &key,
+                      uint64_t hash_value,
+                      const ValueType &value) {
+    if(used_entry_count == resize_threshold) {
+      Resize();
+      assert(used_entry_count < resize_threshold);
+    }
+
+    EntryArray *p = array_p.load(std::memory_order_relaxed);
+    uint64_t index = hash_value & p->index_mask;
+
+    stats.Add(StatsCounter::INSERT);
+
+    while(1) {
+      HashEntry *entry_p = p->entry_list + index;
+      uint64_t status = entry_p->status.load(std::memory_order_relaxed);
+
+      stats.Add(StatsCounter::PROBE);
+
+      if(status == HashEntry::FREE) {
+        // Fill the entry before readers could see it
+        entry_p->hash_value = hash_value;
+        entry_p->key = key;
+        entry_p->value = value;
+        entry_p->status.store(HashEntry::INLINE_VALUE,
+                              std::memory_order_release);
+
+        active_entry_count++;
+        used_entry_count++;
+
+        return;
+      } else if((status != HashEntry::DELETED) && \
+                (entry_p->hash_value == hash_value) && \
+                (key_eq_obj(key, entry_p->key) == true)) {
+        AppendValue(entry_p, status, value);
+
+        return;
+      }
+
+      index = (index + 1) & p->index_mask;
+    }
+
+    return;
+  }
+
+  /*
+   * DeleteKey() - Deletes a key with all its value(s) from the table
+   *
+   * This could only be called by the writer thread. Returns false if the
+   * key does not exist
+   */
+  bool DeleteKey(const KeyType &key) {
+    uint64_t status;
+    HashEntry *entry_p = ProbeForSearch(array_p.load(std::memory_order_relaxed),
+                                        key,
+                                        key_hash_obj(key),
+                                        &status);
+    if(entry_p == nullptr) {
+      return false;
+    }
+
+    entry_p->status.store(HashEntry::DELETED, std::memory_order_release);
+    if(status >= HashEntry::MULTIPLE_VALUES) {
+      epoch_manager.Retire(HashEntry::GetKeyValueList(status));
+    }
+
+    active_entry_count--;
+
+    return true;
+  }
+
+  /*
+   * GetValue() - Invokes the call back on every value of the key
+   *
+   * This could be called by any registered reader concurrently with the
+   * writer. The call back is invoked as cb(const ValueType &), and the
+   * reference is only valid inside the call back. Values appended by the
+   * writer after the key value list is read are not reported
+   */
+  template <typename CallbackType>
+  inline void GetValue(uint64_t reader_id, const KeyType &key, CallbackType cb) {
+    GetValueWithHash(reader_id, key, key_hash_obj(key), cb);
+
+    return;
+  }
+
+  /*
+   * GetValueWithHash() - Invokes the call back on every value of a key whose
+   *                      hash value has been computed by the caller
+   */
+  template <typename CallbackType>
+  void GetValueWithHash(uint64_t reader_id,
+                        const KeyType &key,
+                        uint64_t hash_value,
+                        CallbackType cb) {
+    EpochGuard guard{&epoch_manager, reader_id};
+
+    uint64_t status;
+    HashEntry *entry_p = ProbeForSearch(array_p.load(std::memory_order_acquire),
+                                        key,
+                                        hash_value,
+                                        &status);
+    if(entry_p == nullptr) {
+      return;
+    } else if(status == HashEntry::INLINE_VALUE) {
+      cb(entry_p->value);
+
+      return;
+    }
+
+    KeyValueList *kv_p = HashEntry::GetKeyValueList(status);
+    uint32_t size = kv_p->size.load(std::memory_order_acquire);
+
+    for(uint32_t i = 0;i < size;i++) {
+      cb(kv_p->data[i]);
+    }
+
+    return;
+  }
+
+  /*
+   * GetValue() - Copies all values of the key into a vector
+   */
+  void GetValue(uint64_t reader_id,
+                const KeyType &key,
+                std::vector<ValueType> *value_list_p) {
+    GetValue(reader_id, key, [value_list_p](const ValueType &value) {
+      value_list_p->push_back(value);
+    });
+
+    return;
+  }
+
+  /*
+   * GetEntryCount() - Return the number of entries in the array
+   *
+   * This could only be called by the writer thread
+   */
+  uint64_t GetEntryCount() const {
+    return array_p.load(std::memory_order_relaxed)->entry_count;
+  }
+
+  /*
+   * GetStats() - Returns the current value of operation counters
+   *
+   * Counters are summed over the writer and all readers
+   */
+  OperationStatsSnapshot GetStats() const {
+    return stats.GetSnapshot();
+  }
+
+  /*
+   * ResetStats() - Sets all operation counters to zero
+   */
+  void ResetStats() {
+    stats.Reset();
+
+    return;
+  }
+
+  /*
+   * ReclaimMemory() - Frees retired arrays and lists that are no longer
+   *                   accessed by any reader
+   */
+  void ReclaimMemory() {
+    epoch_manager.Reclaim();
+
+    return;
+  }
+};
+
+} // namespace index
+} // namespace peloton
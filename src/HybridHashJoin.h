@@ -0,0 +1,648 @@
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <algorithm>
+
+#include "HashTable_OA_KVL.h"
+#include "HashTable_CA_SCC.h"
+#include "SpillFile.h"
+
+namespace peloton {
+namespace index {
+
+/*
+ * class HybridHashJoin - Equi-join whose build side could be larger than the
+ *                        memory budget
+ *
+ * Build and probe rows are hash partitioned into PARTITION_COUNT partitions,
+ * and each partition of the build side is kept in its own TableType, which
+ * is HashTable_OA_KVL or HashTable_CA_SCC. The join runs in three phases:
+ *
+ *   1. AddBuild() inserts build rows into the table of their partition.
+ *      If the tables use more than the memory budget after an insert, the
+ *      partition with the largest table is spilled: its rows are written
+ *      into a SpillFile and the table is freed, and all later build rows of
+ *      that partition are appended to the file
+ *   2. After FinishBuild(), Probe() looks up probe rows of partitions still
+ *      in memory and emits matches at once, as in an in-memory hash join.
+ *      Probe rows of spilled partitions are appended to a probe side file
+ *   3. FinishProbe() frees in-memory tables and joins each spilled build run
+ *      with the probe run of the same partition, by recursively running the
+ *      join at the next level. Partitions of a deeper level are selected by
+ *      the next PARTITION_BITS bits of the hash value, so a build run still
+ *      larger than the budget is split again. If the next level spills all
+ *      rows of the run into one partition, e.g. when they have the same key,
+ *      the recursion stops, and the run is joined by a block nested loop
+ *      that loads build rows in blocks that fit in the budget and scans the
+ *      probe run once for every block. A run at MAX_LEVEL is joined in
+ *      memory regardless of the budget
+ *
+ * Matches are emitted as cb(const KeyType &, const BuildValueType &,
+ * const ProbeValueType &) in no particular order. Spilled partitions without
+ * any probe row are dropped without being read back
+ *
+ * The hash of a row is computed once by KeyHashFunc, or by an upstream
+ * operator for AddBuildWithHash() and ProbeWithHash(), and is kept in
+ * spilled records. Partitions are chosen by the highest bits of the mixed
+ * hash, and the same hash is passed to tables, which use its lowest bits
+ * as the slot index. Tables are default constructed but only accessed with
+ * these hash values, so the hash function of TableType is not used
+ *
+ * If a run could not be written or read back, AddBuildWithHash(),
+ * ProbeWithHash() or FinishProbe() returns false. Rows of the run are lost
+ * at that point, so the result is incomplete and the join should be
+ * abandoned
+ *
+ * The budget may be exceeded by the growth of one table before the spill.
+ * Each spill file also takes spill_buffer_size bytes for the write buffer.
+ * Keys and values must be trivially copyable. This class is not thread-safe
+ */
+template <typename KeyType,
+          typename BuildValueType,
+          typename ProbeValueType,
+          typename TableType = HashTable_OA_KVL<KeyType, BuildValueType>,
+          typename KeyHashFunc = std::hash<KeyType>>
+class HybridHashJoin {
+ public:
+  static constexpr uint64_t PARTITION_BITS = 4;
+  static constexpr uint64_t PARTITION_COUNT = 0x1UL << PARTITION_BITS;
+
+  // The deepest level uses the lowest PARTITION_BITS bits
+  static constexpr uint64_t MAX_LEVEL = 64 / PARTITION_BITS - 1;
+
+  // There could be two buffers for every partition
+  static constexpr size_t DEFAULT_SPILL_BUFFER_SIZE = 256 * 1024;
+
+  /*
+   * class BuildRecord - Format of a row in a spilled build run
+   */
+  class BuildRecord {
+   public:
+    KeyType key;
+    uint64_t hash_value;
+    BuildValueType value;
+  };
+
+  /*
+   * class ProbeRecord - Format of a row in a spilled probe run
+   */
+  class ProbeRecord {
+   public:
+    KeyType key;
+    uint64_t hash_value;
+    ProbeValueType value;
+  };
+
+  using BuildFileType = SpillFile<BuildRecord>;
+  using ProbeFileType = SpillFile<ProbeRecord>;
+
+ private:
+  uint64_t memory_budget;
+
+  size_t spill_buffer_size;
+
+  // Recursion level, which decides the hash bits used for partitioning
+  uint64_t level;
+
+  KeyHashFunc key_hash_obj;
+
+  // Whether FinishBuild() has been called
+  bool build_finished;
+
+  // Table of each partition, or nullptr if the partition is spilled
+  TableType *table_list[PARTITION_COUNT];
+
+  // Memory used by each table, and the sum of them
+  uint64_t partition_memory[PARTITION_COUNT];
+  uint64_t total_memory;
+
+  // Runs of spilled partitions, or nullptr for partitions in memory. The
+  // probe run is created on the first probe row
+  BuildFileType *build_file_list[PARTITION_COUNT];
+  ProbeFileType *probe_file_list[PARTITION_COUNT];
+
+  // Counters including recursive levels that have finished
+  uint64_t spill_count;
+  uint64_t spilled_build_count;
+  uint64_t spilled_probe_count;
+  uint64_t nested_loop_count;
+  uint64_t max_level;
+
+  /*
+   * GetPartition() - Returns the partition of a hash value at this level
+   *
+   * See HashAggregation::GetPartition()
+   */
+  inline uint64_t GetPartition(uint64_t hash_value) const {
+    hash_value = SimpleInt64Hasher{}(hash_value);
+
+    return (hash_value >> (64 - PARTITION_BITS * (level + 1))) & \
+           (PARTITION_COUNT - 1);
+  }
+
+  /*
+   * GetTableMemory() - Returns memory used by a table
+   */
+  template <typename... Args>
+  static uint64_t GetTableMemory(const HashTable_OA_KVL<Args...> &table) {
+    return table.GetMemorySize();
+  }
+
+  template <typename... Args>
+  static uint64_t GetTableMemory(const HashTable_CA_SCC<Args...> &table) {
+    return table.GetMemorySize();
+  }
+
+  /*
+   * ForEachMatch() - Calls the callback on every value of a key
+   */
+  template <typename CallbackType, typename... Args>
+  static void ForEachMatch(HashTable_OA_KVL<Args...> *table_p,
+                           const KeyType &key,
+                           uint64_t hash_value,
+                           CallbackType cb) {
+    std::pair<BuildValueType *, uint32_t> ret = \
+      table_p->GetValueWithHash(key, hash_value);
+    for(uint32_t i = 0;i < ret.second;i++) {
+      cb(ret.first[i]);
+    }
+
+    return;
+  }
+
+  template <typename CallbackType, typename... Args>
+  static void ForEachMatch(HashTable_CA_SCC<Args...> *table_p,
+                           const KeyType &key,
+                           uint64_t hash_value,
+                           CallbackType cb) {
+    table_p->GetValueWithHash(
+      key,
+      hash_value,
+      [&cb](const std::pair<KeyType, BuildValueType> &kv) {
+        cb(kv.second);
+      });
+
+    return;
+  }
+
+  /*
+   * ForEachRow() - Calls the callback on every key value pair of a table
+   *                with the hash value stored for the key
+   */
+  template <typename CallbackType, typename... Args>
+  static void ForEachRow(HashTable_OA_KVL<Args...> *table_p,
+                         CallbackType cb) {
+    for(auto it = table_p->begin();it != table_p->end();++it) {
+      cb(it.GetKey(), it.GetHashValue(), *it);
+    }
+
+    return;
+  }
+
+  template <typename CallbackType, typename... Args>
+  static void ForEachRow(HashTable_CA_SCC<Args...> *table_p,
+                         CallbackType cb) {
+    for(auto it = table_p->begin();it != table_p->end();++it) {
+      cb(it->first, it.GetHashValue(), it->second);
+    }
+
+    return;
+  }
+
+  /*
+   * SpillLargestPartition() - Writes rows of the partition with the largest
+   *                           table into a new run and frees the table
+   *
+   * Returns false if the run could not be written
+   */
+  bool SpillLargestPartition() {
+    uint64_t victim = PARTITION_COUNT;
+    for(uint64_t p = 0;p < PARTITION_COUNT;p++) {
+      if((table_list[p] != nullptr) && \
+         ((victim == PARTITION_COUNT) || \
+          (partition_memory[p] > partition_memory[victim]))) {
+        victim = p;
+      }
+    }
+
+    // Tables in memory use all memory counted
+    assert(victim != PARTITION_COUNT);
+
+    BuildFileType *file_p = new BuildFileType{spill_buffer_size};
+    build_file_list[victim] = file_p;
+
+    bool append_ok = true;
+    ForEachRow(table_list[victim],
+               [file_p, &append_ok](const KeyType &key,
+                                    uint64_t hash_value,
+                                    const BuildValueType &value) {
+                 append_ok = \
+                   file_p->Append(BuildRecord{key, hash_value, value}) && \
+                   append_ok;
+               });
+
+    delete table_list[victim];
+    table_list[victim] = nullptr;
+
+    total_memory -= partition_memory[victim];
+    partition_memory[victim] = 0;
+
+    spill_count++;
+    spilled_build_count += file_p->GetRecordCount();
+
+    return append_ok;
+  }
+
+  /*
+   * HasUnsplitRun() - Returns whether all rows of the build side, which are
+   *                   row_count rows, have been spilled into one run
+   */
+  bool HasUnsplitRun(uint64_t row_count) const {
+    for(uint64_t p = 0;p < PARTITION_COUNT;p++) {
+      if((build_file_list[p] != nullptr) && \
+         (build_file_list[p]->GetRecordCount() == row_count)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /*
+   * JoinBlockNestedLoop() - Joins a build run with a probe run by loading
+   *                         blocks of build rows that fit in the budget
+   *
+   * Each block is held in a table, and the probe run is scanned once for
+   * every block. This is used for runs that partitioning could not split.
+   * Returns false if a run could not be read
+   */
+  template <typename CallbackType>
+  bool JoinBlockNestedLoop(BuildFileType *build_file_p,
+                           ProbeFileType *probe_file_p,
+                           CallbackType cb) {
+    if(build_file_p->Rewind() == false) {
+      return false;
+    }
+
+    BuildRecord build_record;
+    bool has_build_record = build_file_p->Read(&build_record);
+
+    while(has_build_record == true) {
+      // A block has at least one row, and may exceed the budget by the
+      // growth of the table
+      TableType table{};
+      do {
+        table.InsertWithHash(build_record.key,
+                             build_record.hash_value,
+                             build_record.value);
+        has_build_record = build_file_p->Read(&build_record);
+      } while((has_build_record == true) && \
+              (GetTableMemory(table) <= memory_budget));
+
+      if(probe_file_p->Rewind() == false) {
+        return false;
+      }
+
+      ProbeRecord probe_record;
+      while(probe_file_p->Read(&probe_record) == true) {
+        ForEachMatch(&table,
+                     probe_record.key,
+                     probe_record.hash_value,
+                     [&cb, &probe_record](const BuildValueType &build_value) {
+                       cb(probe_record.key, build_value, probe_record.value);
+                     });
+      }
+
+      if(probe_file_p->HasFailed() == true) {
+        return false;
+      }
+    }
+
+    return build_file_p->HasFailed() == false;
+  }
+
+  /*
+   * FreeTables() - Frees tables of all partitions in memory
+   */
+  void FreeTables() {
+    for(uint64_t p = 0;p < PARTITION_COUNT;p++) {
+      delete table_list[p];
+      table_list[p] = nullptr;
+
+      partition_memory[p] = 0;
+    }
+
+    total_memory = 0;
+
+    return;
+  }
+
+ public:
+
+  /*
+   * Constructor
+   *
+   * The budget is the maximum number of bytes used by build side tables
+   */
+  HybridHashJoin(uint64_t p_memory_budget,
+                 const KeyHashFunc &p_key_hash_obj = KeyHashFunc{},
+                 size_t p_spill_buffer_size = DEFAULT_SPILL_BUFFER_SIZE,
+                 uint64_t p_level = 0) :
+    memory_budget{p_memory_budget},
+    spill_buffer_size{p_spill_buffer_size},
+    level{p_level},
+    key_hash_obj{p_key_hash_obj},
+    build_finished{false},
+    table_list{},
+    partition_memory{},
+    total_memory{0},
+    build_file_list{},
+    probe_file_list{},
+    spill_count{0},
+    spilled_build_count{0},
+    spilled_probe_count{0},
+    nested_loop_count{0},
+    max_level{p_level} {
+    static_assert(std::is_trivially_copyable<KeyType>::value && \
+                  std::is_trivially_copyable<BuildValueType>::value && \
+                  std::is_trivially_copyable<ProbeValueType>::value,
+                  "Rows are spilled as raw bytes");
+    assert(level <= MAX_LEVEL);
+
+    for(uint64_t p = 0;p < PARTITION_COUNT;p++) {
+      table_list[p] = new TableType{};
+
+      partition_memory[p] = GetTableMemory(*table_list[p]);
+      total_memory += partition_memory[p];
+    }
+
+    return;
+  }
+
+  HybridHashJoin(const HybridHashJoin &) = delete;
+  HybridHashJoin &operator=(const HybridHashJoin &) = delete;
+
+  /*
+   * Destructor - Frees tables and removes runs that have not been joined
+   */
+  ~HybridHashJoin() {
+    FreeTables();
+
+    for(uint64_t p = 0;p < PARTITION_COUNT;p++) {
+      delete build_file_list[p];
+      delete probe_file_list[p];
+    }
+
+    return;
+  }
+
+  /*
+   * AddBuild() - Adds a row of the build side
+   *
+   * Returns false if a run could not be written
+   */
+  inline bool AddBuild(const KeyType &key, const BuildValueType &value) {
+    return AddBuildWithHash(key, key_hash_obj(key), value);
+  }
+
+  /*
+   * AddBuildWithHash() - Adds a row of the build side whose hash value has
+   *                      been computed by the caller
+   *
+   * hash_value must be equal to key_hash_obj(key). Returns false if a run
+   * could not be written
+   */
+  bool AddBuildWithHash(const KeyType &key,
+                        uint64_t hash_value,
+                        const BuildValueType &value) {
+    assert(build_finished == false);
+
+    uint64_t partition = GetPartition(hash_value);
+
+    if(build_file_list[partition] != nullptr) {
+      spilled_build_count++;
+
+      return build_file_list[partition]->Append(
+        BuildRecord{key, hash_value, value});
+    }
+
+    TableType *table_p = table_list[partition];
+    table_p->InsertWithHash(key, hash_value, value);
+
+    uint64_t memory = GetTableMemory(*table_p);
+    total_memory += memory - partition_memory[partition];
+    partition_memory[partition] = memory;
+
+    while((total_memory > memory_budget) && (level < MAX_LEVEL)) {
+      if(SpillLargestPartition() == false) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /*
+   * FinishBuild() - Ends the build phase
+   *
+   * Partitions in memory at this point are not spilled any more
+   */
+  void FinishBuild() {
+    assert(build_finished == false);
+
+    build_finished = true;
+
+    return;
+  }
+
+  /*
+   * Probe() - Joins a row of the probe side
+   *
+   * Matches in memory are emitted by calling the callback before this
+   * function returns. Rows of spilled partitions are joined in FinishProbe().
+   * Returns false if a run could not be written
+   */
+  template <typename CallbackType>
+  inline bool Probe(const KeyType &key,
+                    const ProbeValueType &value,
+                    CallbackType cb) {
+    return ProbeWithHash(key, key_hash_obj(key), value, cb);
+  }
+
+  /*
+   * ProbeWithHash() - Joins a row of the probe side whose hash value has
+   *                   been computed by the caller
+   *
+   * hash_value must be equal to key_hash_obj(key). Returns false if a run
+   * could not be written
+   */
+  template <typename CallbackType>
+  bool ProbeWithHash(const KeyType &key,
+                     uint64_t hash_value,
+                     const ProbeValueType &value,
+                     CallbackType cb) {
+    assert(build_finished == true);
+
+    uint64_t partition = GetPartition(hash_value);
+
+    TableType *table_p = table_list[partition];
+    if(table_p != nullptr) {
+      ForEachMatch(table_p,
+                   key,
+                   hash_value,
+                   [&cb, &key, &value](const BuildValueType &build_value) {
+                     cb(key, build_value, value);
+                   });
+
+      return true;
+    }
+
+    ProbeFileType *file_p = probe_file_list[partition];
+    if(file_p == nullptr) {
+      file_p = new ProbeFileType{spill_buffer_size};
+      probe_file_list[partition] = file_p;
+    }
+
+    spilled_probe_count++;
+
+    return file_p->Append(ProbeRecord{key, hash_value, value});
+  }
+
+  /*
+   * FinishProbe() - Joins spilled partitions pairwise
+   *
+   * The join could not be used any more after this function returns.
+   * Returns false if a run could not be written or read back, in which case
+   * matches of the run and of runs not joined yet are not emitted
+   */
+  template <typename CallbackType>
+  bool FinishProbe(CallbackType cb) {
+    assert(build_finished == true);
+
+    // Release memory before joining runs
+    FreeTables();
+
+    for(uint64_t p = 0;p < PARTITION_COUNT;p++) {
+      BuildFileType *build_file_p = build_file_list[p];
+      ProbeFileType *probe_file_p = probe_file_list[p];
+
+      build_file_list[p] = nullptr;
+      probe_file_list[p] = nullptr;
+
+      if((build_file_p == nullptr) || (probe_file_p == nullptr)) {
+        delete build_file_p;
+        delete probe_file_p;
+
+        continue;
+      }
+
+      HybridHashJoin child{memory_budget,
+                           key_hash_obj,
+                           spill_buffer_size,
+                           level + 1};
+
+      bool ok = build_file_p->Rewind();
+
+      BuildRecord build_record;
+      while((ok == true) && (build_file_p->Read(&build_record) == true)) {
+        ok = child.AddBuildWithHash(build_record.key,
+                                    build_record.hash_value,
+                                    build_record.value);
+      }
+
+      ok = ok && (build_file_p->HasFailed() == false);
+
+      child.FinishBuild();
+
+      if((ok == true) && \
+         (child.HasUnsplitRun(build_file_p->GetRecordCount()) == true)) {
+        // Partitioning made no progress, e.g. all rows have the same key,
+        // and recursing would only write the same rows again
+        ok = JoinBlockNestedLoop(build_file_p, probe_file_p, cb);
+        nested_loop_count++;
+      } else {
+        ok = ok && probe_file_p->Rewind();
+
+        ProbeRecord probe_record;
+        while((ok == true) && (probe_file_p->Read(&probe_record) == true)) {
+          ok = child.ProbeWithHash(probe_record.key,
+                                   probe_record.hash_value,
+                                   probe_record.value,
+                                   cb);
+        }
+
+        ok = ok && (probe_file_p->HasFailed() == false);
+        ok = ok && child.FinishProbe(cb);
+      }
+
+      delete build_file_p;
+      delete probe_file_p;
+
+      spill_count += child.spill_count;
+      spilled_build_count += child.spilled_build_count;
+      spilled_probe_count += child.spilled_probe_count;
+      nested_loop_count += child.nested_loop_count;
+      max_level = std::max(max_level, child.max_level);
+
+      // Runs not joined yet are removed by the destructor
+      if(ok == false) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /*
+   * GetMemoryUsage() - Returns memory used by build side tables in bytes
+   */
+  inline uint64_t GetMemoryUsage() const {
+    return total_memory;
+  }
+
+  /*
+   * GetSpillCount() - Returns the number of partitions spilled, including
+   *                   those of recursive levels
+   */
+  inline uint64_t GetSpillCount() const {
+    return spill_count;
+  }
+
+  /*
+   * GetSpilledBuildCount() - Returns the number of build rows written into
+   *                          runs, including those of recursive levels
+   */
+  inline uint64_t GetSpilledBuildCount() const {
+    return spilled_build_count;
+  }
+
+  /*
+   * GetSpilledProbeCount() - Returns the number of probe rows written into
+   *                          runs, including those of recursive levels
+   */
+  inline uint64_t GetSpilledProbeCount() const {
+    return spilled_probe_count;
+  }
+
+  /*
+   * GetNestedLoopCount() - Returns the number of runs joined by block nested
+   *                        loop, including those of recursive levels
+   */
+  inline uint64_t GetNestedLoopCount() const {
+    return nested_loop_count;
+  }
+
+  /*
+   * GetMaxLevel() - Returns the deepest recursion level reached
+   */
+  inline uint64_t GetMaxLevel() const {
+    return max_level;
+  }
+};
+
+} // namespace index
+} // namespace peloton
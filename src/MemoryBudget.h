@@ -0,0 +1,130 @@
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <functional>
+
+namespace peloton {
+namespace index {
+
+/*
+ * class MemoryBudget - Limit of memory shared by one or more tables
+ *
+ * A table registered with SetMemoryBudget() charges all memory it owns to
+ * the budget, and reserves memory through TryReserve() before it grows,
+ * i.e. before a resize or before allocating or growing a key value list.
+ * If the reservation fails the table does not allocate, and Insert()
+ * returns false. Memory the table frees is released, and all of it is
+ * released when the table is destroyed or registers another budget.
+ * Operations that could not fail (e.g. Merge() and rehashing in place)
+ * charge memory without checking the limit, so the usage could exceed the
+ * limit temporarily
+ *
+ * If a spill callback is set, it is called as spill_callback(size) when a
+ * reservation of size bytes would exceed the limit. It should free memory,
+ * e.g. by writing another table to disk and destroying it, and return true
+ * such that the reservation is retried; Or return false to refuse the
+ * reservation. The callback runs inside the table operation that needs
+ * memory, so it must not access that table
+ *
+ * Counters are atomic, so a budget could be shared by tables used in
+ * different threads
+ */
+class MemoryBudget {
+ public:
+  using SpillCallback = std::function<bool(uint64_t)>;
+
+ private:
+  std::atomic<uint64_t> used_size;
+
+  uint64_t limit;
+
+  SpillCallback spill_callback;
+
+ public:
+
+  /*
+   * Constructor
+   */
+  MemoryBudget(uint64_t p_limit,
+               const SpillCallback &p_spill_callback = SpillCallback{}) :
+    used_size{0},
+    limit{p_limit},
+    spill_callback{p_spill_callback} {
+    return;
+  }
+
+  MemoryBudget(const MemoryBudget &) = delete;
+  MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+  /*
+   * TryReserve() - Charges memory if the limit is not exceeded
+   *
+   * Returns true if memory is charged. Otherwise the spill callback is
+   * called if there is one, and the reservation is retried as long as the
+   * callback returns true
+   */
+  bool TryReserve(uint64_t size) {
+    while(true) {
+      uint64_t used = used_size.load(std::memory_order_relaxed);
+      while(used + size <= limit) {
+        if(used_size.compare_exchange_weak(used,
+                                           used + size,
+                                           std::memory_order_relaxed) == true) {
+          return true;
+        }
+      }
+
+      if((spill_callback == nullptr) || (spill_callback(size) == false)) {
+        return false;
+      }
+    }
+  }
+
+  /*
+   * Charge() - Charges memory without checking the limit
+   */
+  inline void Charge(uint64_t size) {
+    used_size.fetch_add(size, std::memory_order_relaxed);
+
+    return;
+  }
+
+  /*
+   * Release() - Returns memory charged before
+   */
+  inline void Release(uint64_t size) {
+    used_size.fetch_sub(size, std::memory_order_relaxed);
+
+    return;
+  }
+
+  /*
+   * GetUsedSize() - Returns the number of bytes charged
+   */
+  inline uint64_t GetUsedSize() const {
+    return used_size.load(std::memory_order_relaxed);
+  }
+
+  /*
+   * GetLimit() - Returns the limit in bytes
+   */
+  inline uint64_t GetLimit() const {
+    return limit;
+  }
+
+  /*
+   * SetLimit() - Changes the limit
+   *
+   * Memory already charged is not affected even if it exceeds the new limit
+   */
+  void SetLimit(uint64_t p_limit) {
+    limit = p_limit;
+
+    return;
+  }
+};
+
+} // namespace index
+} // namespace peloton
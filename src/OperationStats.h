@@ -0,0 +1,266 @@
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <utility>
+
+namespace peloton {
+namespace index {
+
+/*
+ * enum class StatsCounter - Events counted by a stats policy
+ */
+enum class StatsCounter : uint64_t {
+  // Number of Insert() calls
+  INSERT = 0,
+  // Number of key searches, e.g. GetValue(), DeleteKey() and Begin(key)
+  LOOKUP,
+  // Number of entries examined by probing an open addressing table
+  PROBE,
+  // Number of entries walked on collision chains
+  CHAIN_WALK,
+  // Number of calls to the key equality checker
+  KEY_COMPARE,
+  // Number of times a key value list is allocated or grown
+  KVL_GROW,
+  // Number of resizes of the main array
+  RESIZE,
+  // Total time spent in resizes, in nanoseconds
+  RESIZE_TIME_NS,
+  // This must be the last one
+  COUNTER_COUNT,
+};
+
+/*
+ * class OperationStatsSnapshot - Values of all counters at some point
+ */
+class OperationStatsSnapshot {
+ public:
+  uint64_t counter_list[static_cast<uint64_t>(StatsCounter::COUNTER_COUNT)];
+
+  /*
+   * Get() - Returns the value of a counter
+   */
+  inline uint64_t Get(StatsCounter counter) const {
+    return counter_list[static_cast<uint64_t>(counter)];
+  }
+
+  /*
+   * GetPerLookup() - Returns the value of a counter divided by the number of
+   *                  lookups, or 0.0 if there is no lookup
+   */
+  double GetPerLookup(StatsCounter counter) const {
+    uint64_t lookup_count = Get(StatsCounter::LOOKUP);
+    if(lookup_count == 0) {
+      return 0.0;
+    }
+
+    return static_cast<double>(Get(counter)) / lookup_count;
+  }
+
+  /*
+   * Print() - Prints all counters to stdout
+   */
+  void Print(const char *name) const {
+    printf("%s: %lu inserts; %lu lookups; %lu probes; %lu chain walks; "
+           "%lu key compares; %lu KVL grows; %lu resizes (%.3lf ms)\n",
+           name,
+           Get(StatsCounter::INSERT),
+           Get(StatsCounter::LOOKUP),
+           Get(StatsCounter::PROBE),
+           Get(StatsCounter::CHAIN_WALK),
+           Get(StatsCounter::KEY_COMPARE),
+           Get(StatsCounter::KVL_GROW),
+           Get(StatsCounter::RESIZE),
+           Get(StatsCounter::RESIZE_TIME_NS) / 1000000.0);
+
+    return;
+  }
+};
+
+/*
+ * class NoStats - Stats policy that does not count anything
+ *
+ * This is the default policy of all tables. All functions are empty and
+ * inlined, and GetTime() returns a constant, so the compiler removes the
+ * calls together with the arguments computed for them
+ */
+class NoStats {
+ public:
+  // Tables could skip work that only feeds counters
+  static constexpr bool IS_ENABLED = false;
+
+  inline void Add(StatsCounter, uint64_t = 1) {}
+
+  inline uint64_t GetTime() const {
+    return 0;
+  }
+
+  inline void Reset() {}
+
+  inline void Swap(NoStats &) {}
+
+  OperationStatsSnapshot GetSnapshot() const {
+    return OperationStatsSnapshot{};
+  }
+};
+
+/*
+ * class CountingStats - Stats policy that counts events in per-thread slots
+ *
+ * Each thread increments counters in its own slot, which is as large as a
+ * cache line, such that readers of concurrent tables do not contend on
+ * counters. A thread is assigned a slot on its first increment; If there
+ * are more threads than slots then slots are shared, which is still correct
+ * since increments are atomic
+ *
+ * The snapshot sums up all slots. It is not atomic with respect to
+ * concurrent increments, but each counter is read atomically
+ *
+ * Counters are allocated on the heap, such that the table could be moved
+ * in O(1). A copy starts with all counters being zero
+ */
+class CountingStats {
+ public:
+  static constexpr bool IS_ENABLED = true;
+
+  // Number of per-thread slots
+  static constexpr uint64_t SLOT_COUNT = 64;
+
+ private:
+  static constexpr uint64_t COUNTER_COUNT = \
+    static_cast<uint64_t>(StatsCounter::COUNTER_COUNT);
+
+  static constexpr uint64_t CACHE_LINE_SIZE = 64;
+
+  /*
+   * class CounterSlot - Counters of one thread
+   *
+   * The slot has the size of a cache line, such that one thread touches
+   * at most two cache lines
+   */
+  class CounterSlot {
+   public:
+    std::atomic<uint64_t> counter_list[COUNTER_COUNT];
+  };
+
+  CounterSlot *slot_list_p;
+
+  /*
+   * GetThreadSlot() - Returns the slot index of the calling thread
+   */
+  static uint64_t GetThreadSlot() {
+    static std::atomic<uint64_t> next_slot{0};
+    static thread_local uint64_t slot = \
+      next_slot.fetch_add(1, std::memory_order_relaxed) % SLOT_COUNT;
+
+    return slot;
+  }
+
+ public:
+
+  /*
+   * Constructor
+   */
+  CountingStats() :
+    slot_list_p{new CounterSlot[SLOT_COUNT]} {
+    static_assert(sizeof(CounterSlot) == CACHE_LINE_SIZE,
+                  "CounterSlot must have the size of a cache line");
+
+    Reset();
+
+    return;
+  }
+
+  /*
+   * Copy Constructor - Starts with fresh counters
+   */
+  CountingStats(const CountingStats &) :
+    CountingStats{} {
+    return;
+  }
+
+  /*
+   * Move Constructor - Takes over the counters
+   */
+  CountingStats(CountingStats &&other) :
+    slot_list_p{other.slot_list_p} {
+    other.slot_list_p = nullptr;
+
+    return;
+  }
+
+  CountingStats &operator=(const CountingStats &) = delete;
+  CountingStats &operator=(CountingStats &&) = delete;
+
+  /*
+   * Destructor
+   */
+  ~CountingStats() {
+    delete[] slot_list_p;
+
+    return;
+  }
+
+  /*
+   * Add() - Adds a value to a counter of the calling thread
+   */
+  inline void Add(StatsCounter counter, uint64_t delta = 1) {
+    slot_list_p[GetThreadSlot()].counter_list[static_cast<uint64_t>(counter)]\
+      .fetch_add(delta, std::memory_order_relaxed);
+
+    return;
+  }
+
+  /*
+   * GetTime() - Returns a timestamp in nanoseconds for timing operations
+   */
+  inline uint64_t GetTime() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /*
+   * Reset() - Sets all counters to zero
+   */
+  void Reset() {
+    for(uint64_t i = 0;i < SLOT_COUNT;i++) {
+      for(uint64_t j = 0;j < COUNTER_COUNT;j++) {
+        slot_list_p[i].counter_list[j].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    return;
+  }
+
+  /*
+   * Swap() - Swaps counters with another instance
+   */
+  void Swap(CountingStats &other) {
+    std::swap(slot_list_p, other.slot_list_p);
+
+    return;
+  }
+
+  /*
+   * GetSnapshot() - Returns the sum of counters over all threads
+   */
+  OperationStatsSnapshot GetSnapshot() const {
+    OperationStatsSnapshot snapshot{};
+
+    for(uint64_t i = 0;i < SLOT_COUNT;i++) {
+      for(uint64_t j = 0;j < COUNTER_COUNT;j++) {
+        snapshot.counter_list[j] += \
+          slot_list_p[i].counter_list[j].load(std::memory_order_relaxed);
+      }
+    }
+
+    return snapshot;
+  }
+};
+
+} // namespace index
+} // namespace peloton
@@ -0,0 +1,176 @@
+
+#pragma once
+
+#include <cstdio>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <utility>
+#include <vector>
+#include <thread>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+namespace peloton {
+namespace index {
+
+#include "common.h"
+
+/*
+ * ParallelBuild() - Builds a hash table from a list of key value pairs
+ *                   using multiple threads
+ *
+ * None of the hash tables is thread-safe, so each thread builds a private
+ * table and private tables are merged into the result. To make the merge
+ * cheap, the input is radix partitioned on the highest bits of the hash
+ * value, such that each key belongs to exactly one partition and private
+ * tables have disjoint key sets. The hash value is mixed before taking the
+ * highest bits, since hash functions such as std::hash<uint64_t> leave them
+ * zero for small keys. The build happens in three phases:
+ *
+ *   1. Each thread computes the partition of pairs in its chunk of the input
+ *      and a histogram of partition sizes. The prefix sum of histograms gives
+ *      every thread a private output range in each partition
+ *   2. Each thread scatters pointers to pairs in its chunk into the output
+ *      ranges, and then builds private tables for the partitions it owns,
+ *      i.e. partition p is owned by thread (p % thread_count)
+ *   3. Private tables are moved into the result by MergeDisjoint(), which
+ *      does not compare keys
+ *
+ * The slot index of a hash table is taken from the lowest bits of the hash
+ * value, so partitioning on the highest bits does not cluster the keys of
+ * a private table in a few slots. The hash of each pair is computed once
+ * in phase 1, and passed to InsertWithHash() of private tables, so
+ * key_hash_obj must be the hash function of TableType
+ *
+ * TableType must be default constructible, and provide
+ * InsertWithHash(key, hash_value, value) and MergeDisjoint(TableType &&).
+ * Values of the same key are inserted in their order in the input
+ */
+template <typename TableType,
+          typename KeyType,
+          typename ValueType,
+          typename KeyHashFunc = std::hash<KeyType>>
+void ParallelBuild(TableType *table_p,
+                   const std::pair<KeyType, ValueType> *input_p,
+                   uint64_t input_count,
+                   uint64_t thread_count,
+                   const KeyHashFunc &key_hash_obj = KeyHashFunc{}) {
+  assert(thread_count > 0);
+
+  // Use at least one partition per thread, and round it up to a power of 2
+  uint64_t partition_bits = 0;
+  while((0x1UL << partition_bits) < thread_count) {
+    partition_bits++;
+  }
+
+  uint64_t partition_count = 0x1UL << partition_bits;
+  uint64_t chunk_size = (input_count + thread_count - 1) / thread_count;
+
+  // Hash value of each input pair, such that hash is only computed once
+  std::vector<uint64_t> hash_list(input_count);
+
+  // Partition of a hash value
+  auto get_partition = [partition_bits](uint64_t hash_value) {
+    if(partition_bits == 0) {
+      return static_cast<uint64_t>(0);
+    }
+
+    return SimpleInt64Hasher{}(hash_value) >> (64 - partition_bits);
+  };
+
+  // histogram[t * partition_count + p] is the number of pairs in the chunk
+  // of thread t that fall into partition p. After the prefix sum it becomes
+  // the offset to write the next pair into
+  std::vector<uint64_t> histogram(thread_count * partition_count, 0);
+
+  // Indices of input pairs ordered by partition
+  std::vector<uint64_t> partitioned_list(input_count);
+
+  // Start offset of each partition in partitioned_list
+  std::vector<uint64_t> partition_start(partition_count + 1, 0);
+
+  std::vector<TableType *> private_table_list(partition_count, nullptr);
+
+  auto run_threads = [thread_count](std::function<void(uint64_t)> f) {
+    std::vector<std::thread> thread_list{};
+    for(uint64_t t = 0;t < thread_count;t++) {
+      thread_list.emplace_back(f, t);
+    }
+
+    for(std::thread &t : thread_list) {
+      t.join();
+    }
+
+    return;
+  };
+
+  // Phase 1: Compute partitions and histograms
+  run_threads([&](uint64_t t) {
+    uint64_t *local_histogram = histogram.data() + t * partition_count;
+    uint64_t end = std::min(input_count, (t + 1) * chunk_size);
+
+    for(uint64_t i = t * chunk_size;i < end;i++) {
+      hash_list[i] = key_hash_obj(input_p[i].first);
+      local_histogram[get_partition(hash_list[i])]++;
+    }
+  });
+
+  // Prefix sum in partition major order, such that the output range of
+  // thread t in partition p comes before that of thread t + 1
+  uint64_t offset = 0;
+  for(uint64_t p = 0;p < partition_count;p++) {
+    partition_start[p] = offset;
+
+    for(uint64_t t = 0;t < thread_count;t++) {
+      uint64_t count = histogram[t * partition_count + p];
+      histogram[t * partition_count + p] = offset;
+      offset += count;
+    }
+  }
+
+  partition_start[partition_count] = offset;
+  assert(offset == input_count);
+
+  // Phase 2: Scatter and build private tables. The scatter must finish on
+  // all threads before any partition is built
+  run_threads([&](uint64_t t) {
+    uint64_t *local_offset = histogram.data() + t * partition_count;
+    uint64_t end = std::min(input_count, (t + 1) * chunk_size);
+
+    for(uint64_t i = t * chunk_size;i < end;i++) {
+      partitioned_list[local_offset[get_partition(hash_list[i])]++] = i;
+    }
+  });
+
+  run_threads([&](uint64_t t) {
+    for(uint64_t p = t;p < partition_count;p += thread_count) {
+      TableType *private_table_p = new TableType{};
+
+      for(uint64_t i = partition_start[p];i < partition_start[p + 1];i++) {
+        uint64_t index = partitioned_list[i];
+        private_table_p->InsertWithHash(input_p[index].first,
+                                        hash_list[index],
+                                        input_p[index].second);
+      }
+
+      private_table_list[p] = private_table_p;
+    }
+  });
+
+  // Phase 3: Merge private tables with disjoint keys
+  for(TableType *private_table_p : private_table_list) {
+    table_p->MergeDisjoint(std::move(*private_table_p));
+
+    delete private_table_p;
+  }
+
+  return;
+}
+
+} // namespace index
+} // namespace peloton
@@ -0,0 +1,181 @@
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+namespace peloton {
+namespace index {
+
+/*
+ * class SpillFile - A temporary file holding a run of fixed size records
+ *
+ * Records are stored in their binary form back to back without any header,
+ * so RecordType must be trivially copyable. Writes go through a stdio buffer
+ * of buffer_size bytes, such that the file only sees large sequential
+ * writes, and the run is read back sequentially after Rewind()
+ *
+ * The file is created by tmpfile(), so it is removed when closed or when
+ * the process exits. I/O errors, including failing to create the file and
+ * running out of disk space, are checked in all builds: Append() and
+ * Rewind() return false, and the file stays failed such that all later
+ * calls also fail. HasFailed() distinguishes a read error from the end of
+ * the run. This class is not thread-safe
+ */
+template <typename RecordType>
+class SpillFile {
+ public:
+  static_assert(std::is_trivially_copyable<RecordType>::value,
+                "Records are written as raw bytes");
+
+  // Default size of the write buffer
+  static constexpr size_t DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+ private:
+  FILE *file_p;
+
+  char *buffer_p;
+
+  size_t buffer_size;
+
+  uint64_t record_count;
+
+  // Whether an I/O error has happened, including failing to create the file
+  bool failed;
+
+ public:
+
+  /*
+   * Constructor - Creates an empty temporary file
+   *
+   * If the file could not be created, the object is failed
+   */
+  SpillFile(size_t p_buffer_size = DEFAULT_BUFFER_SIZE) :
+    file_p{tmpfile()},
+    buffer_p{new char[p_buffer_size]},
+    buffer_size{p_buffer_size},
+    record_count{0},
+    failed{false} {
+    if(file_p == nullptr) {
+      failed = true;
+    } else if(setvbuf(file_p, buffer_p, _IOFBF, buffer_size) != 0) {
+      failed = true;
+    }
+
+    return;
+  }
+
+  SpillFile(const SpillFile &) = delete;
+  SpillFile &operator=(const SpillFile &) = delete;
+
+  /*
+   * Destructor - Closes and removes the file
+   */
+  ~SpillFile() {
+    // The buffer is still used by the file until it is closed
+    if(file_p != nullptr) {
+      fclose(file_p);
+    }
+
+    delete[] buffer_p;
+
+    return;
+  }
+
+  /*
+   * Append() - Writes a record at the end of the run
+   *
+   * Returns false if the record could not be written. Since writes are
+   * buffered, an error could also be reported for records appended before,
+   * or only by Rewind()
+   */
+  inline bool Append(const RecordType &record) {
+    if(failed == true) {
+      return false;
+    }
+
+    if(fwrite(&record, sizeof(RecordType), 1, file_p) != 1) {
+      failed = true;
+
+      return false;
+    }
+
+    record_count++;
+
+    return true;
+  }
+
+  /*
+   * Rewind() - Flushes buffered records and moves to the first record
+   *
+   * This must be called after writing and before reading. Returns false if
+   * buffered records could not be written or the file could not be
+   * repositioned
+   */
+  bool Rewind() {
+    if(failed == true) {
+      return false;
+    }
+
+    if((fflush(file_p) != 0) || (fseek(file_p, 0, SEEK_SET) != 0)) {
+      failed = true;
+
+      return false;
+    }
+
+    return true;
+  }
+
+  /*
+   * Read() - Reads the next record
+   *
+   * Returns false if there is no more record or on a read error, which are
+   * told apart by HasFailed()
+   */
+  inline bool Read(RecordType *record_p) {
+    if(failed == true) {
+      return false;
+    }
+
+    if(fread(record_p, sizeof(RecordType), 1, file_p) != 1) {
+      failed = (ferror(file_p) != 0);
+
+      return false;
+    }
+
+    return true;
+  }
+
+  /*
+   * HasFailed() - Returns whether an I/O error has happened
+   */
+  inline bool HasFailed() const {
+    return failed;
+  }
+
+  /*
+   * GetRecordCount() - Returns the number of records appended
+   */
+  inline uint64_t GetRecordCount() const {
+    return record_count;
+  }
+
+  /*
+   * GetByteCount() - Returns the size of the run in bytes
+   */
+  inline uint64_t GetByteCount() const {
+    return record_count * sizeof(RecordType);
+  }
+
+  /*
+   * GetBufferSize() - Returns the size of the write buffer in bytes
+   */
+  inline size_t GetBufferSize() const {
+    return buffer_size;
+  }
+};
+
+} // namespace index
+} // namespace peloton
@@ -0,0 +1,130 @@
+
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace peloton {
+namespace index {
+
+/*
+ * class StringArena - Owns copies of byte strings in large chunks
+ *
+ * Strings used as keys are copied into the arena back to back, such that
+ * keys of a table are close to each other in memory and are freed at once
+ * when the arena is destroyed, instead of one allocation per string as with
+ * std::string. Strings are not aligned and not null-terminated. A string
+ * longer than a quarter of the chunk size gets its own allocation, so that
+ * chunks are not wasted by a long tail of lengths
+ *
+ * Copies never move once made. This class is not thread-safe
+ */
+class StringArena {
+ public:
+  // Default size of a chunk
+  static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+ private:
+  std::vector<char *> chunk_list;
+
+  // Next free byte and the end of the current chunk
+  char *next_p;
+  char *end_p;
+
+  size_t chunk_size;
+
+  // Bytes allocated from malloc() including unused space in chunks
+  uint64_t memory_size;
+
+  // Bytes of strings copied
+  uint64_t data_size;
+
+  /*
+   * Allocate() - Allocates a block and records it for freeing
+   */
+  char *Allocate(size_t size) {
+    char *p = static_cast<char *>(malloc(size));
+    assert(p != nullptr);
+
+    chunk_list.push_back(p);
+    memory_size += size;
+
+    return p;
+  }
+
+ public:
+
+  /*
+   * Constructor
+   */
+  StringArena(size_t p_chunk_size = DEFAULT_CHUNK_SIZE) :
+    chunk_list{},
+    next_p{nullptr},
+    end_p{nullptr},
+    chunk_size{p_chunk_size},
+    memory_size{0},
+    data_size{0} {
+    return;
+  }
+
+  StringArena(const StringArena &) = delete;
+  StringArena &operator=(const StringArena &) = delete;
+
+  /*
+   * Destructor - Frees all copies
+   */
+  ~StringArena() {
+    for(char *p : chunk_list) {
+      free(p);
+    }
+
+    return;
+  }
+
+  /*
+   * Copy() - Copies length bytes into the arena and returns the copy
+   */
+  const char *Copy(const char *data_p, size_t length) {
+    char *p;
+    if(length > chunk_size / 4) {
+      p = Allocate(length);
+    } else {
+      // The first chunk is allocated even for an empty string such that
+      // the copy is never nullptr
+      if((next_p == nullptr) || \
+         (static_cast<size_t>(end_p - next_p) < length)) {
+        next_p = Allocate(chunk_size);
+        end_p = next_p + chunk_size;
+      }
+
+      p = next_p;
+      next_p += length;
+    }
+
+    memcpy(p, data_p, length);
+    data_size += length;
+
+    return p;
+  }
+
+  /*
+   * GetMemorySize() - Returns the number of bytes allocated
+   */
+  inline uint64_t GetMemorySize() const {
+    return memory_size;
+  }
+
+  /*
+   * GetDataSize() - Returns the total length of strings copied
+   */
+  inline uint64_t GetDataSize() const {
+    return data_size;
+  }
+};
+
+} // namespace index
+} // namespace peloton
@@ -0,0 +1,122 @@
+
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+namespace peloton {
+namespace index {
+
+/*
+ * class ResizeEvent - Describes a resize or in-place rehash of a table
+ *
+ * Capacity is the number of entries in an open addressing table, or the
+ * number of slots in a chained table
+ */
+class ResizeEvent {
+ public:
+  uint64_t old_capacity;
+  uint64_t new_capacity;
+
+  // Number of keys (open addressing) or key value pairs (chaining) moved
+  uint64_t element_count;
+
+  // Number of deleted entries before the resize; Always 0 for chaining
+  uint64_t tombstone_count;
+
+  // Time spent in the resize in nanoseconds; Always 0 before the resize
+  uint64_t duration_ns;
+};
+
+/*
+ * class KVLGrowEvent - Describes growth of the value list of a key
+ */
+class KVLGrowEvent {
+ public:
+  // Capacity is 1 if the key had an inline value
+  uint32_t old_capacity;
+  uint32_t new_capacity;
+
+  // Number of values of the key before the new value is added
+  uint32_t value_count;
+};
+
+/*
+ * class TombstoneEvent - Describes a table in which the ratio of deleted
+ *                        entries reaches the threshold
+ */
+class TombstoneEvent {
+ public:
+  uint64_t capacity;
+  uint64_t element_count;
+  uint64_t tombstone_count;
+};
+
+/*
+ * class TableEventListener - Receives events about table growth
+ *
+ * The listener is registered with SetEventListener() on a table, and the
+ * table does not own it. All functions are called synchronously inside
+ * the table operation that causes the event, so they should return quickly
+ * and must not modify the table. The default implementation ignores all
+ * events, such that a subclass only overrides those it is interested in
+ *
+ * Tables without a listener only pay for a null pointer check on the slow
+ * path of each event. Thresholds are stored in the listener:
+ *
+ *   1. OnKVLGrow() is only called if the new capacity of the value list is
+ *      not less than kvl_grow_threshold
+ *   2. OnTombstoneThreshold() is called once the ratio of deleted entries to
+ *      capacity reaches tombstone_ratio after a delete, i.e. only on the
+ *      delete that crosses the threshold. The ratio drops to 0 after any
+ *      rehash. Only open addressing tables leave tombstones
+ */
+class TableEventListener {
+ public:
+  uint32_t kvl_grow_threshold;
+  double tombstone_ratio;
+
+  /*
+   * Constructor
+   */
+  TableEventListener(uint32_t p_kvl_grow_threshold = 0,
+                     double p_tombstone_ratio = 0.25) :
+    kvl_grow_threshold{p_kvl_grow_threshold},
+    tombstone_ratio{p_tombstone_ratio} {
+    return;
+  }
+
+  virtual ~TableEventListener() {}
+
+  /*
+   * OnResizeBegin() - Called before elements are moved
+   */
+  virtual void OnResizeBegin(const ResizeEvent &) {}
+
+  /*
+   * OnResizeEnd() - Called after elements are moved, with the duration
+   */
+  virtual void OnResizeEnd(const ResizeEvent &) {}
+
+  /*
+   * OnKVLGrow() - Called after a value list is allocated or grown
+   */
+  virtual void OnKVLGrow(const KVLGrowEvent &) {}
+
+  /*
+   * OnTombstoneThreshold() - Called after the delete that makes the ratio
+   *                          of tombstones reach the threshold
+   */
+  virtual void OnTombstoneThreshold(const TombstoneEvent &) {}
+
+  /*
+   * GetTime() - Returns a timestamp in nanoseconds for timing resizes
+   */
+  static uint64_t GetTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+};
+
+} // namespace index
+} // namespace peloton
@@ -27,6 +27,82 @@ static void dummy(const char*, ...) {}
 #define likely(x)   __builtin_expect(!!(x), 1)
 #define unlikely(x) __builtin_expect(!!(x), 0)
 
+/*
+ * PrefetchForRead() - Issues a software prefetch for a memory location that
+ *                     is about to be read
+ *
+ * This does not block, and the address could be invalid in which case the
+ * prefetch is simply ignored by the CPU
+ */
+inline void PrefetchForRead(const void *p) {
+  __builtin_prefetch(p, 0, 3);
+}
+
+/*
+ * RunInterleaved() - Runs a number of independent tasks in an interleaved
+ *                    manner to hide memory latency
+ *
+ * This is the executor of the Asynchronous Memory Access Chaining (AMAC)
+ * pattern. Each task is a lightweight state machine of type LookupStateType
+ * which provides two methods:
+ *
+ *   1. void Start(uint64_t task_index) - Initializes the state for the given
+ *      task, and issues a prefetch for the first memory access
+ *   2. bool Step() - Makes progress on the task using memory that has been
+ *      prefetched, and either returns true if the task has finished, or
+ *      issues a prefetch for the next memory access that is likely to miss
+ *      and returns false to suspend
+ *
+ * The executor keeps group_size tasks in flight, and switches to the next
+ * task in round-robin order whenever the current one suspends, such that the
+ * prefetch has a chance to complete before the task is resumed. As soon as
+ * a task finishes its slot is refilled with the next task, so tasks with
+ * variable length (e.g. probe sequences and collision chains) do not stall
+ * the entire group
+ *
+ * state_list must point to an array of at least group_size states
+ */
+template <uint64_t group_size, typename LookupStateType>
+void RunInterleaved(LookupStateType *state_list, uint64_t task_count) {
+  static_assert(group_size > 0, "Group size must be positive");
+  
+  // Number of slots that are used; If there are fewer tasks than the group
+  // size then only a prefix of the state list is used
+  uint64_t slot_count = (task_count < group_size) ? task_count : group_size;
+  
+  // Whether the task in a slot has finished and could not be refilled
+  bool finished[group_size];
+  
+  for(uint64_t i = 0;i < slot_count;i++) {
+    state_list[i].Start(i);
+    finished[i] = false;
+  }
+  
+  uint64_t next_task = slot_count;
+  uint64_t running_count = slot_count;
+  
+  while(running_count > 0) {
+    for(uint64_t i = 0;i < slot_count;i++) {
+      if(finished[i] == true) {
+        continue;
+      }
+      
+      if(state_list[i].Step() == true) {
+        // Refill the slot with a new task if there is any
+        if(next_task < task_count) {
+          state_list[i].Start(next_task);
+          next_task++;
+        } else {
+          finished[i] = true;
+          running_count--;
+        }
+      }
+    }
+  }
+  
+  return;
+}
+
 /*
  * class LoadFactorHalfFull - Compute load factor as 0.5
  *
@@ -96,6 +172,153 @@ class LoadFactorPercent {
   }
 };
 
+/*
+ * class NoChainReorder - Chain reorder policy that keeps the order of
+ *                        collision chains
+ *
+ * A chain reorder policy is called with the position of an entry found by
+ * a lookup on its chain (0 is the head), and returns whether the entry
+ * should be moved to the head of the chain. Moving hot keys to the front
+ * shortens later lookups for skewed workloads, but every move writes to the
+ * chain, so policies could limit how often it happens
+ */
+class NoChainReorder {
+ public:
+  inline bool operator()(uint64_t) {
+    return false;
+  }
+};
+
+/*
+ * class MoveToFrontAlways - Moves every entry found to the chain head
+ */
+class MoveToFrontAlways {
+ public:
+  inline bool operator()(uint64_t position) {
+    return position > 0;
+  }
+};
+
+/*
+ * class MoveToFrontEveryN - Moves an entry found to the chain head on every
+ *                           n-th lookup that does not hit the head
+ *
+ * Hot keys are found more often, so they are more likely to be moved, while
+ * the write traffic is reduced by a factor of n
+ */
+template <uint64_t n>
+class MoveToFrontEveryN {
+ private:
+  uint64_t counter = 0;
+  
+ public:
+  inline bool operator()(uint64_t position) {
+    if(position == 0) {
+      return false;
+    }
+    
+    counter++;
+    if(counter < n) {
+      return false;
+    }
+    
+    counter = 0;
+    
+    return true;
+  }
+};
+
+/*
+ * class MoveToFrontRandom - Moves an entry found to the chain head with
+ *                           probability 1/n
+ *
+ * This uses a xorshift generator such that deciding costs a few
+ * instructions. Unlike MoveToFrontEveryN, moves do not follow a periodic
+ * pattern in the lookup stream
+ */
+template <uint64_t n>
+class MoveToFrontRandom {
+ private:
+  uint64_t state = 0x9E3779B97F4A7C15UL;
+  
+ public:
+  inline bool operator()(uint64_t position) {
+    if(position == 0) {
+      return false;
+    }
+    
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    
+    return (state % n) == 0;
+  }
+};
+
+/*
+ * class NoTreeify - Treeify policy that never converts collision chains
+ *
+ * A treeify policy decides whether long collision chains are indexed by a
+ * sorted array, such that lookups on them take O(log n) rather than O(n)
+ * even with a bad hash function. It provides IS_ENABLED, TREEIFY_THRESHOLD
+ * and a key comparator operator()(a, b) that returns whether a < b
+ */
+class NoTreeify {
+ public:
+  static constexpr bool IS_ENABLED = false;
+  static constexpr uint64_t TREEIFY_THRESHOLD = 0;
+  
+  template <typename KeyType>
+  inline bool operator()(const KeyType &, const KeyType &) const {
+    return false;
+  }
+};
+
+/*
+ * class TreeifyLongChains - Indexes chains having at least threshold entries
+ *                           with an array sorted by hash value and key
+ *
+ * KeyLess must be a strict weak ordering that is consistent with the key
+ * equality checker of the table, i.e. two keys are equal iff neither is
+ * less than the other
+ */
+template <typename KeyLess, uint64_t threshold = 8>
+class TreeifyLongChains {
+ public:
+  static constexpr bool IS_ENABLED = true;
+  static constexpr uint64_t TREEIFY_THRESHOLD = threshold;
+  
+  static_assert(threshold >= 2, "Chains of one entry need no index");
+  
+  KeyLess key_less_obj;
+  
+  template <typename KeyType>
+  inline bool operator()(const KeyType &a, const KeyType &b) const {
+    return key_less_obj(a, b);
+  }
+};
+
+/*
+ * class NoMatchTracking - Match policy that does not track matched values
+ *
+ * A match policy decides whether HashTable_OA_KVL keeps a match bit for
+ * every value. Outer joins use the bits to find build rows that have not
+ * been matched by any probe row
+ */
+class NoMatchTracking {
+ public:
+  static constexpr bool IS_ENABLED = false;
+};
+
+/*
+ * class TrackMatches - Keeps a bitmap parallel to the entry array, and a
+ *                      bitmap after values of every key value list
+ */
+class TrackMatches {
+ public:
+  static constexpr bool IS_ENABLED = true;
+};
+
 /*
  * class SimpleInt64Hasher - Simple hash function that hashes uint64_t
  *                           into a value that are distributed evenly
@@ -142,6 +365,20 @@ class ConstantZero {
   }
 };
 
+/*
+ * class NoValuePruning - Predicate that never prunes any value
+ *
+ * This is the default pruning predicate for inserts, which is optimized away
+ * after inlining
+ */
+class NoValuePruning {
+ public:
+  template <typename ValueType>
+  inline bool operator()(const ValueType &) const {
+    return false;
+  }
+};
+
 /*
  * class FixedLenValue - This is an object that represents a fixed length
  *                       object which is used for testing
@@ -152,6 +389,487 @@ class FixedLenValue {
   char data[sz];
 };
 
+/*
+ * class TuplePointer48 - Packed tuple location that occupies 6 bytes
+ *
+ * A tuple location consists of a 32 bit block ID and a 16 bit offset inside
+ * the block. Stored as a struct of two 32 bit integers it takes 8 bytes,
+ * while this class stores the 48 bits as three 16 bit words such that the
+ * alignment is 2 bytes and values are packed without padding inside key
+ * value lists. For a list of N values this saves 2 * N bytes
+ *
+ * The packed form is only used for storage; DecodeTuplePointers() converts
+ * a run of packed values into 64 bit integers
+ */
+class TuplePointer48 {
+ public:
+  // Number of bits used for the offset inside a block
+  static constexpr uint64_t OFFSET_BITS = 16;
+  
+  // Mask for the 48 bits that are stored
+  static constexpr uint64_t VALUE_MASK = (0x1UL << 48) - 1;
+  
+  // Low 16 bits stored first
+  uint16_t word[3];
+  
+  /*
+   * Get() - Constructs a packed value from block ID and offset
+   */
+  static inline TuplePointer48 Get(uint32_t block, uint16_t offset) {
+    return FromUInt64((static_cast<uint64_t>(block) << OFFSET_BITS) | offset);
+  }
+  
+  /*
+   * FromUInt64() - Constructs a packed value from the low 48 bits of an
+   *                integer
+   */
+  static inline TuplePointer48 FromUInt64(uint64_t value) {
+    assert((value & ~VALUE_MASK) == 0);
+    
+    return TuplePointer48{{static_cast<uint16_t>(value),
+                           static_cast<uint16_t>(value >> 16),
+                           static_cast<uint16_t>(value >> 32)}};
+  }
+  
+  /*
+   * ToUInt64() - Returns the 48 bit value as an integer
+   */
+  inline uint64_t ToUInt64() const {
+    return static_cast<uint64_t>(word[0]) | \
+           (static_cast<uint64_t>(word[1]) << 16) | \
+           (static_cast<uint64_t>(word[2]) << 32);
+  }
+  
+  inline uint32_t GetBlock() const {
+    return static_cast<uint32_t>(ToUInt64() >> OFFSET_BITS);
+  }
+  
+  inline uint16_t GetOffset() const {
+    return word[0];
+  }
+  
+  inline bool operator==(const TuplePointer48 &other) const {
+    return (word[0] == other.word[0]) && \
+           (word[1] == other.word[1]) && \
+           (word[2] == other.word[2]);
+  }
+  
+  inline bool operator!=(const TuplePointer48 &other) const {
+    return !(*this == other);
+  }
+};
+
+/*
+ * DecodeTuplePointers() - Converts a run of packed tuple locations into
+ *                         64 bit integers
+ *
+ * This is meant to be called on the value array returned by GetValue().
+ * Without -march g++ does not vectorize the three 16 bit loads per value, so
+ * on little endian machines each value except the last is decoded with one
+ * unaligned 8 byte load that also reads the first word of the next value,
+ * which is then masked off. The last value is decoded word by word since the
+ * load could read past the array. benchmark --decode measures this against
+ * the word by word loop
+ */
+inline void DecodeTuplePointers(const TuplePointer48 *src_p,
+                                uint64_t count,
+                                uint64_t *dst_p) {
+  if(count == 0) {
+    return;
+  }
+  
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  const char *byte_p = reinterpret_cast<const char *>(src_p);
+  for(uint64_t i = 0;i < count - 1;i++) {
+    uint64_t value;
+    memcpy(&value, byte_p + i * sizeof(TuplePointer48), sizeof(value));
+    dst_p[i] = value & TuplePointer48::VALUE_MASK;
+  }
+#else
+  for(uint64_t i = 0;i < count - 1;i++) {
+    dst_p[i] = src_p[i].ToUInt64();
+  }
+#endif
+  
+  dst_p[count - 1] = src_p[count - 1].ToUInt64();
+  
+  return;
+}
+
+/*
+ * class ExternalKey - Reference to a key that is stored outside the table
+ *
+ * Tables copy the full key into every entry, which doubles the memory of
+ * wide composite keys that are also kept in tuples. Using this class as the
+ * key type, the table only stores a pointer to the tuple, and the hasher and
+ * equality checker below dereference it to reach the key. Tables compare
+ * the 64 bit hash stored in each entry before calling the equality checker,
+ * so the hash acts as the tag that filters out almost all mismatching
+ * entries before the tuple is touched
+ *
+ * KeyExtractor is a function object that returns a reference to the key
+ * inside a tuple, i.e. const KeyType &operator()(const TupleType &) const,
+ * and declares the key type as KeyExtractor::KeyType
+ *
+ * A reference could point either to a tuple or to a standalone search key,
+ * which is distinguished by the lowest bit of the pointer. Only tuple
+ * references should be inserted, since the table keeps the pointer; search
+ * key references are meant for lookups and deletes with a key that is not in
+ * any tuple. Tuples must outlive the table entries that refer to them, and
+ * their keys must not change while inserted
+ */
+template <typename TupleType, typename KeyExtractor>
+class ExternalKey {
+ public:
+  using KeyType = typename KeyExtractor::KeyType;
+  
+  static_assert(alignof(TupleType) >= 2 && alignof(KeyType) >= 2,
+                "The lowest bit of the pointer is used as the tag");
+  
+ private:
+  // Bit set in ptr if it points to a search key rather than a tuple
+  static constexpr uintptr_t SEARCH_KEY_BIT = 0x1UL;
+  
+  uintptr_t ptr;
+  
+  ExternalKey(uintptr_t p_ptr) :
+    ptr{p_ptr} {
+    return;
+  }
+  
+ public:
+  
+  ExternalKey() = default;
+  
+  /*
+   * FromTuple() - Returns a reference to the key stored in a tuple
+   */
+  static inline ExternalKey FromTuple(const TupleType *tuple_p) {
+    return ExternalKey{reinterpret_cast<uintptr_t>(tuple_p)};
+  }
+  
+  /*
+   * FromSearchKey() - Returns a reference to a standalone key
+   */
+  static inline ExternalKey FromSearchKey(const KeyType *key_p) {
+    return ExternalKey{reinterpret_cast<uintptr_t>(key_p) | SEARCH_KEY_BIT};
+  }
+  
+  /*
+   * IsSearchKey() - Returns whether this refers to a standalone key
+   */
+  inline bool IsSearchKey() const {
+    return (ptr & SEARCH_KEY_BIT) != 0;
+  }
+  
+  /*
+   * GetTuple() - Returns the tuple referred to
+   *
+   * This must not be called on a search key reference
+   */
+  inline const TupleType *GetTuple() const {
+    assert(IsSearchKey() == false);
+    
+    return reinterpret_cast<const TupleType *>(ptr);
+  }
+  
+  /*
+   * GetKey() - Dereferences the key
+   */
+  inline const KeyType &GetKey(const KeyExtractor &key_extractor) const {
+    if(IsSearchKey() == true) {
+      return *reinterpret_cast<const KeyType *>(ptr & ~SEARCH_KEY_BIT);
+    }
+    
+    return key_extractor(*reinterpret_cast<const TupleType *>(ptr));
+  }
+  
+  /*
+   * IsSameReference() - Returns whether both refer to the same memory
+   */
+  inline bool IsSameReference(const ExternalKey &other) const {
+    return ptr == other.ptr;
+  }
+};
+
+/*
+ * class ExternalKeyHasher - Hashes the key referred to by an ExternalKey
+ */
+template <typename TupleType,
+          typename KeyExtractor,
+          typename KeyHashFunc = std::hash<typename KeyExtractor::KeyType>>
+class ExternalKeyHasher {
+ private:
+  KeyExtractor key_extractor;
+  KeyHashFunc key_hash_obj;
+  
+ public:
+  ExternalKeyHasher(const KeyExtractor &p_key_extractor = KeyExtractor{},
+                    const KeyHashFunc &p_key_hash_obj = KeyHashFunc{}) :
+    key_extractor{p_key_extractor},
+    key_hash_obj{p_key_hash_obj} {
+    return;
+  }
+  
+  inline uint64_t operator()(
+      const ExternalKey<TupleType, KeyExtractor> &key) const {
+    return key_hash_obj(key.GetKey(key_extractor));
+  }
+};
+
+/*
+ * class ExternalKeyEqualityChecker - Compares the keys referred to by two
+ *                                    ExternalKey objects
+ *
+ * Two references to the same tuple are equal without dereferencing it
+ */
+template <typename TupleType,
+          typename KeyExtractor,
+          typename KeyEqualityChecker = \
+            std::equal_to<typename KeyExtractor::KeyType>>
+class ExternalKeyEqualityChecker {
+ private:
+  KeyExtractor key_extractor;
+  KeyEqualityChecker key_eq_obj;
+  
+ public:
+  ExternalKeyEqualityChecker(
+      const KeyExtractor &p_key_extractor = KeyExtractor{},
+      const KeyEqualityChecker &p_key_eq_obj = KeyEqualityChecker{}) :
+    key_extractor{p_key_extractor},
+    key_eq_obj{p_key_eq_obj} {
+    return;
+  }
+  
+  using KeyRef = ExternalKey<TupleType, KeyExtractor>;
+  
+  inline bool operator()(const KeyRef &key1, const KeyRef &key2) const {
+    if(key1.IsSameReference(key2) == true) {
+      return true;
+    }
+    
+    return key_eq_obj(key1.GetKey(key_extractor),
+                      key2.GetKey(key_extractor));
+  }
+};
+
+/*
+ * MultiplyFold() - Multiplies two words and folds the 128 bit product into
+ *                  64 bits by XOR
+ *
+ * Every bit of the result depends on all bits of both operands, so this is
+ * used for mixing words in the hash functions below
+ */
+inline uint64_t MultiplyFold(uint64_t a, uint64_t b) {
+  unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+  
+  return static_cast<uint64_t>(product) ^ \
+         static_cast<uint64_t>(product >> 64);
+}
+
+/*
+ * class CompactIntsKey - Composite key of N packed 64 bit integer columns
+ *
+ * Columns are stored back to back without padding, so the key is a plain
+ * array of words that is hashed and compared word by word, instead of
+ * combining std::hash of every member of a std::pair or std::tuple
+ *
+ * Equality is an early exit loop over words rather than a SIMD compare.
+ * Tables compare the cached 64 bit hash before the key, so a lookup
+ * compares about one key, which is on a cache line that has just been
+ * loaded. Lookups are bound by that cache miss. With 2 - 4 columns an SSE2
+ * compare changed the lookup throughput of OA_KVL by -6% to +8% against the
+ * loop (+4% / +8% on hits / misses with 2 columns, -6% / +1% with 3 and
+ * -5% / -1% with 4), which is no consistent gain and does not justify an
+ * architecture specific path
+ *
+ * The default std::equal_to<> of tables uses operator==(), while the hash
+ * function must be given as CompactIntsKeyHasher<N>
+ */
+template <size_t N>
+class CompactIntsKey {
+ public:
+  static_assert(N >= 1, "Key must have at least one column");
+  
+  uint64_t word[N];
+  
+  inline bool operator==(const CompactIntsKey &other) const {
+    for(size_t i = 0;i < N;i++) {
+      if(word[i] != other.word[i]) {
+        return false;
+      }
+    }
+    
+    return true;
+  }
+  
+  inline bool operator!=(const CompactIntsKey &other) const {
+    return !(*this == other);
+  }
+};
+
+/*
+ * class CompactIntsKeyHasher - Hashes all columns of a CompactIntsKey
+ *
+ * Pairs of columns are mixed by a 64 x 64 -> 128 bit multiplication whose
+ * halves are folded by XOR. Products of different pairs do not depend on
+ * each other, so they are computed in parallel, and the sum is mixed by
+ * one more multiplication. This takes one multiplication per two columns
+ * plus one, while the MurmurHash3 finalizer takes two per column
+ */
+template <size_t N>
+class CompactIntsKeyHasher {
+ public:
+  inline uint64_t operator()(const CompactIntsKey<N> &key) const {
+    uint64_t acc = N;
+    
+    // The pair index is mixed in such that permuted pairs hash differently
+    for(size_t i = 0;i + 1 < N;i += 2) {
+      uint64_t a = key.word[i] ^ 0xa0761d6478bd642fUL ^ i;
+      uint64_t b = key.word[i + 1] ^ 0xe7037ed1a0b428dbUL;
+      
+      // Operands are also added, since if one of them is zero then the
+      // product no longer depends on the other column
+      acc += MultiplyFold(a, b) + a + b;
+    }
+    
+    if(N % 2 == 1) {
+      acc += key.word[N - 1] * 0x8ebc6af09c88c6e3UL;
+    }
+    
+    return MultiplyFold(acc ^ 0x589965cc75374cc3UL, 0x1d8e4e27c47d124fUL);
+  }
+};
+
+/*
+ * class CompactIntsKeyEqualityChecker - Compares two CompactIntsKey objects
+ */
+template <size_t N>
+class CompactIntsKeyEqualityChecker {
+ public:
+  inline bool operator()(const CompactIntsKey<N> &key1,
+                         const CompactIntsKey<N> &key2) const {
+    return key1 == key2;
+  }
+};
+
+/*
+ * class StringKey - Variable length byte string key
+ *
+ * The key only refers to bytes stored elsewhere, e.g. in a StringArena, so
+ * it is trivially copyable and takes 16 bytes inside entries. The bytes
+ * must outlive the entries that refer to them and must not change while
+ * inserted
+ *
+ * Tables store the full hash of each key in its entry, so the hash of a
+ * string is computed once on insert and is not recomputed on resize, and
+ * strings are only compared after the hash matches
+ */
+class StringKey {
+ public:
+  const char *data_p;
+  uint64_t length;
+  
+  /*
+   * Get() - Returns a key referring to length bytes at data_p
+   */
+  static inline StringKey Get(const char *data_p, uint64_t length) {
+    return StringKey{data_p, length};
+  }
+  
+  /*
+   * operator==() - Compares lengths first, and bytes only if lengths match
+   *
+   * Empty keys could have nullptr as data, which must not be passed to
+   * memcmp()
+   */
+  inline bool operator==(const StringKey &other) const {
+    return (length == other.length) && \
+           ((data_p == other.data_p) || \
+            (length == 0) || \
+            (memcmp(data_p, other.data_p, length) == 0));
+  }
+  
+  inline bool operator!=(const StringKey &other) const {
+    return !(*this == other);
+  }
+};
+
+/*
+ * class StringKeyHasher - Hashes the bytes of a StringKey
+ *
+ * 16 bytes are consumed per multiplication. The last 1 - 16 bytes are read
+ * as two (possibly overlapping) loads from both ends rather than byte by
+ * byte, which is unambiguous since the length is mixed in first
+ *
+ * The accumulator is kept out of the multiplication, since a block making
+ * one factor zero would erase all bytes before it. Instead it is multiplied
+ * by an odd constant, which loses nothing and makes the hash depend on the
+ * order of blocks, and the product of the block is added to it together
+ * with both operands, as in CompactIntsKeyHasher
+ */
+class StringKeyHasher {
+ private:
+  /*
+   * MixBlock() - Adds 16 bytes to the accumulator
+   */
+  static inline uint64_t MixBlock(uint64_t acc, uint64_t a, uint64_t b) {
+    a ^= 0xa0761d6478bd642fUL;
+    b ^= 0xe7037ed1a0b428dbUL;
+    
+    return acc * 0x8ebc6af09c88c6e3UL + MultiplyFold(a, b) + a + b;
+  }
+  
+ public:
+  inline uint64_t operator()(const StringKey &key) const {
+    const char *p = key.data_p;
+    uint64_t remaining = key.length;
+    uint64_t acc = key.length ^ 0x2d358dccaa6c78a5UL;
+    
+    while(remaining > 16) {
+      uint64_t a, b;
+      memcpy(&a, p, sizeof(a));
+      memcpy(&b, p + 8, sizeof(b));
+      acc = MixBlock(acc, a, b);
+      
+      p += 16;
+      remaining -= 16;
+    }
+    
+    uint64_t a = 0;
+    uint64_t b = 0;
+    if(remaining > 8) {
+      memcpy(&a, p, sizeof(a));
+      memcpy(&b, p + remaining - 8, sizeof(b));
+    } else if(remaining >= 4) {
+      uint32_t low, high;
+      memcpy(&low, p, sizeof(low));
+      memcpy(&high, p + remaining - 4, sizeof(high));
+      a = low;
+      b = high;
+    } else if(remaining > 0) {
+      const uint8_t *byte_p = reinterpret_cast<const uint8_t *>(p);
+      a = (static_cast<uint64_t>(byte_p[0]) << 16) | \
+          (static_cast<uint64_t>(byte_p[remaining / 2]) << 8) | \
+          static_cast<uint64_t>(byte_p[remaining - 1]);
+    }
+    
+    acc = MixBlock(acc, a, b);
+    
+    return MultiplyFold(acc ^ 0x589965cc75374cc3UL, 0x1d8e4e27c47d124fUL);
+  }
+};
+
+/*
+ * class StringKeyEqualityChecker - Compares two StringKey objects
+ */
+class StringKeyEqualityChecker {
+ public:
+  inline bool operator()(const StringKey &key1, const StringKey &key2) const {
+    return key1 == key2;
+  }
+};
+
 /*
  * class Data - Explicitlly managed data wrapping class
  *
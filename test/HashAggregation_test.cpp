@@ -0,0 +1,219 @@
+
+#include "../src/HashAggregation.h"
+
+#include <vector>
+#include <csignal>
+#include <sys/resource.h>
+
+using namespace peloton;
+using namespace index;
+
+static constexpr uint64_t key_num = 100000;
+
+/*
+ * class CountSum - Aggregate of COUNT(*) and SUM()
+ */
+class CountSum {
+ public:
+  uint64_t count;
+  uint64_t sum;
+};
+
+/*
+ * class CountSumCombiner - Adds a partial aggregate into a group
+ */
+class CountSumCombiner {
+ public:
+  inline void operator()(CountSum *group_p, const CountSum &partial) const {
+    group_p->count += partial.count;
+    group_p->sum += partial.sum;
+
+    return;
+  }
+};
+
+/*
+ * AggregateAndVerify() - Adds every key three times and checks that each
+ *                        group is emitted once with correct aggregates
+ */
+template <typename AggregationType>
+void AggregateAndVerify(AggregationType *agg_p, uint64_t group_num) {
+  for(uint64_t round = 0;round < 3;round++) {
+    for(uint64_t i = 0;i < group_num;i++) {
+      assert(agg_p->Add(i, CountSum{1, i + round}) == true);
+    }
+  }
+
+  std::vector<uint64_t> seen_list(group_num, 0);
+  bool ret = \
+    agg_p->Finish([&seen_list](const uint64_t &key, const CountSum &agg) {
+      assert(key < seen_list.size());
+      assert(agg.count == 3);
+      assert(agg.sum == 3 * key + 3);
+
+      seen_list[key]++;
+    });
+  assert(ret == true);
+
+  for(uint64_t i = 0;i < group_num;i++) {
+    assert(seen_list[i] == 1);
+  }
+
+  return;
+}
+
+/*
+ * InMemoryTest() - Tests aggregation without spilling
+ */
+void InMemoryTest() {
+  dbg_printf("========== In Memory Test ==========\n");
+
+  HashAggregation<uint64_t, CountSum, CountSumCombiner> agg{UINT64_MAX};
+  AggregateAndVerify(&agg, key_num);
+
+  assert(agg.GetSpillCount() == 0);
+  assert(agg.GetSpilledRecordCount() == 0);
+  assert(agg.GetMaxLevel() == 0);
+
+  return;
+}
+
+/*
+ * SpillTest() - Tests aggregation that spills partitions with a budget much
+ *               smaller than the table
+ */
+void SpillTest() {
+  dbg_printf("========== Spill Test ==========\n");
+
+  using AggregationType = \
+    HashAggregation<uint64_t, CountSum, CountSumCombiner>;
+
+  AggregationType agg{64 * 1024};
+  AggregateAndVerify(&agg, key_num);
+
+  dbg_printf("%lu partitions spilled; %lu records; max level %lu\n",
+             agg.GetSpillCount(),
+             agg.GetSpilledRecordCount(),
+             agg.GetMaxLevel());
+
+  // Runs of the first level are still too large for the budget
+  assert(agg.GetSpillCount() > AggregationType::PARTITION_COUNT);
+  assert(agg.GetMaxLevel() >= 2);
+
+  // The operator could be reused after Finish()
+  AggregateAndVerify(&agg, key_num / 10);
+
+  return;
+}
+
+/*
+ * MaxLevelTest() - Tests that keys that could not be partitioned are
+ *                  aggregated in memory at the deepest level
+ */
+void MaxLevelTest() {
+  dbg_printf("========== Max Level Test ==========\n");
+
+  using AggregationType = HashAggregation<uint64_t,
+                                          CountSum,
+                                          CountSumCombiner,
+                                          ConstantZero>;
+
+  AggregationType agg{1024};
+  AggregateAndVerify(&agg, 1000);
+
+  assert(agg.GetMaxLevel() == AggregationType::MAX_LEVEL);
+
+  return;
+}
+
+/*
+ * SpillFileTest() - Tests writing and reading back a run
+ */
+void SpillFileTest() {
+  dbg_printf("========== Spill File Test ==========\n");
+
+  // The buffer is smaller than the run
+  SpillFile<CountSum> file{4096};
+  for(uint64_t i = 0;i < key_num;i++) {
+    assert(file.Append(CountSum{i, i * 2}) == true);
+  }
+
+  assert(file.GetRecordCount() == key_num);
+  assert(file.GetByteCount() == key_num * sizeof(CountSum));
+
+  for(int round = 0;round < 2;round++) {
+    assert(file.Rewind() == true);
+
+    CountSum record;
+    uint64_t i = 0;
+    while(file.Read(&record) == true) {
+      assert(record.count == i);
+      assert(record.sum == i * 2);
+      i++;
+    }
+
+    assert(i == key_num);
+    assert(file.HasFailed() == false);
+  }
+
+  return;
+}
+
+/*
+ * SpillErrorTest() - Tests that write errors are reported in all builds
+ *
+ * The size of files is limited by RLIMIT_FSIZE, under which writes past the
+ * limit fail with EFBIG once SIGXFSZ is ignored
+ */
+void SpillErrorTest() {
+  dbg_printf("========== Spill Error Test ==========\n");
+
+  struct rlimit old_limit;
+  int ret = getrlimit(RLIMIT_FSIZE, &old_limit);
+  assert(ret == 0);
+
+  struct rlimit new_limit = old_limit;
+  new_limit.rlim_cur = 64 * 1024;
+  ret = setrlimit(RLIMIT_FSIZE, &new_limit);
+  assert(ret == 0);
+
+  void (*old_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+
+  SpillFile<CountSum> file{4096};
+  uint64_t append_count = 0;
+  while(file.Append(CountSum{append_count, 0}) == true) {
+    append_count++;
+  }
+
+  // Records beyond the limit are not written, and the file stays failed
+  assert(append_count < key_num);
+  assert(file.HasFailed() == true);
+  assert(file.Append(CountSum{0, 0}) == false);
+  assert(file.Rewind() == false);
+
+  // Runs of the aggregation are also larger than the limit
+  HashAggregation<uint64_t, CountSum, CountSumCombiner> agg{64 * 1024};
+  bool add_ok = true;
+  for(uint64_t i = 0;i < 10 * key_num;i++) {
+    add_ok = agg.Add(i, CountSum{1, i}) && add_ok;
+  }
+
+  bool finish_ok = agg.Finish([](const uint64_t &, const CountSum &) {});
+  assert((add_ok == false) || (finish_ok == false));
+
+  signal(SIGXFSZ, old_handler);
+  ret = setrlimit(RLIMIT_FSIZE, &old_limit);
+  assert(ret == 0);
+
+  return;
+}
+
+int main() {
+  SpillFileTest();
+  InMemoryTest();
+  SpillTest();
+  MaxLevelTest();
+  SpillErrorTest();
+
+  return 0;
+}
@@ -1,5 +1,8 @@
 
 #include "../src/HashTable_CA_CC.h"
+#include "HashTable_CA_test_common.h"
+#include <algorithm>
+#include <numeric>
 
 using namespace peloton;
 using namespace index;
@@ -28,8 +31,53 @@ void BasicTest() {
   return;
 }
 
+/*
+ * MemoryBudgetTest() - Tests that inserts are refused when entries or the
+ *                      larger slot array exceed the budget
+ */
+void MemoryBudgetTest() {
+  dbg_printf("========== Memory Budget Test ==========\n");
+  
+  MemoryBudget budget{256 * 1024};
+  
+  {
+    HashTable ht{};
+    ht.SetMemoryBudget(&budget);
+    
+    FillToMemoryBudget(&ht, &budget);
+  }
+  
+  assert(budget.GetUsedSize() == 0);
+  
+  return;
+}
+
+/*
+ * HashValueTest() - Tests functions taking a hash value computed by the
+ *                   caller, mixed with functions that hash the key
+ */
+void HashValueTest() {
+  dbg_printf("========== Hash Value Test ==========\n");
+  
+  HashTable ht{};
+  FillWithHashValue(&ht, 10000);
+  
+  return;
+}
+
 int main() {
   BasicTest();
+  IteratorTest<HashTable>();
+  MoveCloneTest<HashTable>();
+  ChainStatsTest<HashTable,
+                 HashTable_CA_CC<uint64_t, uint64_t, ConstantZero>>(
+    "HashTable_CA_CC");
+  MemoryBudgetTest();
+  HashValueTest();
+  KeyCompareTest<HashTable_CA_CC<uint64_t,
+                                 uint64_t,
+                                 SimpleInt64Hasher,
+                                 CountingEqualityChecker>>();
   
   return 0;
 }
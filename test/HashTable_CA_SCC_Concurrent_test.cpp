@@ -0,0 +1,251 @@
+
+#include "../src/HashTable_CA_SCC_Concurrent.h"
+#include <thread>
+#include <random>
+
+using namespace peloton;
+using namespace index;
+
+using HashTable = HashTable_CA_SCC_Concurrent<uint64_t, uint64_t, SimpleInt64Hasher>;
+
+void BasicTest() {
+  dbg_printf("========== Basic Test ==========\n");
+
+  HashTable ht{30};
+  uint64_t thread_id = ht.RegisterThread();
+
+  // Odd keys are inserted with hash values computed by the caller
+  SimpleInt64Hasher hasher{};
+  for(uint64_t i = 0;i < 1000;i++) {
+    if(i % 2 == 0) {
+      ht.Insert(thread_id, i, i);
+    } else {
+      ht.InsertWithHash(thread_id, i, hasher(i), i);
+    }
+  }
+
+  for(uint64_t i = 0;i < 1000;i++) {
+    std::vector<uint64_t> v{};
+
+    ht.GetValue(thread_id, i, &v);
+    assert(v.size() == 1);
+    assert(i == v[0]);
+
+    uint64_t count = 0;
+    ht.GetValueWithHash(thread_id,
+                        i,
+                        hasher(i),
+                        [i, &count](const std::pair<uint64_t, uint64_t> &kv) {
+                          assert(kv.second == i);
+                          count++;
+                        });
+    assert(count == 1);
+  }
+
+  assert(ht.GetEntryCount() == 1000);
+  dbg_printf("Slot count = %lu\n", ht.GetSlotCount());
+
+  ht.UnregisterThread(thread_id);
+
+  return;
+}
+
+/*
+ * ConcurrentTest() - Writers insert disjoint key ranges while readers read
+ *                    keys that are known to have been inserted
+ *
+ * Each writer publishes the number of keys it has inserted, and key k is
+ * mapped to values k and k + 1
+ */
+void ConcurrentTest() {
+  dbg_printf("========== Concurrent Test ==========\n");
+
+  static constexpr uint64_t key_num_per_writer = 50000;
+  static constexpr int writer_num = 4;
+  static constexpr int reader_num = 2;
+
+  // Start small to trigger many resizes while other threads are active
+  HashTable ht{8};
+  std::atomic<uint64_t> finished_key_count[writer_num];
+  for(int t = 0;t < writer_num;t++) {
+    finished_key_count[t].store(0);
+  }
+
+  std::vector<std::thread> thread_list{};
+  for(int t = 0;t < writer_num;t++) {
+    thread_list.emplace_back([&ht, &finished_key_count, t]() {
+      uint64_t thread_id = ht.RegisterThread();
+
+      for(uint64_t i = 0;i < key_num_per_writer;i++) {
+        uint64_t key = i * writer_num + t;
+
+        ht.Insert(thread_id, key, key);
+        ht.Insert(thread_id, key, key + 1);
+
+        finished_key_count[t].store(i + 1, std::memory_order_release);
+      }
+
+      ht.UnregisterThread(thread_id);
+    });
+  }
+
+  for(int t = 0;t < reader_num;t++) {
+    thread_list.emplace_back([&ht, &finished_key_count, t]() {
+      uint64_t thread_id = ht.RegisterThread();
+      std::default_random_engine e{static_cast<unsigned>(t)};
+
+      bool all_finished = false;
+      while(all_finished == false) {
+        all_finished = true;
+
+        for(int w = 0;w < writer_num;w++) {
+          uint64_t finished = finished_key_count[w].load(std::memory_order_acquire);
+          if(finished < key_num_per_writer) {
+            all_finished = false;
+          }
+
+          if(finished == 0) {
+            continue;
+          }
+
+          std::uniform_int_distribution<uint64_t> dist{0, finished - 1};
+          uint64_t key = dist(e) * writer_num + w;
+
+          std::vector<uint64_t> v{};
+          ht.GetValue(thread_id, key, &v);
+
+          // Resize does not preserve the order on the chain
+          assert(v.size() == 2);
+          assert(v[0] + v[1] == 2 * key + 1);
+        }
+      }
+
+      ht.UnregisterThread(thread_id);
+    });
+  }
+
+  for(std::thread &t : thread_list) {
+    t.join();
+  }
+
+  assert(ht.GetEntryCount() == 2 * writer_num * key_num_per_writer);
+
+  uint64_t thread_id = ht.RegisterThread();
+  for(uint64_t key = 0;key < writer_num * key_num_per_writer;key++) {
+    std::vector<uint64_t> v{};
+    ht.GetValue(thread_id, key, &v);
+
+    assert(v.size() == 2);
+  }
+
+  ht.UnregisterThread(thread_id);
+
+  // No thread is active, so every retired directory could be freed
+  ht.ReclaimMemory();
+  assert(ht.GetRetiredDirectoryCount() == 0);
+
+  dbg_printf("Final slot count = %lu\n", ht.GetSlotCount());
+
+  return;
+}
+
+/*
+ * ReclaimTest() - Tests that directories replaced by resize are freed
+ *                 without waiting for the table to be destroyed
+ */
+void ReclaimTest() {
+  dbg_printf("========== Reclaim Test ==========\n");
+
+  HashTable ht{8};
+  uint64_t thread_id = ht.RegisterThread();
+
+  uint64_t resize_count = 0;
+  uint64_t slot_count = ht.GetSlotCount();
+  for(uint64_t i = 0;i < 100000;i++) {
+    ht.Insert(thread_id, i, i);
+
+    if(ht.GetSlotCount() != slot_count) {
+      slot_count = ht.GetSlotCount();
+      resize_count++;
+    }
+
+    // The only thread resizes outside of its epoch, so the old directory
+    // is freed right after the new one is published
+    assert(ht.GetRetiredDirectoryCount() == 0);
+  }
+
+  assert(resize_count > 1);
+
+  for(uint64_t i = 0;i < 100000;i++) {
+    std::vector<uint64_t> v{};
+    ht.GetValue(thread_id, i, &v);
+
+    assert(v.size() == 1);
+    assert(v[0] == i);
+  }
+
+  ht.UnregisterThread(thread_id);
+
+  dbg_printf("Resize count = %lu\n", resize_count);
+
+  return;
+}
+
+/*
+ * class ModHasher - Maps keys to 16 hash values, such that chains mix
+ *                   entries of different new slots and long runs of the same
+ */
+class ModHasher {
+ public:
+  uint64_t operator()(uint64_t key) const {
+    return key % 16;
+  }
+};
+
+/*
+ * ChainShareTest() - Tests resize that shares trailing runs of chains and
+ *                    copies entries before them
+ */
+void ChainShareTest() {
+  dbg_printf("========== Chain Share Test ==========\n");
+
+  HashTable_CA_SCC_Concurrent<uint64_t, uint64_t, ModHasher> ht{4};
+  uint64_t thread_id = ht.RegisterThread();
+
+  uint64_t slot_count = ht.GetSlotCount();
+  for(uint64_t i = 0;i < 4000;i++) {
+    ht.Insert(thread_id, i, i);
+
+    if(ht.GetSlotCount() == slot_count) {
+      continue;
+    }
+
+    slot_count = ht.GetSlotCount();
+    for(uint64_t j = 0;j <= i;j++) {
+      std::vector<uint64_t> v{};
+      ht.GetValue(thread_id, j, &v);
+
+      assert(v.size() == 1);
+      assert(v[0] == j);
+    }
+  }
+
+  assert(ht.GetEntryCount() == 4000);
+  assert(ht.GetRetiredDirectoryCount() == 0);
+  assert(slot_count > 16);
+
+  ht.UnregisterThread(thread_id);
+
+  dbg_printf("Final slot count = %lu\n", slot_count);
+
+  return;
+}
+
+int main() {
+  BasicTest();
+  ConcurrentTest();
+  ReclaimTest();
+  ChainShareTest();
+
+  return 0;
+}
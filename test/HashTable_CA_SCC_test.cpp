@@ -1,10 +1,19 @@
 
 #include "../src/HashTable_CA_SCC.h"
+#include "../src/StringArena.h"
+#include "HashTable_CA_test_common.h"
+#include <algorithm>
+#include <numeric>
+#include <string>
 
 using namespace peloton;
 using namespace index;
 
 using HashTable = HashTable_CA_SCC<uint64_t, uint64_t, SimpleInt64Hasher>;
+using CountingTable = HashTable_CA_SCC<uint64_t,
+                                       uint64_t,
+                                       SimpleInt64Hasher,
+                                       CountingEqualityChecker>;
 
 void BasicTest() {
   HashTable ht{30};
@@ -28,8 +37,603 @@ void BasicTest() {
   return;
 }
 
+void InterleavedLookupTest() {
+  dbg_printf("========== Interleaved Lookup Test ==========\n");
+  
+  // Small slot count and load factor of 400% make chains long
+  HashTable ht{30};
+  
+  for(uint64_t i = 0;i < 1000;i++) {
+    ht.Insert(i, i);
+    
+    if(i % 5 == 0) {
+      ht.Insert(i, i + 1);
+    }
+  }
+  
+  // Keys in [1000, 1100) do not exist
+  std::vector<uint64_t> key_list{};
+  for(uint64_t i = 0;i < 1100;i++) {
+    key_list.push_back((i * 13) % 1100);
+  }
+  
+  std::vector<std::vector<uint64_t>> result_list(key_list.size());
+  ht.GetValueInterleaved(key_list.data(),
+                         key_list.size(),
+                         [&](uint64_t key_index,
+                             const std::pair<uint64_t, uint64_t> &kv_pair) {
+    assert(kv_pair.first == key_list[key_index]);
+    result_list[key_index].push_back(kv_pair.second);
+  });
+  
+  for(uint64_t i = 0;i < key_list.size();i++) {
+    std::vector<uint64_t> v{};
+    ht.GetValue(key_list[i], &v);
+    
+    assert(v == result_list[i]);
+  }
+  
+  return;
+}
+
+/*
+ * MergeTest() - Tests moving entries of one table into another
+ */
+void MergeTest() {
+  dbg_printf("========== Merge Test ==========\n");
+  
+  // Use small tables such that the destination must grow
+  HashTable ht1{16};
+  HashTable ht2{16};
+  for(uint64_t i = 0;i < 1000;i++) {
+    ht1.Insert(i, i);
+  }
+  
+  for(uint64_t i = 500;i < 1500;i++) {
+    ht2.Insert(i, i + 1);
+  }
+  
+  ht1.Merge(std::move(ht2));
+  
+  assert(ht2.begin() == ht2.end());
+  assert(std::distance(ht1.begin(), ht1.end()) == 2000);
+  
+  for(uint64_t i = 0;i < 1500;i++) {
+    std::vector<uint64_t> v{};
+    ht1.GetValue(i, &v);
+    
+    uint64_t sum = 0;
+    for(uint64_t value : v) {
+      sum += value;
+    }
+    
+    if(i < 500) {
+      assert(v.size() == 1);
+      assert(sum == i);
+    } else if(i < 1000) {
+      assert(v.size() == 2);
+      assert(sum == 2 * i + 1);
+    } else {
+      assert(v.size() == 1);
+      assert(sum == i + 1);
+    }
+  }
+  
+  return;
+}
+
+/*
+ * class ResizeListener - Records resize events for testing
+ */
+class ResizeListener : public TableEventListener {
+ public:
+  std::vector<ResizeEvent> begin_list;
+  std::vector<ResizeEvent> end_list;
+  
+  void OnResizeBegin(const ResizeEvent &event) override {
+    begin_list.push_back(event);
+  }
+  
+  void OnResizeEnd(const ResizeEvent &event) override {
+    end_list.push_back(event);
+  }
+};
+
+/*
+ * ResizeEventTest() - Tests resize events
+ */
+void ResizeEventTest() {
+  dbg_printf("========== Resize Event Test ==========\n");
+  
+  ResizeListener listener{};
+  HashTable ht{30};
+  ht.SetEventListener(&listener);
+  
+  for(uint64_t i = 0;i < 10000;i++) {
+    ht.Insert(i, i);
+  }
+  
+  assert(listener.end_list.size() > 0);
+  assert(listener.begin_list.size() == listener.end_list.size());
+  
+  // Each resize doubles the slot array of the previous one
+  uint64_t slot_count = listener.end_list[0].old_capacity;
+  for(const ResizeEvent &event : listener.end_list) {
+    assert(event.old_capacity == slot_count);
+    assert(event.new_capacity == slot_count * 2);
+    assert(event.element_count > 0);
+    assert(event.tombstone_count == 0);
+    
+    slot_count = event.new_capacity;
+  }
+  
+  return;
+}
+
+/*
+ * SelfOrganizingTest() - Tests moving keys found to the chain head
+ */
+void SelfOrganizingTest() {
+  dbg_printf("========== Self Organizing Test ==========\n");
+  
+  // All keys are on the same chain, with key 99 on the head
+  HashTable_CA_SCC<uint64_t,
+                   uint64_t,
+                   ConstantZero,
+                   std::equal_to<uint64_t>,
+                   LoadFactorPercent<400>,
+                   CountingStats,
+                   MoveToFrontAlways> ht{30};
+  for(uint64_t i = 0;i < 100;i++) {
+    ht.Insert(i, i);
+  }
+  
+  assert(*ht.GetFirstValue(0) == 0);
+  assert(ht.GetStats().Get(StatsCounter::CHAIN_WALK) == 100);
+  
+  // Key 0 is now on the head
+  ht.ResetStats();
+  assert(*ht.GetFirstValue(0) == 0);
+  assert(ht.GetStats().Get(StatsCounter::CHAIN_WALK) == 1);
+  
+  // Missing keys walk the entire chain and do not reorder
+  assert(ht.GetFirstValue(100) == nullptr);
+  assert(*ht.GetFirstValue(1) == 1);
+  assert(*ht.GetFirstValue(0) == 0);
+  
+  ht.ResetStats();
+  assert(*ht.GetFirstValue(1) == 1);
+  assert(ht.GetStats().Get(StatsCounter::CHAIN_WALK) == 2);
+  
+  // Reordering must not lose any entry
+  for(uint64_t i = 0;i < 100;i++) {
+    assert(*ht.GetFirstValue(i) == i);
+    
+    std::vector<uint64_t> v{};
+    ht.GetValue(i, &v);
+    assert(v.size() == 1);
+  }
+  
+  assert(std::distance(ht.begin(), ht.end()) == 100);
+  
+  // Key 5 is moved on the 4th lookup that does not hit the head
+  HashTable_CA_SCC<uint64_t,
+                   uint64_t,
+                   ConstantZero,
+                   std::equal_to<uint64_t>,
+                   LoadFactorPercent<400>,
+                   CountingStats,
+                   MoveToFrontEveryN<4>> counting_ht{30};
+  for(uint64_t i = 0;i < 10;i++) {
+    counting_ht.Insert(i, i);
+  }
+  
+  for(int i = 0;i < 4;i++) {
+    counting_ht.ResetStats();
+    counting_ht.GetFirstValue(5);
+    assert(counting_ht.GetStats().Get(StatsCounter::CHAIN_WALK) == 5);
+  }
+  
+  counting_ht.ResetStats();
+  counting_ht.GetFirstValue(5);
+  assert(counting_ht.GetStats().Get(StatsCounter::CHAIN_WALK) == 1);
+  
+  // Probabilistic moves with duplicated keys
+  HashTable_CA_SCC<uint64_t,
+                   uint64_t,
+                   ConstantZero,
+                   std::equal_to<uint64_t>,
+                   LoadFactorPercent<400>,
+                   NoStats,
+                   MoveToFrontRandom<2>> random_ht{30};
+  for(uint64_t i = 0;i < 100;i++) {
+    random_ht.Insert(i % 10, i);
+  }
+  
+  for(uint64_t i = 0;i < 1000;i++) {
+    assert(*random_ht.GetFirstValue(i % 10) % 10 == i % 10);
+  }
+  
+  for(uint64_t i = 0;i < 10;i++) {
+    std::vector<uint64_t> v{};
+    random_ht.GetValue(i, &v);
+    assert(v.size() == 10);
+  }
+  
+  return;
+}
+
+/*
+ * class IdentityHasher - Uses the key as its hash value, such that tests
+ *                        could choose the slot of each key
+ */
+class IdentityHasher {
+ public:
+  inline uint64_t operator()(uint64_t value) const {
+    return value;
+  }
+};
+
+/*
+ * TreeifyTest() - Tests indexing long chains by sorted arrays
+ */
+void TreeifyTest() {
+  dbg_printf("========== Treeify Test ==========\n");
+  
+  using TreeifyTable = \
+    HashTable_CA_SCC<uint64_t,
+                     uint64_t,
+                     ConstantZero,
+                     std::equal_to<uint64_t>,
+                     LoadFactorPercent<400>,
+                     CountingStats,
+                     NoChainReorder,
+                     TreeifyLongChains<std::less<uint64_t>, 8>>;
+  using ChainTable = HashTable_CA_SCC<uint64_t, uint64_t, ConstantZero>;
+  
+  // All keys are on the same chain; Key i % 100 has 10 values
+  TreeifyTable ht{30};
+  ChainTable chain_ht{30};
+  for(uint64_t i = 0;i < 1000;i++) {
+    ht.Insert(i % 100, i);
+    chain_ht.Insert(i % 100, i);
+  }
+  
+  assert(ht.GetChainStats().treeified_slot_count == 1);
+  
+  ht.ResetStats();
+  for(uint64_t i = 0;i < 100;i++) {
+    std::vector<uint64_t> v{};
+    std::vector<uint64_t> chain_v{};
+    ht.GetValue(i, &v);
+    chain_ht.GetValue(i, &chain_v);
+    
+    // Values are in the same order as on a plain chain
+    assert(v == chain_v);
+    assert(v.size() == 10);
+    
+    assert(*ht.GetFirstValue(i) == *chain_ht.GetFirstValue(i));
+  }
+  
+  assert(ht.GetFirstValue(100) == nullptr);
+  
+  // Binary search on 1000 entries plus 10 matches
+  OperationStatsSnapshot snapshot = ht.GetStats();
+  assert(snapshot.Get(StatsCounter::CHAIN_WALK) < 201 * 25);
+  
+  assert(std::distance(ht.begin(), ht.end()) == 1000);
+  
+  // Clone and merge keep the index
+  TreeifyTable clone = ht.Clone();
+  TreeifyTable other{30};
+  for(uint64_t i = 0;i < 100;i++) {
+    other.Insert(i + 1000, i);
+  }
+  
+  clone.Merge(std::move(other));
+  assert(clone.GetChainStats().treeified_slot_count == 1);
+  assert(other.GetChainStats().entry_count == 0);
+  
+  for(uint64_t i = 0;i < 1100;i++) {
+    std::vector<uint64_t> v{};
+    clone.GetValue(i, &v);
+    
+    assert(v.size() == ((i < 100) ? 10 : (i < 1000 ? 0 : 1)));
+  }
+  
+  // Keys 32 * k are on slot 0 with 32 slots, and are split into two
+  // slots of 5 keys when the table grows to 64 slots
+  HashTable_CA_SCC<uint64_t,
+                   uint64_t,
+                   IdentityHasher,
+                   std::equal_to<uint64_t>,
+                   LoadFactorPercent<400>,
+                   NoStats,
+                   NoChainReorder,
+                   TreeifyLongChains<std::less<uint64_t>, 8>> split_ht{16};
+  for(uint64_t k = 0;k < 10;k++) {
+    split_ht.Insert(k * 32, k);
+  }
+  
+  ChainStats chain_stats = split_ht.GetChainStats();
+  assert(chain_stats.slot_count == 32);
+  assert(chain_stats.treeified_slot_count == 1);
+  
+  for(uint64_t i = 1;chain_stats.slot_count == 32;i++) {
+    if(i % 32 != 0) {
+      split_ht.Insert(i, i);
+    }
+    
+    chain_stats = split_ht.GetChainStats();
+  }
+  
+  assert(chain_stats.slot_count == 64);
+  assert(chain_stats.treeified_slot_count == 0);
+  
+  for(uint64_t k = 0;k < 10;k++) {
+    assert(*split_ht.GetFirstValue(k * 32) == k);
+  }
+  
+  return;
+}
+
+/*
+ * CompactTest() - Tests relocating entries into a slab
+ */
+void CompactTest() {
+  dbg_printf("========== Compact Test ==========\n");
+  
+  using StringTable = \
+    HashTable_CA_SCC<uint64_t, std::string, SimpleInt64Hasher>;
+  
+  auto check = [](StringTable *ht_p, uint64_t key_count) {
+    for(uint64_t i = 0;i < key_count;i++) {
+      std::vector<std::string> v{};
+      ht_p->GetValue(i, &v);
+      
+      assert(v.size() == 1);
+      assert(v[0] == std::to_string(i));
+    }
+    
+    assert(static_cast<uint64_t>(std::distance(ht_p->begin(), ht_p->end())) == \
+           key_count);
+  };
+  
+  StringTable ht{30};
+  for(uint64_t i = 0;i < 1000;i++) {
+    ht.Insert(i, std::to_string(i));
+  }
+  
+  ht.Compact();
+  check(&ht, 1000);
+  
+  // Entries are visited in increasing address order
+  const void *prev_p = nullptr;
+  for(auto it = ht.begin();it != ht.end();++it) {
+    const void *p = &(*it);
+    assert(p > prev_p);
+    
+    prev_p = p;
+  }
+  
+  // Entries allocated after compaction and those in the slab coexist
+  for(uint64_t i = 1000;i < 2000;i++) {
+    ht.Insert(i, std::to_string(i));
+  }
+  
+  check(&ht, 2000);
+  ht.Compact();
+  check(&ht, 2000);
+  
+  // Merged tables hand over their slabs
+  StringTable other{30};
+  for(uint64_t i = 2000;i < 3000;i++) {
+    other.Insert(i, std::to_string(i));
+  }
+  
+  other.Compact();
+  ht.Merge(std::move(other));
+  check(&ht, 3000);
+  
+  StringTable moved{std::move(ht)};
+  moved.Compact();
+  check(&moved, 3000);
+  
+  // Compacting after every resize, together with treeified chains
+  HashTable_CA_SCC<uint64_t,
+                   uint64_t,
+                   ConstantZero,
+                   std::equal_to<uint64_t>,
+                   LoadFactorPercent<400>,
+                   NoStats,
+                   NoChainReorder,
+                   TreeifyLongChains<std::less<uint64_t>, 8>> resize_ht{30};
+  resize_ht.SetCompactOnResize(true);
+  
+  for(uint64_t i = 0;i < 1000;i++) {
+    resize_ht.Insert(i, i);
+  }
+  
+  for(uint64_t i = 0;i < 1000;i++) {
+    assert(*resize_ht.GetFirstValue(i) == i);
+  }
+  
+  StringTable empty_ht{30};
+  empty_ht.Compact();
+  assert(empty_ht.begin() == empty_ht.end());
+  
+  return;
+}
+
+/*
+ * MemoryBudgetTest() - Tests that inserts are refused when entries or the
+ *                      larger slot array exceed the budget, and that Merge()
+ *                      moves the charge between budgets
+ */
+void MemoryBudgetTest() {
+  dbg_printf("========== Memory Budget Test ==========\n");
+  
+  MemoryBudget budget{256 * 1024};
+  MemoryBudget other_budget{UINT64_MAX};
+  
+  {
+    HashTable ht{};
+    ht.SetMemoryBudget(&budget);
+    
+    uint64_t key = FillToMemoryBudget(&ht, &budget);
+    
+    HashTable other{};
+    other.SetMemoryBudget(&other_budget);
+    for(uint64_t i = 0;i < 1000;i++) {
+      assert(other.Insert(key + i, i) == true);
+    }
+    
+    ht.Merge(std::move(other));
+    assert(budget.GetUsedSize() == ht.GetMemorySize());
+    assert(other_budget.GetUsedSize() == other.GetMemorySize());
+  }
+  
+  assert(budget.GetUsedSize() == 0);
+  assert(other_budget.GetUsedSize() == 0);
+  
+  return;
+}
+
+/*
+ * HashValueTest() - Tests functions taking a hash value computed by the
+ *                   caller, mixed with functions that hash the key
+ */
+void HashValueTest() {
+  dbg_printf("========== Hash Value Test ==========\n");
+  
+  SimpleInt64Hasher hasher{};
+  HashTable ht{};
+  FillWithHashValue(&ht, 10000);
+  
+  for(uint64_t i = 0;i < 10000;i++) {
+    assert(*ht.GetFirstValueWithHash(i, hasher(i)) == i);
+    assert(ht.GetFirstValue(i) == ht.GetFirstValueWithHash(i, hasher(i)));
+  }
+  
+  for(auto it = ht.begin();it != ht.end();++it) {
+    assert(it.GetHashValue() == hasher(it->first));
+  }
+  
+  return;
+}
+
+/*
+ * FirstValueCompareTest() - Tests that GetFirstValue() only compares keys
+ *                           on entries whose hash value matches
+ */
+void FirstValueCompareTest() {
+  dbg_printf("========== First Value Compare Test ==========\n");
+  
+  const uint64_t key_num = 10000;
+  
+  CountingTable ht{30};
+  for(uint64_t i = 0;i < key_num;i++) {
+    ht.Insert(i, i);
+  }
+  
+  CountingEqualityChecker::compare_count = 0;
+  
+  for(uint64_t i = 0;i < 2 * key_num;i++) {
+    uint64_t *value_p = ht.GetFirstValue(i);
+    
+    assert((value_p != nullptr) == (i < key_num));
+  }
+  
+  assert(CountingEqualityChecker::compare_count == key_num);
+  
+  return;
+}
+
+/*
+ * CompactKeyTest() - Tests keys of packed integer columns
+ */
+void CompactKeyTest() {
+  dbg_printf("========== Compact Key Test ==========\n");
+  
+  using KeyType = CompactIntsKey<2>;
+  using CompactTable = HashTable_CA_SCC<KeyType,
+                                        uint64_t,
+                                        CompactIntsKeyHasher<2>>;
+  
+  CompactTable ht{};
+  
+  for(uint64_t i = 0;i < 10000;i++) {
+    assert(ht.Insert(KeyType{{i, i * 2}}, i) == true);
+  }
+  
+  for(uint64_t i = 0;i < 10000;i++) {
+    assert(*ht.GetFirstValue(KeyType{{i, i * 2}}) == i);
+    assert(ht.GetFirstValue(KeyType{{i * 2, i}}) == \
+           ((i == 0) ? ht.GetFirstValue(KeyType{{0, 0}}) : nullptr));
+  }
+  
+  return;
+}
+
+/*
+ * StringKeyTest() - Tests string keys copied into an arena
+ */
+void StringKeyTest() {
+  dbg_printf("========== String Key Test ==========\n");
+  
+  using StringTable = HashTable_CA_SCC<StringKey,
+                                       uint64_t,
+                                       StringKeyHasher,
+                                       StringKeyEqualityChecker>;
+  
+  StringArena arena{};
+  StringTable ht{};
+  
+  for(uint64_t i = 0;i < 10000;i++) {
+    std::string s = "key-" + std::to_string(i);
+    StringKey key = StringKey::Get(arena.Copy(s.data(), s.size()), s.size());
+    
+    assert(ht.Insert(key, i) == true);
+  }
+  
+  for(uint64_t i = 0;i < 10000;i++) {
+    std::string s = "key-" + std::to_string(i);
+    
+    assert(*ht.GetFirstValue(StringKey::Get(s.data(), s.size())) == i);
+    
+    // Appending a digit gives the key of i * 10 which might not exist, and
+    // "key-00" is not the key of 0
+    s += "0";
+    uint64_t *value_p = ht.GetFirstValue(StringKey::Get(s.data(), s.size()));
+    if((i > 0) && (i < 1000)) {
+      assert(*value_p == i * 10);
+    } else {
+      assert(value_p == nullptr);
+    }
+  }
+  
+  return;
+}
+
 int main() {
   BasicTest();
+  IteratorTest<HashTable>();
+  InterleavedLookupTest();
+  MergeTest();
+  MoveCloneTest<HashTable>();
+  ResizeEventTest();
+  ChainStatsTest<HashTable,
+                 HashTable_CA_SCC<uint64_t, uint64_t, ConstantZero>>(
+    "HashTable_CA_SCC");
+  SelfOrganizingTest();
+  TreeifyTest();
+  CompactTest();
+  MemoryBudgetTest();
+  HashValueTest();
+  KeyCompareTest<CountingTable>();
+  FirstValueCompareTest();
+  CompactKeyTest();
+  StringKeyTest();
   
   return 0;
 }
@@ -0,0 +1,313 @@
+
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Test bodies shared by HashTable_CA_CC_test.cpp and HashTable_CA_SCC_test.cpp
+ *
+ * HashTable is a table of uint64_t keys and values hashed by
+ * SimpleInt64Hasher. This file must be included after the table header,
+ * which brings in common.h. Engine specific assertions stay in the test
+ * files
+ */
+
+namespace peloton {
+namespace index {
+
+/*
+ * class CountingEqualityChecker - Counts comparisons of uint64_t keys
+ */
+class CountingEqualityChecker {
+ public:
+  static uint64_t compare_count;
+  
+  inline bool operator()(uint64_t key1, uint64_t key2) const {
+    compare_count++;
+    
+    return key1 == key2;
+  }
+};
+
+uint64_t CountingEqualityChecker::compare_count = 0;
+
+/*
+ * IteratorTest() - Tests forward iterators and range-for
+ */
+template <typename HashTable>
+void IteratorTest() {
+  dbg_printf("========== Iterator Test ==========\n");
+  
+  HashTable ht{30};
+  
+  // Empty table must have begin() == end()
+  assert(ht.begin() == ht.end());
+  
+  for(uint64_t i = 0;i < 1000;i++) {
+    ht.Insert(i, i);
+  }
+  
+  // Duplicated keys are stored as separate entries
+  ht.Insert(0, 1000);
+  
+  // Range-for on the mutable table could modify values
+  for(auto &kv_pair : ht) {
+    kv_pair.second += 1;
+  }
+  
+  const HashTable &const_ht = ht;
+  uint64_t sum = 0;
+  for(const auto &kv_pair : const_ht) {
+    assert(kv_pair.second >= kv_pair.first + 1);
+    sum += kv_pair.second;
+  }
+  
+  // 1 + 2 + ... + 1000 plus the duplicated one
+  assert(sum == 1000 * 1001 / 2 + 1001);
+  
+  // STL algorithms work with forward iterators
+  assert(std::distance(ht.cbegin(), ht.cend()) == 1001);
+  assert(std::count_if(ht.begin(), ht.end(),
+                       [](const std::pair<uint64_t, uint64_t> &kv_pair) {
+                         return kv_pair.first == 0;
+                       }) == 2);
+  
+  uint64_t key_sum = 0;
+  std::for_each(ht.cbegin(), ht.cend(),
+                [&key_sum](const std::pair<uint64_t, uint64_t> &kv_pair) {
+                  key_sum += kv_pair.first;
+                });
+  assert(key_sum == 999 * 1000 / 2);
+  
+  // Keys could not be modified through either iterator
+  static_assert(std::is_const<typename std::remove_reference<
+                  decltype(ht.begin()->first)>::type>::value,
+                "Key must be const through iterator");
+  static_assert(std::is_const<typename std::remove_reference<
+                  decltype(*ht.begin())>::type>::value == false,
+                "Value must be mutable through iterator");
+  
+  // iterator could be converted to const_iterator
+  typename HashTable::const_iterator it = ht.begin();
+  assert(it == ht.cbegin());
+  assert(it->first == (*it).first);
+  
+  return;
+}
+
+/*
+ * MoveCloneTest() - Tests move, swap and clone
+ */
+template <typename HashTable>
+void MoveCloneTest() {
+  dbg_printf("========== Move Clone Test ==========\n");
+  
+  // Tables could be stored in a vector since they are movable
+  std::vector<HashTable> table_list{};
+  for(uint64_t t = 0;t < 4;t++) {
+    HashTable ht{30};
+    for(uint64_t i = 0;i < 1000;i++) {
+      ht.Insert(i, i + t);
+    }
+    
+    table_list.push_back(std::move(ht));
+  }
+  
+  table_list[0].Swap(table_list[1]);
+  
+  HashTable clone = table_list[0].Clone();
+  table_list[0] = std::move(table_list[2]);
+  
+  // Insert after move and swap to check that the tables are intact
+  for(uint64_t i = 1000;i < 2000;i++) {
+    table_list[0].Insert(i, i + 2);
+    table_list[1].Insert(i, i);
+    clone.Insert(i, i + 1);
+  }
+  
+  for(uint64_t i = 0;i < 2000;i++) {
+    for(uint64_t t = 0;t < 2;t++) {
+      std::vector<uint64_t> v{};
+      table_list[t].GetValue(i, &v);
+      
+      assert(v.size() == 1);
+      assert(v[0] == i + 2 - 2 * t);
+    }
+    
+    std::vector<uint64_t> v{};
+    clone.GetValue(i, &v);
+    
+    assert(v.size() == 1);
+    assert(v[0] == i + 1);
+  }
+  
+  assert(std::distance(clone.begin(), clone.end()) == 2000);
+  
+  return;
+}
+
+/*
+ * ChainStatsTest() - Tests chain length and duplicate key statistics
+ *
+ * ZeroHashTable is the same table hashing every key by ConstantZero
+ */
+template <typename HashTable, typename ZeroHashTable>
+void ChainStatsTest(const char *table_name) {
+  dbg_printf("========== Chain Stats Test ==========\n");
+  
+  HashTable ht{30};
+  
+  // Key i has (i % 3) + 1 values
+  uint64_t entry_count = 0;
+  for(uint64_t i = 0;i < 1000;i++) {
+    for(uint64_t j = 0;j <= i % 3;j++) {
+      ht.Insert(i, j);
+      entry_count++;
+    }
+  }
+  
+  ChainStats chain_stats = ht.GetChainStats();
+  chain_stats.Print(table_name);
+  fflush(stdout);
+  
+  assert(chain_stats.entry_count == entry_count);
+  assert(chain_stats.key_count == 1000);
+  assert(chain_stats.max_duplicate_count == 3);
+  assert(chain_stats.duplicate_histogram[1] == 334);
+  assert(chain_stats.duplicate_histogram[2] == 333);
+  assert(chain_stats.duplicate_histogram[3] == 333);
+  
+  uint64_t slot_count = 0;
+  uint64_t chain_entry_count = 0;
+  for(uint64_t i = 0;i < ChainStats::HISTOGRAM_SIZE;i++) {
+    slot_count += chain_stats.chain_histogram[i];
+    chain_entry_count += i * chain_stats.chain_histogram[i];
+  }
+  
+  assert(slot_count == chain_stats.slot_count);
+  
+  // The last bucket also counts longer chains
+  if(chain_stats.max_chain_length < ChainStats::HISTOGRAM_SIZE - 1) {
+    assert(chain_entry_count == entry_count);
+  } else {
+    assert(chain_entry_count < entry_count);
+  }
+  
+  assert(chain_stats.chain_histogram[0] == chain_stats.empty_slot_count);
+  assert(chain_stats.max_chain_length >= 3);
+  assert(chain_stats.GetMeanChainLength() >= 1.0);
+  
+  // All keys on a single chain
+  ZeroHashTable zero_ht{30};
+  for(uint64_t i = 0;i < 100;i++) {
+    zero_ht.Insert(i % 10, i);
+  }
+  
+  chain_stats = zero_ht.GetChainStats();
+  
+  assert(chain_stats.max_chain_length == 100);
+  assert(chain_stats.empty_slot_count == chain_stats.slot_count - 1);
+  assert(chain_stats.key_count == 10);
+  assert(chain_stats.duplicate_histogram[10] == 10);
+  assert(chain_stats.GetMeanDuplicateCount() == 10.0);
+  
+  return;
+}
+
+/*
+ * FillToMemoryBudget() - Inserts keys 0, 1, ... until an insert is refused
+ *                        and returns the refused key
+ *
+ * The table must be empty and use the budget
+ */
+template <typename HashTable>
+uint64_t FillToMemoryBudget(HashTable *ht_p, MemoryBudget *budget_p) {
+  assert(budget_p->GetUsedSize() == ht_p->GetMemorySize());
+  
+  uint64_t key = 0;
+  while(ht_p->Insert(key, key) == true) {
+    key++;
+  }
+  
+  assert(key > 0);
+  assert(budget_p->GetUsedSize() == ht_p->GetMemorySize());
+  assert(budget_p->GetUsedSize() <= budget_p->GetLimit());
+  
+  std::vector<uint64_t> v{};
+  ht_p->GetValue(key, &v);
+  assert(v.size() == 0);
+  
+  return key;
+}
+
+/*
+ * FillWithHashValue() - Inserts keys 0 to key_num - 1 mapped to themselves,
+ *                       half of them with hash values computed by the
+ *                       caller, and checks them with GetValueWithHash()
+ */
+template <typename HashTable>
+void FillWithHashValue(HashTable *ht_p, uint64_t key_num) {
+  SimpleInt64Hasher hasher{};
+  
+  for(uint64_t i = 0;i < key_num;i++) {
+    if(i % 2 == 0) {
+      assert(ht_p->InsertWithHash(i, hasher(i), i) == true);
+    } else {
+      assert(ht_p->Insert(i, i) == true);
+    }
+  }
+  
+  for(uint64_t i = 0;i < key_num;i++) {
+    uint64_t count = 0;
+    ht_p->GetValueWithHash(i,
+                           hasher(i),
+                           [i, &count](const std::pair<uint64_t, uint64_t> &kv) {
+                             assert(kv.first == i);
+                             assert(kv.second == i);
+                             count++;
+                           });
+    assert(count == 1);
+  }
+  
+  return;
+}
+
+/*
+ * KeyCompareTest() - Tests that keys are only compared on entries whose hash
+ *                    value matches
+ *
+ * CountingHashTable is the same table comparing keys by
+ * CountingEqualityChecker. It starts small such that chains are long
+ */
+template <typename CountingHashTable>
+void KeyCompareTest() {
+  dbg_printf("========== Key Compare Test ==========\n");
+  
+  const uint64_t key_num = 10000;
+  
+  CountingHashTable ht{30};
+  for(uint64_t i = 0;i < key_num;i++) {
+    ht.Insert(i, i);
+  }
+  
+  CountingEqualityChecker::compare_count = 0;
+  
+  for(uint64_t i = 0;i < 2 * key_num;i++) {
+    std::vector<uint64_t> v{};
+    ht.GetValue(i, &v);
+    
+    assert(v.size() == ((i < key_num) ? 1 : 0));
+  }
+  
+  // One comparison for each key found, and none for missing keys
+  assert(CountingEqualityChecker::compare_count == key_num);
+  
+  return;
+}
+
+} // namespace index
+} // namespace peloton
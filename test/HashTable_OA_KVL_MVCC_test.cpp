@@ -0,0 +1,190 @@
+
+#include "../src/HashTable_OA_KVL_MVCC.h"
+
+using namespace peloton;
+using namespace index;
+
+using HashTable = HashTable_OA_KVL_MVCC<uint64_t, uint64_t, SimpleInt64Hasher>;
+
+/*
+ * VisibilityTest() - Tests that only versions visible at the read timestamp
+ *                    are returned
+ */
+void VisibilityTest() {
+  dbg_printf("========== Visibility Test ==========\n");
+
+  HashTable ht{};
+
+  // Key i has value i visible in [10, 20) and value i + 1 visible from 15.
+  // The second version is inserted with a hash value computed by the caller
+  SimpleInt64Hasher hasher{};
+  for(uint64_t i = 0;i < 1000;i++) {
+    assert(ht.Insert(i, i, 10) == true);
+    assert(ht.InsertWithHash(i, hasher(i), i + 1, 15) == true);
+
+    assert(ht.Retire(i, i, 20) == true);
+    // Already retired
+    assert(ht.Retire(i, i, 20) == false);
+    // Never inserted
+    assert(ht.Retire(i, i + 2, 20) == false);
+  }
+
+  for(uint64_t i = 0;i < 1000;i++) {
+    std::vector<uint64_t> v{};
+
+    ht.GetValue(i, 5, &v);
+    assert(v.size() == 0);
+
+    ht.GetValue(i, 10, &v);
+    assert(v.size() == 1);
+    assert(v[0] == i);
+
+    v.clear();
+    ht.GetValue(i, 17, &v);
+    assert(v.size() == 2);
+    assert(v[0] == i);
+    assert(v[1] == i + 1);
+
+    v.clear();
+    ht.GetValue(i, 20, &v);
+    assert(v.size() == 1);
+    assert(v[0] == i + 1);
+
+    v.clear();
+    ht.GetValueWithHash(i, hasher(i), 17, [&v](const uint64_t &value) {
+      v.push_back(value);
+    });
+    assert(v.size() == 2);
+  }
+
+  return;
+}
+
+/*
+ * GarbageCollectionTest() - Tests that dead versions are pruned on inserts
+ *                           and that versions visible to readers are kept
+ */
+void GarbageCollectionTest() {
+  dbg_printf("========== Garbage Collection Test ==========\n");
+
+  HashTable ht{};
+  static constexpr uint64_t key = 12345;
+
+  // Each update retires the previous version and inserts a new one
+  ht.Insert(key, 0, 0);
+  for(uint64_t ts = 1;ts < 1000;ts++) {
+    assert(ht.Retire(key, ts - 1, ts) == true);
+    ht.Insert(key, ts, ts);
+
+    // Readers lag behind the writer by 5 timestamps
+    if(ts >= 5) {
+      ht.SetGarbageCollectionTimestamp(ts - 5);
+    }
+
+    // Versions visible to the oldest reader must still be there
+    uint64_t gc_ts = ht.GetGarbageCollectionTimestamp();
+    std::vector<uint64_t> v{};
+    ht.GetValue(key, gc_ts, &v);
+    assert(v.size() == 1);
+    assert(v[0] == gc_ts);
+
+    v.clear();
+    ht.GetValue(key, ts, &v);
+    assert(v.size() == 1);
+    assert(v[0] == ts);
+  }
+
+  // Without pruning there would be 1000 versions
+  dbg_printf("Version count = %u\n", ht.GetVersionCount(key));
+  assert(ht.GetVersionCount(key) < 16);
+
+  // Inline values are also pruned
+  ht.Insert(key + 1, 0, 994);
+  assert(ht.Retire(key + 1, 0, 995) == true);
+  ht.SetGarbageCollectionTimestamp(995);
+  ht.Insert(key + 1, 1, 995);
+  assert(ht.GetVersionCount(key + 1) == 1);
+
+  return;
+}
+
+/*
+ * CloneTest() - Tests that a clone keeps versions and timestamps
+ */
+void CloneTest() {
+  dbg_printf("========== Clone Test ==========\n");
+
+  HashTable ht{};
+  for(uint64_t i = 0;i < 100;i++) {
+    ht.Insert(i, i, 10);
+    ht.Retire(i, i, 20);
+    ht.Insert(i, i + 1, 20);
+  }
+
+  HashTable clone = ht.Clone();
+  HashTable moved = std::move(ht);
+  for(uint64_t i = 0;i < 100;i++) {
+    std::vector<uint64_t> v{};
+    clone.GetValue(i, 15, &v);
+    moved.GetValue(i, 25, &v);
+
+    assert(v.size() == 2);
+    assert(v[0] == i);
+    assert(v[1] == i + 1);
+  }
+
+  return;
+}
+
+/*
+ * MemoryBudgetTest() - Tests that versions refused by the budget are
+ *                      reported and not inserted
+ */
+void MemoryBudgetTest() {
+  dbg_printf("========== Memory Budget Test ==========\n");
+
+  MemoryBudget budget{64 * 1024};
+
+  {
+    HashTable ht{};
+    ht.SetMemoryBudget(&budget);
+    assert(budget.GetUsedSize() == ht.GetMemorySize());
+
+    SimpleInt64Hasher hasher{};
+    uint64_t key = 0;
+    while(ht.InsertWithHash(key, hasher(key), key, 10) == true) {
+      key++;
+    }
+
+    assert(key > 0);
+    assert(budget.GetUsedSize() == ht.GetMemorySize());
+    assert(budget.GetUsedSize() <= budget.GetLimit());
+
+    std::vector<uint64_t> v{};
+    ht.GetValue(key, 10, &v);
+    assert(v.size() == 0);
+
+    // Without the budget the version is inserted
+    ht.SetMemoryBudget(nullptr);
+    assert(budget.GetUsedSize() == 0);
+    assert(ht.Insert(key, key, 10) == true);
+
+    ht.GetValue(key, 10, &v);
+    assert(v.size() == 1);
+
+    ht.SetMemoryBudget(&budget);
+  }
+
+  assert(budget.GetUsedSize() == 0);
+
+  return;
+}
+
+int main() {
+  VisibilityTest();
+  GarbageCollectionTest();
+  CloneTest();
+  MemoryBudgetTest();
+
+  return 0;
+}
@@ -0,0 +1,161 @@
+
+#include "../src/HashTable_OA_KVL_SWMR.h"
+#include <thread>
+#include <random>
+
+using namespace peloton;
+using namespace index;
+
+using HashTable = HashTable_OA_KVL_SWMR<uint64_t, uint64_t, SimpleInt64Hasher>;
+
+void BasicTest() {
+  dbg_printf("========== Basic Test ==========\n");
+
+  HashTable ht{};
+  uint64_t reader_id = ht.RegisterReader();
+
+  // Extra values are inserted with hash values computed by the caller
+  SimpleInt64Hasher hasher{};
+  for(uint64_t i = 0;i < 1000;i++) {
+    ht.Insert(i, i);
+
+    // Every other key has 10 values, which grows the key value list
+    // a few times
+    if(i % 2 == 0) {
+      for(uint64_t j = 1;j < 10;j++) {
+        ht.InsertWithHash(i, hasher(i), i + j);
+      }
+    }
+  }
+
+  for(uint64_t i = 0;i < 1000;i++) {
+    std::vector<uint64_t> v{};
+    ht.GetValue(reader_id, i, &v);
+
+    assert(v.size() == ((i % 2 == 0) ? 10 : 1));
+    for(uint64_t j = 0;j < v.size();j++) {
+      assert(v[j] == i + j);
+    }
+
+    uint64_t count = 0;
+    ht.GetValueWithHash(reader_id,
+                        i,
+                        hasher(i),
+                        [i, &count](const uint64_t &value) {
+                          assert(value == i + count);
+                          count++;
+                        });
+    assert(count == v.size());
+  }
+
+  // Delete half of the keys; Deleted entries are never reused
+  for(uint64_t i = 0;i < 1000;i += 2) {
+    assert(ht.DeleteKey(i) == true);
+    assert(ht.DeleteKey(i) == false);
+  }
+
+  for(uint64_t i = 0;i < 1000;i++) {
+    std::vector<uint64_t> v{};
+    ht.GetValue(reader_id, i, &v);
+
+    assert(v.size() == ((i % 2 == 0) ? 0 : 1));
+  }
+
+  // Inserting more keys cleans up deleted entries on resize
+  for(uint64_t i = 1000;i < 3000;i++) {
+    ht.Insert(i, i);
+  }
+
+  for(uint64_t i = 1;i < 3000;i += 2) {
+    std::vector<uint64_t> v{};
+    ht.GetValue(reader_id, i, &v);
+
+    assert(v.size() == 1);
+    assert(v[0] == i);
+  }
+
+  ht.UnregisterReader(reader_id);
+
+  return;
+}
+
+/*
+ * ConcurrentTest() - One writer inserts keys while readers read keys that
+ *                    are known to have been inserted
+ *
+ * Key i is mapped to values i, i + 1, ..., i + (i % 8), and the writer
+ * publishes the number of keys that have all their values inserted
+ */
+void ConcurrentTest() {
+  dbg_printf("========== Concurrent Test ==========\n");
+
+  static constexpr uint64_t key_num = 200000;
+  static constexpr int reader_num = 4;
+
+  // Start small to trigger many resizes while readers are active
+  HashTable ht{};
+  std::atomic<uint64_t> finished_key_count{0};
+
+  std::thread writer{[&ht, &finished_key_count]() {
+    for(uint64_t i = 0;i < key_num;i++) {
+      for(uint64_t j = 0;j <= i % 8;j++) {
+        ht.Insert(i, i + j);
+      }
+
+      finished_key_count.store(i + 1, std::memory_order_release);
+    }
+  }};
+
+  std::vector<std::thread> reader_list{};
+  for(int t = 0;t < reader_num;t++) {
+    reader_list.emplace_back([&ht, &finished_key_count, t]() {
+      uint64_t reader_id = ht.RegisterReader();
+      std::default_random_engine e{static_cast<unsigned>(t)};
+
+      uint64_t finished = 0;
+      while(finished < key_num) {
+        finished = finished_key_count.load(std::memory_order_acquire);
+        if(finished == 0) {
+          continue;
+        }
+
+        std::uniform_int_distribution<uint64_t> dist{0, finished - 1};
+        uint64_t key = dist(e);
+
+        std::vector<uint64_t> v{};
+        ht.GetValue(reader_id, key, &v);
+
+        // All values of the key have been inserted
+        assert(v.size() == key % 8 + 1);
+        for(uint64_t j = 0;j < v.size();j++) {
+          assert(v[j] == key + j);
+        }
+
+        // A key that is being inserted could have a prefix of values
+        v.clear();
+        ht.GetValue(reader_id, finished, &v);
+        for(uint64_t j = 0;j < v.size();j++) {
+          assert(v[j] == finished + j);
+        }
+      }
+
+      ht.UnregisterReader(reader_id);
+    });
+  }
+
+  writer.join();
+  for(std::thread &t : reader_list) {
+    t.join();
+  }
+
+  dbg_printf("Final table size = %lu\n", ht.GetEntryCount());
+
+  return;
+}
+
+int main() {
+  BasicTest();
+  ConcurrentTest();
+
+  return 0;
+}
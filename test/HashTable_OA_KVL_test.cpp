@@ -1,5 +1,10 @@
 
 #include "../src/HashTable_OA_KVL.h"
+#include "../src/StringArena.h"
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <string>
 
 using namespace peloton;
 using namespace index;
@@ -127,11 +132,1366 @@ void DeleteTest2() {
   }
 }
 
+void StandardIteratorTest() {
+  dbg_printf("========== Standard Iterator Test ==========\n");
+  
+  HashTable ht{};
+  
+  // Empty table must have begin() == end()
+  assert(ht.begin() == ht.end());
+  assert(ht.cbegin() == ht.cend());
+  
+  for(uint64_t i = 0;i < 100;i++) {
+    ht.Insert(i, i);
+    
+    // Every even key has two values to exercise KVL
+    if(i % 2 == 0) {
+      ht.Insert(i, i + 1000);
+    }
+  }
+  
+  // Range-for yields a mutable reference to values
+  for(auto &value : ht) {
+    value += 1;
+  }
+  
+  const HashTable &const_ht = ht;
+  uint64_t count = 0;
+  for(HashTable::const_iterator it = const_ht.begin();it != const_ht.end();it++) {
+    // Values are either key + 1 or key + 1001
+    assert((*it == it.GetKey() + 1) || (*it == it.GetKey() + 1001));
+    count++;
+  }
+  
+  assert(count == 150);
+  
+  // STL algorithms work with forward iterators
+  assert(std::distance(ht.cbegin(), ht.cend()) == 150);
+  assert(std::count_if(ht.begin(), ht.end(),
+                       [](uint64_t value) { return value > 1000; }) == 50);
+  
+  uint64_t sum = std::accumulate(const_ht.begin(), const_ht.end(), 0UL);
+  assert(sum == (100 * 101 / 2) + (50 * 1001 + 49 * 50));
+  
+  // iterator could be converted to const_iterator
+  HashTable::const_iterator it = ht.Begin(3);
+  assert(it != ht.cend());
+  assert(*it.operator->() == 4);
+  
+  return;
+}
+
+void InterleavedLookupTest() {
+  dbg_printf("========== Interleaved Lookup Test ==========\n");
+  
+  // ConstantZero makes every probe sequence long, which exercises
+  // suspension on cache line boundaries
+  HashTable ht{};
+  
+  for(uint64_t i = 0;i < 200;i++) {
+    ht.Insert(i, i);
+    
+    // Every third key has multiple values to exercise KVL
+    if(i % 3 == 0) {
+      ht.Insert(i, i + 1000);
+      ht.Insert(i, i + 2000);
+    }
+  }
+  
+  // Keys in [200, 250) do not exist
+  std::vector<uint64_t> key_list{};
+  for(uint64_t i = 0;i < 250;i++) {
+    key_list.push_back((i * 7) % 250);
+  }
+  
+  std::vector<int> visited(key_list.size(), 0);
+  
+  ht.GetValueInterleaved(key_list.data(),
+                         key_list.size(),
+                         [&](uint64_t key_index,
+                             std::pair<uint64_t *, uint32_t> ret) {
+    visited[key_index]++;
+    
+    // Must be identical to what GetValue() returns
+    assert(ret == ht.GetValue(key_list[key_index]));
+    if(key_list[key_index] >= 200) {
+      assert(ret.first == nullptr);
+    } else {
+      assert(ret.second == ((key_list[key_index] % 3 == 0) ? 3U : 1U));
+    }
+  });
+  
+  // Also test a group larger than the number of keys
+  ht.GetValueInterleaved<512>(key_list.data(),
+                              key_list.size(),
+                              [&](uint64_t key_index,
+                                  std::pair<uint64_t *, uint32_t> ret) {
+    visited[key_index]++;
+    assert(ret == ht.GetValue(key_list[key_index]));
+  });
+  
+  for(int count : visited) {
+    assert(count == 2);
+  }
+  
+  return;
+}
+
+/*
+ * PackedValueTest() - Tests storing packed 48 bit tuple locations as values
+ */
+void PackedValueTest() {
+  dbg_printf("========== Packed Value Test ==========\n");
+  
+  static_assert(sizeof(TuplePointer48) == 6,
+                "Packed tuple location must take 6 bytes");
+  
+  HashTable_OA_KVL<uint64_t, TuplePointer48, SimpleInt64Hasher> ht{};
+  
+  // Key i has (i % 16 + 1) values with block IDs close to the 32 bit
+  // maximum to test that all 48 bits are kept
+  for(uint64_t i = 0;i < 1000;i++) {
+    for(uint64_t j = 0;j <= i % 16;j++) {
+      ht.Insert(i, TuplePointer48::Get(0xFFFFFFF0 + j,
+                                       static_cast<uint16_t>(i)));
+    }
+  }
+  
+  for(uint64_t i = 0;i < 1000;i++) {
+    auto ret = ht.GetValue(i);
+    assert(ret.second == i % 16 + 1);
+    
+    std::vector<uint64_t> decoded(ret.second);
+    DecodeTuplePointers(ret.first, ret.second, decoded.data());
+    
+    for(uint64_t j = 0;j < ret.second;j++) {
+      assert(ret.first[j].GetBlock() == 0xFFFFFFF0 + j);
+      assert(ret.first[j].GetOffset() == static_cast<uint16_t>(i));
+      assert(decoded[j] == ((0xFFFFFFF0 + j) << 16 | i));
+      assert(TuplePointer48::FromUInt64(decoded[j]) == ret.first[j]);
+    }
+  }
+  
+  // An empty run does not touch either array
+  DecodeTuplePointers(nullptr, 0, nullptr);
+  
+  return;
+}
+
+/*
+ * DeleteIfTest() - Tests erasing while iterating and bulk deletion by
+ *                  predicate
+ */
+void DeleteIfTest() {
+  dbg_printf("========== DeleteIf Test ==========\n");
+  
+  HashTable_OA_KVL<uint64_t, uint64_t, SimpleInt64Hasher> ht{};
+  
+  // Key i has values i * 10, i * 10 + 1, ..., i * 10 + i % 5
+  for(uint64_t i = 0;i < 1000;i++) {
+    for(uint64_t j = 0;j <= i % 5;j++) {
+      ht.Insert(i, i * 10 + j);
+    }
+  }
+  
+  // Erase odd values while iterating
+  uint64_t value_count = 0;
+  auto it = ht.begin();
+  while(it != ht.end()) {
+    if(*it % 2 == 1) {
+      it = ht.Delete(it);
+    } else {
+      ++it;
+      value_count++;
+    }
+  }
+  
+  assert(value_count ==
+         static_cast<uint64_t>(std::distance(ht.begin(), ht.end())));
+  for(uint64_t value : ht) {
+    assert(value % 2 == 0);
+  }
+  
+  // Remove all values of keys divisible by 3, and the value i * 10 + 2
+  // of other keys
+  uint64_t deleted_count = \
+    ht.DeleteIf([](const uint64_t &key, const uint64_t &value) {
+      return (key % 3 == 0) || (value == key * 10 + 2);
+    });
+  
+  assert(ht.GetDeletedEntryCount() == 0);
+  assert(value_count - deleted_count == \
+         static_cast<uint64_t>(std::distance(ht.begin(), ht.end())));
+  
+  for(uint64_t i = 0;i < 1000;i++) {
+    auto ret = ht.GetValue(i);
+    
+    if(i % 3 == 0) {
+      assert(ret.second == 0);
+      continue;
+    }
+    
+    // Remaining values are i * 10 and i * 10 + 4 in their original order
+    uint64_t expected_count = 1 + ((i % 5 == 4) ? 1 : 0);
+    assert(ret.second == expected_count);
+    assert(ret.first[0] == i * 10);
+    if(expected_count == 2) {
+      assert(ret.first[1] == i * 10 + 4);
+    }
+  }
+  
+  return;
+}
+
+/*
+ * MergeTest() - Tests merging tables with overlapping and disjoint keys
+ */
+void MergeTest() {
+  dbg_printf("========== Merge Test ==========\n");
+  
+  using MergeTable = HashTable_OA_KVL<uint64_t, uint64_t, SimpleInt64Hasher>;
+  
+  // Keys [0, 1000) in ht1 and keys [500, 1500) in ht2; Keys divisible by 4
+  // have a key value list in ht2
+  MergeTable ht1{};
+  MergeTable ht2{};
+  for(uint64_t i = 0;i < 1000;i++) {
+    ht1.Insert(i, i);
+  }
+  
+  for(uint64_t i = 500;i < 1500;i++) {
+    ht2.Insert(i, i + 1);
+    if(i % 4 == 0) {
+      ht2.Insert(i, i + 2);
+    }
+  }
+  
+  // Leave a few tombstones in the destination
+  for(uint64_t i = 0;i < 100;i++) {
+    ht1.DeleteKey(i);
+  }
+  
+  ht1.Merge(std::move(ht2));
+  
+  assert(ht2.begin() == ht2.end());
+  for(uint64_t i = 0;i < 1500;i++) {
+    auto ret = ht1.GetValue(i);
+    
+    std::vector<uint64_t> expected{};
+    if(i >= 100 && i < 1000) {
+      expected.push_back(i);
+    }
+    
+    if(i >= 500) {
+      expected.push_back(i + 1);
+      if(i % 4 == 0) {
+        expected.push_back(i + 2);
+      }
+    }
+    
+    assert(ret.second == expected.size());
+    for(uint32_t j = 0;j < ret.second;j++) {
+      assert(ret.first[j] == expected[j]);
+    }
+  }
+  
+  // The source table could be reused after the merge
+  MergeTable ht3{};
+  for(uint64_t i = 1500;i < 2000;i++) {
+    ht2.Insert(i, i);
+    ht3.Insert(i + 500, i);
+    ht3.Insert(i + 500, i + 1);
+  }
+  
+  ht1.MergeDisjoint(std::move(ht2));
+  ht1.MergeDisjoint(std::move(ht3));
+  for(uint64_t i = 1500;i < 2000;i++) {
+    assert(ht1.GetValue(i).second == 1);
+    assert(*ht1.GetFirstValue(i) == i);
+    assert(ht1.GetValue(i + 500).second == 2);
+  }
+  
+  return;
+}
+
+/*
+ * MoveCloneTest() - Tests move, swap and clone
+ */
+void MoveCloneTest() {
+  dbg_printf("========== Move Clone Test ==========\n");
+  
+  using MoveTable = HashTable_OA_KVL<uint64_t, uint64_t, SimpleInt64Hasher>;
+  
+  // Tables could be stored in a vector since they are movable
+  std::vector<MoveTable> table_list{};
+  for(uint64_t t = 0;t < 4;t++) {
+    MoveTable ht{};
+    for(uint64_t i = 0;i < 1000;i++) {
+      ht.Insert(i, i + t);
+      if(i % 2 == 0) {
+        ht.Insert(i, i + t + 1);
+      }
+    }
+    
+    table_list.push_back(std::move(ht));
+  }
+  
+  table_list[0].Swap(table_list[1]);
+  
+  MoveTable clone = table_list[0].Clone();
+  table_list[0].DeleteIf([](const uint64_t &, const uint64_t &) {
+    return true;
+  });
+  
+  assert(table_list[0].begin() == table_list[0].end());
+  for(uint64_t i = 0;i < 1000;i++) {
+    auto ret = clone.GetValue(i);
+    
+    assert(ret.second == ((i % 2 == 0) ? 2 : 1));
+    assert(ret.first[0] == i + 1);
+    
+    ret = table_list[1].GetValue(i);
+    assert(ret.first[0] == i);
+  }
+  
+  // Non-trivially copyable values are copied element-wise
+  HashTable_OA_KVL<uint64_t, std::string, SimpleInt64Hasher> string_ht{};
+  for(uint64_t i = 0;i < 100;i++) {
+    for(uint64_t j = 0;j <= i % 3;j++) {
+      string_ht.Insert(i, std::to_string(i * 10 + j));
+    }
+  }
+  
+  string_ht.DeleteKey(50);
+  
+  auto string_clone = string_ht.Clone();
+  string_ht = std::move(string_clone);
+  string_clone = string_ht.Clone();
+  
+  for(uint64_t i = 0;i < 100;i++) {
+    auto ret = string_clone.GetValue(i);
+    if(i == 50) {
+      assert(ret.second == 0);
+      continue;
+    }
+    
+    assert(ret.second == i % 3 + 1);
+    for(uint32_t j = 0;j < ret.second;j++) {
+      assert(ret.first[j] == std::to_string(i * 10 + j));
+    }
+  }
+  
+  return;
+}
+
+/*
+ * StatsTest() - Tests operation counters
+ */
+void StatsTest() {
+  dbg_printf("========== Stats Test ==========\n");
+  
+  HashTable_OA_KVL<uint64_t,
+                   uint64_t,
+                   SimpleInt64Hasher,
+                   std::equal_to<uint64_t>,
+                   LoadFactorHalfFull,
+                   CountingStats> ht{};
+  
+  for(uint64_t i = 0;i < 1000;i++) {
+    ht.Insert(i, i);
+    if(i % 2 == 0) {
+      ht.Insert(i, i + 1);
+    }
+  }
+  
+  for(uint64_t i = 0;i < 2000;i++) {
+    ht.GetValue(i);
+  }
+  
+  OperationStatsSnapshot snapshot = ht.GetStats();
+  snapshot.Print("OA_KVL");
+  
+  assert(snapshot.Get(StatsCounter::INSERT) == 1500);
+  assert(snapshot.Get(StatsCounter::LOOKUP) == 2000);
+  assert(snapshot.Get(StatsCounter::KVL_GROW) >= 500);
+  assert(snapshot.Get(StatsCounter::RESIZE) > 0);
+  assert(snapshot.Get(StatsCounter::PROBE) >= 3500);
+  assert(snapshot.Get(StatsCounter::CHAIN_WALK) == 0);
+  assert(snapshot.GetPerLookup(StatsCounter::PROBE) >= 1.0);
+  
+  // Clones start with fresh counters
+  auto clone = ht.Clone();
+  assert(clone.GetStats().Get(StatsCounter::INSERT) == 0);
+  
+  ht.ResetStats();
+  snapshot = ht.GetStats();
+  for(uint64_t i = 0;
+      i < static_cast<uint64_t>(StatsCounter::COUNTER_COUNT);
+      i++) {
+    assert(snapshot.counter_list[i] == 0);
+  }
+  
+  // The default policy does not count
+  HashTable_OA_KVL<uint64_t, uint64_t, SimpleInt64Hasher> no_stats_ht{};
+  no_stats_ht.Insert(1, 1);
+  no_stats_ht.GetValue(1);
+  assert(no_stats_ht.GetStats().Get(StatsCounter::INSERT) == 0);
+  
+  return;
+}
+
+/*
+ * class RecordingListener - Records the events received for testing
+ */
+class RecordingListener : public TableEventListener {
+ public:
+  std::vector<ResizeEvent> resize_begin_list;
+  std::vector<ResizeEvent> resize_end_list;
+  std::vector<KVLGrowEvent> kvl_grow_list;
+  std::vector<TombstoneEvent> tombstone_list;
+  
+  RecordingListener(uint32_t p_kvl_grow_threshold, double p_tombstone_ratio) :
+    TableEventListener{p_kvl_grow_threshold, p_tombstone_ratio} {
+    return;
+  }
+  
+  void OnResizeBegin(const ResizeEvent &event) override {
+    resize_begin_list.push_back(event);
+  }
+  
+  void OnResizeEnd(const ResizeEvent &event) override {
+    resize_end_list.push_back(event);
+  }
+  
+  void OnKVLGrow(const KVLGrowEvent &event) override {
+    kvl_grow_list.push_back(event);
+  }
+  
+  void OnTombstoneThreshold(const TombstoneEvent &event) override {
+    tombstone_list.push_back(event);
+  }
+};
+
+/*
+ * EventTest() - Tests resize, KVL growth and tombstone events
+ */
+void EventTest() {
+  dbg_printf("========== Event Test ==========\n");
+  
+  using EventTable = HashTable_OA_KVL<uint64_t, uint64_t, SimpleInt64Hasher>;
+  
+  RecordingListener listener{8, 0.25};
+  EventTable ht{};
+  ht.SetEventListener(&listener);
+  
+  uint64_t init_entry_count = ht.GetEntryCount();
+  for(uint64_t i = 0;i < 1000;i++) {
+    ht.Insert(i, i);
+  }
+  
+  assert(listener.resize_begin_list.size() > 0);
+  assert(listener.resize_begin_list.size() == listener.resize_end_list.size());
+  
+  // Each resize doubles the table and moves all keys
+  uint64_t capacity = init_entry_count;
+  for(size_t i = 0;i < listener.resize_end_list.size();i++) {
+    const ResizeEvent &event = listener.resize_end_list[i];
+    
+    assert(event.old_capacity == capacity);
+    assert(event.new_capacity == capacity * 2);
+    assert(event.element_count == listener.resize_begin_list[i].element_count);
+    assert(event.tombstone_count == 0);
+    assert(listener.resize_begin_list[i].duration_ns == 0);
+    
+    capacity = event.new_capacity;
+  }
+  
+  assert(capacity == ht.GetEntryCount());
+  
+  // Only growth to at least 8 values is reported: 1 -> 4 is not
+  for(uint64_t i = 0;i < 12;i++) {
+    ht.Insert(5, i);
+  }
+  
+  assert(listener.kvl_grow_list.size() == 2);
+  assert(listener.kvl_grow_list[0].old_capacity == 4);
+  assert(listener.kvl_grow_list[0].new_capacity == 8);
+  assert(listener.kvl_grow_list[0].value_count == 4);
+  assert(listener.kvl_grow_list[1].new_capacity == 16);
+  
+  // Tombstone event fires once on crossing a quarter of the capacity
+  uint64_t threshold = ht.GetEntryCount() / 4;
+  for(uint64_t i = 0;i < threshold + 10;i++) {
+    assert(ht.DeleteKey(i) == true);
+  }
+  
+  assert(listener.tombstone_list.size() == 1);
+  assert(listener.tombstone_list[0].tombstone_count == threshold);
+  assert(listener.tombstone_list[0].capacity == ht.GetEntryCount());
+  assert(ht.GetDeletedEntryCount() == threshold + 10);
+  
+  // Reinserting reuses tombstones
+  uint64_t deleted_count = ht.GetDeletedEntryCount();
+  ht.Insert(0, 0);
+  assert(ht.GetDeletedEntryCount() <= deleted_count);
+  
+  // Removing tombstones reports a rehash of the same size
+  size_t resize_count = listener.resize_end_list.size();
+  ht.DeleteIf([](const uint64_t &key, const uint64_t &) {
+    return key == 999;
+  });
+  
+  assert(listener.resize_end_list.size() == resize_count + 1);
+  assert(listener.resize_end_list.back().old_capacity == \
+         listener.resize_end_list.back().new_capacity);
+  assert(listener.resize_end_list.back().tombstone_count > 0);
+  assert(ht.GetDeletedEntryCount() == 0);
+  assert(listener.tombstone_list.size() == 1);
+  
+  // No event after the listener is removed
+  ht.SetEventListener(nullptr);
+  for(uint64_t i = 1000;i < 3000;i++) {
+    ht.Insert(i, i);
+  }
+  
+  assert(listener.resize_end_list.size() == resize_count + 1);
+  
+  return;
+}
+
+/*
+ * MemoryBudgetTest() - Tests that array and KVL growth are refused when the
+ *                      budget is exhausted, and that memory is released
+ */
+void MemoryBudgetTest() {
+  dbg_printf("========== Memory Budget Test ==========\n");
+  
+  using BudgetTable = HashTable_OA_KVL<uint64_t, uint64_t, SimpleInt64Hasher>;
+  
+  MemoryBudget budget{64 * 1024};
+  
+  {
+    BudgetTable ht{};
+    ht.SetMemoryBudget(&budget);
+    assert(budget.GetUsedSize() == ht.GetArrayMemorySize());
+    
+    // Insert until the array could not grow
+    uint64_t key = 0;
+    while(ht.Insert(key, key) == true) {
+      key++;
+    }
+    
+    assert(key == ht.GetResizeThreshold());
+    assert(budget.GetUsedSize() == ht.GetMemorySize());
+    assert(budget.GetUsedSize() <= budget.GetLimit());
+    assert(ht.GetValue(key).second == 0);
+    
+    // Appending to an existing key allocates a KVL; Use up the budget with
+    // KVLs and check that a failed append leaves values unchanged
+    budget.SetLimit(budget.GetUsedSize() + 4096);
+    
+    uint64_t kvl_key = 0;
+    while(true) {
+      if(ht.Insert(kvl_key, kvl_key + 1) == false) {
+        break;
+      }
+      
+      kvl_key++;
+    }
+    
+    assert(kvl_key > 0);
+    assert(ht.GetValue(kvl_key).second == 1);
+    assert(ht.GetValue(kvl_key - 1).second == 2);
+    assert(budget.GetUsedSize() == ht.GetMemorySize());
+    
+    // Deleting keys with KVLs releases memory
+    uint64_t used_size = budget.GetUsedSize();
+    assert(ht.DeleteKey(0) == true);
+    assert(budget.GetUsedSize() < used_size);
+    assert(budget.GetUsedSize() == ht.GetMemorySize());
+    
+    // Moving the table keeps the budget
+    BudgetTable ht2{std::move(ht)};
+    assert(budget.GetUsedSize() == ht2.GetMemorySize());
+  }
+  
+  // All memory is released by the destructor
+  assert(budget.GetUsedSize() == 0);
+  
+  // The spill callback frees memory by destroying another table charged to
+  // the same budget
+  BudgetTable *victim_p = new BudgetTable{};
+  victim_p->SetMemoryBudget(&budget);
+  for(uint64_t i = 0;i < victim_p->GetResizeThreshold();i++) {
+    victim_p->Insert(i, i);
+  }
+  
+  int spill_count = 0;
+  MemoryBudget spilling_budget{64 * 1024, [&](uint64_t) {
+    if(victim_p == nullptr) {
+      return false;
+    }
+    
+    delete victim_p;
+    victim_p = nullptr;
+    spill_count++;
+    
+    return true;
+  }};
+  
+  victim_p->SetMemoryBudget(&spilling_budget);
+  assert(budget.GetUsedSize() == 0);
+  
+  BudgetTable ht{};
+  ht.SetMemoryBudget(&spilling_budget);
+  
+  uint64_t key = 0;
+  while(ht.Insert(key, key) == true) {
+    key++;
+  }
+  
+  assert(spill_count == 1);
+  assert(victim_p == nullptr);
+  assert(spilling_budget.GetUsedSize() == ht.GetMemorySize());
+  
+  // Merge is charged even beyond the limit
+  BudgetTable other{};
+  for(uint64_t i = 0;i < 10000;i++) {
+    other.Insert(key + i, i);
+    other.Insert(key + i, i + 1);
+  }
+  
+  ht.Merge(std::move(other));
+  assert(spilling_budget.GetUsedSize() == ht.GetMemorySize());
+  assert(spilling_budget.GetUsedSize() > spilling_budget.GetLimit());
+  
+  ht.SetMemoryBudget(nullptr);
+  assert(spilling_budget.GetUsedSize() == 0);
+  
+  return;
+}
+
+/*
+ * HashValueTest() - Tests functions taking a hash value computed by the
+ *                   caller, mixed with functions that hash the key
+ */
+void HashValueTest() {
+  dbg_printf("========== Hash Value Test ==========\n");
+  
+  using HashedTable = HashTable_OA_KVL<uint64_t, uint64_t, SimpleInt64Hasher>;
+  
+  const uint64_t key_num = 10000;
+  
+  SimpleInt64Hasher hasher{};
+  HashedTable ht{};
+  
+  // Enough keys to resize several times with hash values stored
+  for(uint64_t i = 0;i < key_num;i++) {
+    if(i % 2 == 0) {
+      assert(ht.InsertWithHash(i, hasher(i), i) == true);
+    } else {
+      assert(ht.Insert(i, i) == true);
+    }
+  }
+  
+  for(uint64_t i = 0;i < key_num;i += 3) {
+    assert(ht.InsertWithHash(i, hasher(i), i + 1) == true);
+  }
+  
+  for(uint64_t i = 0;i < key_num;i++) {
+    std::pair<uint64_t *, uint32_t> ret = ht.GetValueWithHash(i, hasher(i));
+    assert(ret == ht.GetValue(i));
+    assert(ret.second == ((i % 3 == 0) ? 2 : 1));
+    assert(ret.first[0] == i);
+    
+    assert(ht.GetFirstValueWithHash(i, hasher(i)) == ret.first);
+  }
+  
+  for(auto it = ht.begin();it != ht.end();++it) {
+    assert(it.GetHashValue() == hasher(it.GetKey()));
+  }
+  
+  assert(ht.DeleteKeyWithHash(0, hasher(0)) == true);
+  assert(ht.GetValue(0).second == 0);
+  assert(ht.DeleteKeyWithHash(0, hasher(0)) == false);
+  
+  // A hash function other than the one of the table (ConstantZero) works
+  // as long as it is used for all accesses
+  HashTable ht2{};
+  for(uint64_t i = 0;i < key_num;i++) {
+    ht2.InsertWithHash(i, i * 3, i);
+  }
+  
+  for(uint64_t i = 0;i < key_num;i++) {
+    assert(*ht2.GetFirstValueWithHash(i, i * 3) == i);
+  }
+  
+  // The predicate sees the stored hash, including for key value lists
+  uint64_t deleted_num = \
+    ht2.DeleteIfWithHash([](const uint64_t &key,
+                            uint64_t hash_value,
+                            const uint64_t &) {
+      assert(hash_value == key * 3);
+      
+      return hash_value % 2 == 0;
+    });
+  assert(deleted_num == key_num / 2);
+  
+  for(uint64_t i = 0;i < key_num;i++) {
+    assert((ht2.GetFirstValueWithHash(i, i * 3) == nullptr) == (i % 2 == 0));
+  }
+  
+  return;
+}
+
+/*
+ * class WideKey - Composite key of four integers
+ */
+class WideKey {
+ public:
+  uint64_t a;
+  uint64_t b;
+  uint64_t c;
+  uint64_t d;
+  
+  inline bool operator==(const WideKey &other) const {
+    return (a == other.a) && (b == other.b) && \
+           (c == other.c) && (d == other.d);
+  }
+};
+
+/*
+ * class WideKeyHasher - Combines hash values of all components
+ */
+class WideKeyHasher {
+ public:
+  inline uint64_t operator()(const WideKey &key) const {
+    SimpleInt64Hasher hasher{};
+    
+    return hasher(key.a ^ hasher(key.b ^ hasher(key.c ^ hasher(key.d))));
+  }
+};
+
+/*
+ * class WideTuple - A tuple that has the key inside
+ */
+class WideTuple {
+ public:
+  uint64_t id;
+  WideKey key;
+  char payload[64];
+};
+
+/*
+ * class WideTupleKeyExtractor - Returns the key of a WideTuple
+ */
+class WideTupleKeyExtractor {
+ public:
+  using KeyType = WideKey;
+  
+  inline const WideKey &operator()(const WideTuple &tuple) const {
+    return tuple.key;
+  }
+};
+
+/*
+ * class CountingWideKeyEqualityChecker - Counts comparisons of WideKey, i.e.
+ *                                        tuples read through references
+ */
+class CountingWideKeyEqualityChecker {
+ public:
+  static uint64_t compare_count;
+  
+  inline bool operator()(const WideKey &key1, const WideKey &key2) const {
+    compare_count++;
+    
+    return std::equal_to<WideKey>{}(key1, key2);
+  }
+};
+
+uint64_t CountingWideKeyEqualityChecker::compare_count = 0;
+
+/*
+ * ExternalKeyTest() - Tests a table storing tuple references as keys
+ */
+void ExternalKeyTest() {
+  dbg_printf("========== External Key Test ==========\n");
+  
+  using KeyRef = ExternalKey<WideTuple, WideTupleKeyExtractor>;
+  using RefTable = \
+    HashTable_OA_KVL<KeyRef,
+                     uint64_t,
+                     ExternalKeyHasher<WideTuple,
+                                       WideTupleKeyExtractor,
+                                       WideKeyHasher>,
+                     ExternalKeyEqualityChecker<WideTuple,
+                                                WideTupleKeyExtractor>>;
+  using CopyTable = HashTable_OA_KVL<WideKey,
+                                     uint64_t,
+                                     WideKeyHasher,
+                                     std::equal_to<WideKey>>;
+  
+  static_assert(sizeof(KeyRef) == sizeof(void *),
+                "Only the pointer is stored in entries");
+  
+  const uint64_t key_num = 10000;
+  
+  // Keys of tuple i and i + key_num are equal
+  std::vector<WideTuple> tuple_list(2 * key_num);
+  for(uint64_t i = 0;i < 2 * key_num;i++) {
+    uint64_t k = i % key_num;
+    tuple_list[i].id = i;
+    tuple_list[i].key = WideKey{k, k * 3, k * 5, k * 7};
+  }
+  
+  RefTable ht{};
+  CopyTable copy_ht{};
+  for(uint64_t i = 0;i < key_num;i++) {
+    assert(ht.Insert(KeyRef::FromTuple(&tuple_list[i]), i) == true);
+    assert(copy_ht.Insert(tuple_list[i].key, i) == true);
+  }
+  
+  // Tuples having equal keys are added to the same key
+  for(uint64_t i = key_num;i < 2 * key_num;i += 2) {
+    assert(ht.Insert(KeyRef::FromTuple(&tuple_list[i]), i) == true);
+  }
+  
+  dbg_printf("Memory size: %lu with references; %lu with copied keys\n",
+             ht.GetArrayMemorySize(),
+             copy_ht.GetArrayMemorySize());
+  
+  assert(ht.GetArrayMemorySize() < copy_ht.GetArrayMemorySize());
+  
+  for(uint64_t i = 0;i < key_num;i++) {
+    WideKey search_key = tuple_list[i].key;
+    std::pair<uint64_t *, uint32_t> ret = \
+      ht.GetValue(KeyRef::FromSearchKey(&search_key));
+    assert(ret.second == ((i % 2 == 0) ? 2 : 1));
+    assert(ret.first[0] == i);
+    
+    // Probing with another tuple having the same key
+    assert(ht.GetValue(KeyRef::FromTuple(&tuple_list[i + key_num])) == ret);
+  }
+  
+  // The stored reference is the tuple inserted first
+  for(auto it = ht.begin();it != ht.end();++it) {
+    const KeyRef &key = it.GetKey();
+    assert(key.IsSearchKey() == false);
+    assert(key.GetTuple()->id < key_num);
+    assert(key.GetTuple()->id == *it % key_num);
+  }
+  
+  WideKey missing_key{key_num, 0, 0, 0};
+  assert(ht.GetValue(KeyRef::FromSearchKey(&missing_key)).second == 0);
+  
+  for(uint64_t i = 0;i < key_num;i += 3) {
+    WideKey search_key = tuple_list[i].key;
+    assert(ht.DeleteKey(KeyRef::FromSearchKey(&search_key)) == true);
+  }
+  
+  for(uint64_t i = 0;i < key_num;i++) {
+    assert(ht.GetValue(KeyRef::FromTuple(&tuple_list[i])).second == \
+           ((i % 3 == 0) ? 0 : ((i % 2 == 0) ? 2 : 1)));
+  }
+  
+  // Tuples are only read on entries whose hash value matches
+  using CountingRefTable = \
+    HashTable_OA_KVL<KeyRef,
+                     uint64_t,
+                     ExternalKeyHasher<WideTuple,
+                                       WideTupleKeyExtractor,
+                                       WideKeyHasher>,
+                     ExternalKeyEqualityChecker<WideTuple,
+                                                WideTupleKeyExtractor,
+                                                CountingWideKeyEqualityChecker>>;
+  
+  CountingWideKeyEqualityChecker::compare_count = 0;
+  
+  CountingRefTable counting_ht{};
+  for(uint64_t i = 0;i < key_num;i++) {
+    assert(counting_ht.Insert(KeyRef::FromTuple(&tuple_list[i]), i) == true);
+  }
+  
+  assert(CountingWideKeyEqualityChecker::compare_count == 0);
+  
+  // Another tuple of the same key, so references are not the same
+  for(uint64_t i = 0;i < key_num;i++) {
+    assert(*counting_ht.GetFirstValue(
+      KeyRef::FromTuple(&tuple_list[i + key_num])) == i);
+  }
+  
+  assert(CountingWideKeyEqualityChecker::compare_count == key_num);
+  
+  return;
+}
+
+/*
+ * CompactKeyEqualityTest() - Checks that keys differing in any single column
+ *                            are not equal
+ */
+template <size_t N>
+void CompactKeyEqualityTest() {
+  CompactIntsKey<N> key1{};
+  for(size_t i = 0;i < N;i++) {
+    key1.word[i] = i * 0x0101010101010101UL;
+  }
+  
+  CompactIntsKey<N> key2 = key1;
+  assert(key1 == key2);
+  assert(CompactIntsKeyHasher<N>{}(key1) == CompactIntsKeyHasher<N>{}(key2));
+  
+  for(size_t i = 0;i < N;i++) {
+    for(int bit = 0;bit < 64;bit += 7) {
+      key2.word[i] ^= (0x1UL << bit);
+      assert(key1 != key2);
+      assert(CompactIntsKeyEqualityChecker<N>{}(key1, key2) == false);
+      
+      key2.word[i] ^= (0x1UL << bit);
+      assert(key1 == key2);
+    }
+  }
+  
+  return;
+}
+
+/*
+ * CompactKeyTest() - Tests tables using keys of packed integer columns
+ */
+void CompactKeyTest() {
+  dbg_printf("========== Compact Key Test ==========\n");
+  
+  CompactKeyEqualityTest<1>();
+  CompactKeyEqualityTest<2>();
+  CompactKeyEqualityTest<3>();
+  CompactKeyEqualityTest<4>();
+  CompactKeyEqualityTest<5>();
+  CompactKeyEqualityTest<7>();
+  CompactKeyEqualityTest<8>();
+  
+  using KeyType = CompactIntsKey<3>;
+  using CompactTable = HashTable_OA_KVL<KeyType,
+                                        uint64_t,
+                                        CompactIntsKeyHasher<3>>;
+  
+  const uint64_t key_num = 10000;
+  
+  CompactTable ht{};
+  
+  // Keys whose columns are permutations of each other are distinct
+  for(uint64_t i = 0;i < key_num;i++) {
+    assert(ht.Insert(KeyType{{i, i + 1, 0}}, i) == true);
+    assert(ht.Insert(KeyType{{i + 1, i, 0}}, i + key_num) == true);
+  }
+  
+  for(uint64_t i = 0;i < key_num;i++) {
+    std::pair<uint64_t *, uint32_t> ret = ht.GetValue(KeyType{{i, i + 1, 0}});
+    assert(ret.second == 1);
+    assert(ret.first[0] == i);
+    
+    ret = ht.GetValue(KeyType{{i + 1, i, 0}});
+    assert(ret.second == 1);
+    assert(ret.first[0] == i + key_num);
+    
+    assert(ht.GetValue(KeyType{{i, i + 1, 1}}).second == 0);
+  }
+  
+  // A column value that makes a factor of the pair zero does not make the
+  // other column irrelevant
+  CompactIntsKeyHasher<2> hasher{};
+  const uint64_t zero_left = 0xa0761d6478bd642fUL;
+  const uint64_t zero_right = 0xe7037ed1a0b428dbUL;
+  
+  assert(hasher(CompactIntsKey<2>{{zero_left, 1}}) != \
+         hasher(CompactIntsKey<2>{{zero_left, 2}}));
+  assert(hasher(CompactIntsKey<2>{{1, zero_right}}) != \
+         hasher(CompactIntsKey<2>{{2, zero_right}}));
+  
+  return;
+}
+
+/*
+ * StringKeyTest() - Tests string keys of all lengths copied into an arena
+ */
+void StringKeyTest() {
+  dbg_printf("========== String Key Test ==========\n");
+  
+  using StringTable = HashTable_OA_KVL<StringKey,
+                                       uint64_t,
+                                       StringKeyHasher,
+                                       StringKeyEqualityChecker>;
+  
+  const uint64_t key_num = 10000;
+  
+  // Lengths from 0 to 99 and a few longer than a quarter of a chunk such
+  // that every tail length of the hash function is covered
+  std::vector<std::string> string_list{};
+  for(uint64_t i = 0;i < key_num;i++) {
+    uint64_t length = (i % 100 == 99) ? (20000 + i) : (i % 100);
+    std::string s(length, 'a');
+    for(uint64_t j = 0;j < length;j++) {
+      s[j] = static_cast<char>('a' + (i + j * 7) % 26);
+    }
+    
+    // Makes strings of the same length and content distinct
+    if(length >= 8) {
+      memcpy(&s[length - 8], &i, sizeof(i));
+    }
+    
+    string_list.push_back(s);
+  }
+  
+  // Short strings that collide with each other are removed
+  std::sort(string_list.begin(), string_list.end());
+  string_list.erase(std::unique(string_list.begin(), string_list.end()),
+                    string_list.end());
+  
+  StringArena arena{};
+  StringTable ht{};
+  for(uint64_t i = 0;i < string_list.size();i++) {
+    const std::string &s = string_list[i];
+    StringKey key = StringKey::Get(arena.Copy(s.data(), s.size()), s.size());
+    
+    assert(ht.Insert(key, i) == true);
+  }
+  
+  dbg_printf("%lu strings; %lu bytes of data; %lu bytes allocated\n",
+             string_list.size(),
+             arena.GetDataSize(),
+             arena.GetMemorySize());
+  
+  assert(arena.GetMemorySize() >= arena.GetDataSize());
+  
+  // Lookup with keys referring to the original strings
+  for(uint64_t i = 0;i < string_list.size();i++) {
+    const std::string &s = string_list[i];
+    StringKey key = StringKey::Get(s.data(), s.size());
+    
+    std::pair<uint64_t *, uint32_t> ret = ht.GetValue(key);
+    assert(ret.second == 1);
+    assert(ret.first[0] == i);
+    
+    // A prefix of the string is a different key
+    if(s.size() > 0) {
+      assert((key == StringKey::Get(s.data(), s.size() - 1)) == false);
+    }
+  }
+  
+  StringKeyHasher hasher{};
+  
+  // Strings of the same bytes but different lengths hash differently
+  const char zero_list[16] = {0};
+  for(uint64_t i = 0;i < 16;i++) {
+    assert(hasher(StringKey::Get(zero_list, i)) != \
+           hasher(StringKey::Get(zero_list, i + 1)));
+  }
+  
+  // A block that makes a factor of its product zero does not erase the
+  // bytes before it
+  const uint64_t zero_left = 0xa0761d6478bd642fUL;
+  const uint64_t zero_right = 0xe7037ed1a0b428dbUL;
+  std::vector<uint64_t> hash_list{};
+  for(char c = 'A';c <= 'H';c++) {
+    std::string s(32, 'Z');
+    s.replace(0, 8, 8, c);
+    memcpy(&s[8], &zero_right, sizeof(zero_right));
+    hash_list.push_back(hasher(StringKey::Get(s.data(), s.size())));
+    
+    memcpy(&s[0], &zero_left, sizeof(zero_left));
+    s.replace(8, 8, 8, c);
+    hash_list.push_back(hasher(StringKey::Get(s.data(), s.size())));
+  }
+  
+  std::sort(hash_list.begin(), hash_list.end());
+  assert(std::unique(hash_list.begin(), hash_list.end()) == hash_list.end());
+  
+  std::string missing_key = "this string is not inserted";
+  assert(ht.GetValue(StringKey::Get(missing_key.data(),
+                                    missing_key.size())).second == 0);
+  
+  return;
+}
+
+/*
+ * CountUnmatched() - Returns the number of unmatched values, and checks that
+ *                    values reported satisfy the predicate
+ */
+template <typename TableType, typename Predicate>
+uint64_t CountUnmatched(TableType *ht_p, Predicate pred) {
+  uint64_t count = 0;
+  uint64_t ret = \
+    ht_p->ForEachUnmatched([&count, &pred](const uint64_t &key,
+                                           const uint64_t &value) {
+      assert(pred(key, value) == true);
+      count++;
+    });
+  
+  assert(ret == count);
+  
+  return count;
+}
+
+/*
+ * MatchTest() - Tests match bits of inline and KVL values through resize,
+ *               deletion, clone and merge
+ */
+void MatchTest() {
+  dbg_printf("========== Match Test ==========\n");
+  
+  using MatchTable = HashTable_OA_KVL<uint64_t,
+                                      uint64_t,
+                                      SimpleInt64Hasher,
+                                      std::equal_to<uint64_t>,
+                                      LoadFactorHalfFull,
+                                      NoStats,
+                                      TrackMatches>;
+  
+  const uint64_t key_num = 10000;
+  
+  // Key i has value i; Keys that are multiples of 4 also have values
+  // i + 1 to i + 3, and key 0 has 200 values such that its KVL bitmap takes
+  // more than one word
+  MatchTable ht{};
+  uint64_t value_num = 0;
+  for(uint64_t i = 0;i < key_num;i++) {
+    uint64_t count = (i == 0) ? 200 : ((i % 4 == 0) ? 4 : 1);
+    for(uint64_t j = 0;j < count;j++) {
+      ht.Insert(i, i + j);
+    }
+    
+    value_num += count;
+  }
+  
+  assert(CountUnmatched(&ht, [](uint64_t, uint64_t) { return true; }) == \
+         value_num);
+  
+  // Probe even keys, and only even values match
+  uint64_t match_num = 0;
+  for(uint64_t i = 0;i < key_num;i += 2) {
+    match_num += ht.GetValueAndMark(i, [](const uint64_t &value) {
+      return value % 2 == 0;
+    });
+  }
+  
+  // Marking again does not change anything
+  ht.GetValueAndMarkWithHash(0, SimpleInt64Hasher{}(0), [](const uint64_t &) {
+    return true;
+  });
+  assert(ht.GetValueAndMark(key_num, [](const uint64_t &) {
+    return true;
+  }) == 0);
+  
+  // Everything of key 0 is matched now
+  match_num += 100;
+  
+  // Keys inserted later are not probed
+  auto unmatched_pred = [key_num](uint64_t key, uint64_t value) {
+    return (key != 0) && \
+           ((key >= key_num) || (key % 2 == 1) || (value % 2 == 1));
+  };
+  
+  assert(CountUnmatched(&ht, unmatched_pred) == value_num - match_num);
+  
+  // A clone has the same bits
+  MatchTable clone = ht.Clone();
+  assert(CountUnmatched(&clone, unmatched_pred) == value_num - match_num);
+  
+  // Bits move with entries on resize, and new keys are unmatched
+  for(uint64_t i = key_num;i < 4 * key_num;i++) {
+    ht.Insert(i, i);
+  }
+  
+  value_num += 3 * key_num;
+  assert(CountUnmatched(&ht, unmatched_pred) == value_num - match_num);
+  
+  // Values appended to a matched key are unmatched
+  ht.Insert(2, 3);
+  value_num++;
+  assert(CountUnmatched(&ht, unmatched_pred) == value_num - match_num);
+  
+  // Remove unmatched values i + 1 of keys that are multiples of 4, which
+  // moves bits of remaining values in KVLs
+  uint64_t deleted_num = ht.DeleteIf([](const uint64_t &key,
+                                        const uint64_t &value) {
+    return (key % 4 == 0) && (key != 0) && (value == key + 1);
+  });
+  
+  assert(deleted_num == key_num / 4 - 1);
+  value_num -= deleted_num;
+  assert(CountUnmatched(&ht, unmatched_pred) == value_num - match_num);
+  
+  // Deleting the KVL of key 2 makes its value inline again with the bit
+  ht.DeleteIf([](const uint64_t &key, const uint64_t &value) {
+    return (key == 2) && (value == 3);
+  });
+  value_num--;
+  assert(CountUnmatched(&ht, unmatched_pred) == value_num - match_num);
+  
+  // Merging keeps bits of moved entries and appended values
+  MatchTable other{};
+  other.Insert(1, 1);
+  other.Insert(1, 2);
+  other.Insert(5 * key_num, 5 * key_num);
+  other.GetValueAndMark(1, [](const uint64_t &value) {
+    return value == 2;
+  });
+  other.GetValueAndMark(5 * key_num, [](const uint64_t &) {
+    return true;
+  });
+  
+  ht.Merge(std::move(other));
+  value_num += 3;
+  match_num += 2;
+  
+  assert(CountUnmatched(&ht, [&unmatched_pred](uint64_t key, uint64_t value) {
+    return (unmatched_pred(key, value) == true) && \
+           ((key != 1) || (value != 2)) && (key != 5 * key_num);
+  }) == value_num - match_num);
+  
+  ht.ClearMatches();
+  assert(CountUnmatched(&ht, [](uint64_t, uint64_t) { return true; }) == \
+         value_num);
+  
+  return;
+}
+
+/*
+ * class LastSlotHasher - Maps every key to one of the last four slots
+ */
+class LastSlotHasher {
+ public:
+  inline uint64_t operator()(const uint64_t &key) const {
+    return UINT64_MAX - (key % 4);
+  }
+};
+
+/*
+ * TailTest() - Tests probes that run past the last slot into the tail,
+ *              which grows the tail or resizes the table
+ */
+void TailTest() {
+  dbg_printf("========== Tail Test ==========\n");
+  
+  using TailTable = HashTable_OA_KVL<uint64_t,
+                                     uint64_t,
+                                     LastSlotHasher,
+                                     std::equal_to<uint64_t>,
+                                     LoadFactorHalfFull,
+                                     NoStats,
+                                     TrackMatches>;
+  
+  const uint64_t key_num = 1000;
+  
+  // Every probe starts at the end of the array, so the tail must grow
+  TailTable ht{};
+  for(uint64_t i = 0;i < key_num;i++) {
+    ht.Insert(i, i);
+  }
+  
+  // Even keys also have a KVL
+  for(uint64_t i = 0;i < key_num;i += 2) {
+    ht.Insert(i, i + 1);
+  }
+  
+  dbg_printf("Entry count = %lu; Max probe length = %lu\n",
+             ht.GetEntryCount(),
+             ht.GetMaxSearchProbeLength());
+  
+  assert(ht.GetMaxSearchProbeLength() >= key_num - 4);
+  
+  for(uint64_t i = 0;i < key_num;i++) {
+    auto ret = ht.GetValue(i);
+    assert(ret.second == ((i % 2 == 0) ? 2U : 1U));
+    assert(ret.first[0] == i);
+  }
+  
+  assert(ht.GetValue(key_num).second == 0);
+  
+  // Match bits are kept when the tail grows
+  uint64_t match_num = 0;
+  for(uint64_t i = 0;i < key_num;i += 3) {
+    match_num += ht.GetValueAndMark(i, [](const uint64_t &) {
+      return true;
+    });
+  }
+  
+  uint64_t value_num = key_num + key_num / 2;
+  
+  // Iteration covers the tail
+  uint64_t count = 0;
+  for(auto it = ht.begin();it != ht.end();++it) {
+    count++;
+  }
+  
+  assert(count == value_num);
+  
+  // Interleaved lookups find keys in the tail
+  std::vector<uint64_t> key_list{};
+  for(uint64_t i = 0;i < key_num;i++) {
+    key_list.push_back(i);
+  }
+  
+  uint64_t found_num = 0;
+  ht.GetValueInterleaved(key_list.data(),
+                         key_list.size(),
+                         [&](uint64_t key_index,
+                             std::pair<uint64_t *, uint32_t> ret) {
+    assert(ret.first[0] == key_list[key_index]);
+    found_num += ret.second;
+  });
+  
+  assert(found_num == value_num);
+  
+  TailTable clone = ht.Clone();
+  for(uint64_t i = 0;i < key_num;i++) {
+    assert(clone.GetValue(i).first[0] == i);
+  }
+  
+  // Tombstones in the tail are removed
+  uint64_t deleted_num = ht.DeleteIf([](const uint64_t &key,
+                                        const uint64_t &) {
+    return key % 5 == 0;
+  });
+  
+  assert(deleted_num == 300);
+  
+  // Merging into a fresh table grows its tail while moving entries
+  TailTable merged{};
+  merged.Merge(std::move(clone));
+  assert(clone.GetValue(0).second == 0);
+  
+  for(uint64_t i = 0;i < key_num;i++) {
+    assert(ht.GetValue(i).second == \
+           ((i % 5 == 0) ? 0U : ((i % 2 == 0) ? 2U : 1U)));
+    assert(merged.GetValue(i).second == ((i % 2 == 0) ? 2U : 1U));
+  }
+  
+  assert(CountUnmatched(&merged, [](uint64_t key, uint64_t) {
+    return key % 3 != 0;
+  }) == value_num - match_num);
+  
+  return;
+}
+
 int main() {
   IteratorTest();
   ResizeTest();
   DeleteTest();
   DeleteTest2();
+  StandardIteratorTest();
+  InterleavedLookupTest();
+  PackedValueTest();
+  DeleteIfTest();
+  MergeTest();
+  MoveCloneTest();
+  StatsTest();
+  EventTest();
+  MemoryBudgetTest();
+  HashValueTest();
+  MatchTest();
+  ExternalKeyTest();
+  CompactKeyTest();
+  StringKeyTest();
+  TailTest();
 
   return 0;
 }
@@ -0,0 +1,226 @@
+
+#include "../src/HybridHashJoin.h"
+
+#include <vector>
+#include <csignal>
+#include <sys/resource.h>
+
+using namespace peloton;
+using namespace index;
+
+static constexpr uint64_t key_num = 100000;
+
+/*
+ * JoinAndVerify() - Joins build and probe sides and checks all matches
+ *
+ * Key i of the build side has value i, and even keys also have value
+ * i + 1. The probe side has keys in [0, 2 * key_num) with value 10 * key,
+ * so half of the probe rows do not match
+ */
+template <typename JoinType>
+void JoinAndVerify(JoinType *join_p, uint64_t build_key_num) {
+  for(uint64_t i = 0;i < build_key_num;i++) {
+    assert(join_p->AddBuild(i, i) == true);
+  }
+
+  for(uint64_t i = 0;i < build_key_num;i += 2) {
+    assert(join_p->AddBuild(i, i + 1) == true);
+  }
+
+  join_p->FinishBuild();
+
+  // Sum of build values matched for each key
+  std::vector<uint64_t> sum_list(build_key_num, 0);
+  std::vector<uint64_t> match_list(build_key_num, 0);
+  auto cb = [&sum_list, &match_list](const uint64_t &key,
+                                     const uint64_t &build_value,
+                                     const uint64_t &probe_value) {
+    assert(key < sum_list.size());
+    assert(probe_value == 10 * key);
+
+    sum_list[key] += build_value;
+    match_list[key]++;
+  };
+
+  for(uint64_t i = 0;i < 2 * build_key_num;i++) {
+    assert(join_p->Probe(i, 10 * i, cb) == true);
+  }
+
+  assert(join_p->FinishProbe(cb) == true);
+
+  for(uint64_t i = 0;i < build_key_num;i++) {
+    if(i % 2 == 0) {
+      assert(match_list[i] == 2);
+      assert(sum_list[i] == 2 * i + 1);
+    } else {
+      assert(match_list[i] == 1);
+      assert(sum_list[i] == i);
+    }
+  }
+
+  return;
+}
+
+/*
+ * JoinTest() - Tests the join with and without spilling
+ */
+template <typename TableType>
+void JoinTest(const char *name) {
+  using JoinType = HybridHashJoin<uint64_t, uint64_t, uint64_t, TableType>;
+
+  dbg_printf("========== %s In Memory Join Test ==========\n", name);
+
+  JoinType in_memory_join{UINT64_MAX};
+  JoinAndVerify(&in_memory_join, key_num);
+
+  assert(in_memory_join.GetSpillCount() == 0);
+  assert(in_memory_join.GetSpilledProbeCount() == 0);
+  assert(in_memory_join.GetMaxLevel() == 0);
+
+  dbg_printf("========== %s Spill Join Test ==========\n", name);
+
+  JoinType spill_join{256 * 1024};
+  JoinAndVerify(&spill_join, key_num);
+
+  dbg_printf("%lu partitions spilled; %lu build rows; %lu probe rows; "
+             "max level %lu\n",
+             spill_join.GetSpillCount(),
+             spill_join.GetSpilledBuildCount(),
+             spill_join.GetSpilledProbeCount(),
+             spill_join.GetMaxLevel());
+
+  // Runs of the first level are still too large for the budget
+  assert(spill_join.GetSpillCount() > JoinType::PARTITION_COUNT);
+  assert(spill_join.GetSpilledProbeCount() > 0);
+  assert(spill_join.GetMaxLevel() >= 2);
+
+  return;
+}
+
+/*
+ * UnsplitRunTest() - Tests that keys that could not be partitioned are
+ *                    joined by block nested loop without recursing further
+ */
+void UnsplitRunTest() {
+  dbg_printf("========== Unsplit Run Test ==========\n");
+
+  using JoinType = HybridHashJoin<uint64_t,
+                                  uint64_t,
+                                  uint64_t,
+                                  HashTable_OA_KVL<uint64_t, uint64_t>,
+                                  ConstantZero>;
+
+  JoinType join{1024};
+  JoinAndVerify(&join, 1000);
+
+  // The first level finds that the run is not split
+  assert(join.GetNestedLoopCount() == 1);
+  assert(join.GetMaxLevel() == 1);
+
+  return;
+}
+
+/*
+ * SkewedKeyTest() - Tests a build side whose rows all have the same key,
+ *                   which no level of partitioning could split
+ */
+void SkewedKeyTest() {
+  dbg_printf("========== Skewed Key Test ==========\n");
+
+  static constexpr uint64_t build_row_num = 200000;
+
+  HybridHashJoin<uint64_t, uint64_t, uint64_t> join{1024 * 1024};
+  for(uint64_t i = 0;i < build_row_num;i++) {
+    assert(join.AddBuild(7, i) == true);
+  }
+
+  join.FinishBuild();
+
+  uint64_t match_count = 0;
+  uint64_t sum = 0;
+  auto cb = [&match_count, &sum](const uint64_t &key,
+                                 const uint64_t &build_value,
+                                 const uint64_t &probe_value) {
+    assert(key == 7);
+    assert((probe_value == 1) || (probe_value == 2));
+
+    match_count++;
+    sum += build_value;
+  };
+
+  assert(join.Probe(7, 1, cb) == true);
+  assert(join.Probe(7, 2, cb) == true);
+  assert(join.FinishProbe(cb) == true);
+
+  dbg_printf("%lu partitions spilled; %lu build rows; max level %lu\n",
+             join.GetSpillCount(),
+             join.GetSpilledBuildCount(),
+             join.GetMaxLevel());
+
+  assert(match_count == 2 * build_row_num);
+  assert(sum == build_row_num * (build_row_num - 1));
+
+  // Rows are spilled by the first level and once more by the level that
+  // finds them not split, rather than by every level down to MAX_LEVEL
+  assert(join.GetNestedLoopCount() == 1);
+  assert(join.GetMaxLevel() == 1);
+  assert(join.GetSpilledBuildCount() <= 2 * build_row_num);
+
+  return;
+}
+
+/*
+ * SpillErrorTest() - Tests that write errors of runs are reported
+ *
+ * The size of files is limited by RLIMIT_FSIZE, under which writes past the
+ * limit fail with EFBIG once SIGXFSZ is ignored
+ */
+void SpillErrorTest() {
+  dbg_printf("========== Spill Error Test ==========\n");
+
+  struct rlimit old_limit;
+  int ret = getrlimit(RLIMIT_FSIZE, &old_limit);
+  assert(ret == 0);
+
+  struct rlimit new_limit = old_limit;
+  new_limit.rlim_cur = 64 * 1024;
+  ret = setrlimit(RLIMIT_FSIZE, &new_limit);
+  assert(ret == 0);
+
+  void (*old_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+
+  HybridHashJoin<uint64_t, uint64_t, uint64_t> join{256 * 1024};
+
+  bool ok = true;
+  for(uint64_t i = 0;i < 10 * key_num;i++) {
+    ok = join.AddBuild(i, i) && ok;
+  }
+
+  join.FinishBuild();
+
+  auto cb = [](const uint64_t &, const uint64_t &, const uint64_t &) {};
+  for(uint64_t i = 0;i < 10 * key_num;i++) {
+    ok = join.Probe(i, i, cb) && ok;
+  }
+
+  ok = join.FinishProbe(cb) && ok;
+  assert(ok == false);
+
+  signal(SIGXFSZ, old_handler);
+  ret = setrlimit(RLIMIT_FSIZE, &old_limit);
+  assert(ret == 0);
+
+  return;
+}
+
+int main() {
+  JoinTest<HashTable_OA_KVL<uint64_t, uint64_t, SimpleInt64Hasher>>(
+    "OA_KVL");
+  JoinTest<HashTable_CA_SCC<uint64_t, uint64_t, SimpleInt64Hasher>>(
+    "CA_SCC");
+  UnsplitRunTest();
+  SkewedKeyTest();
+  SpillErrorTest();
+
+  return 0;
+}
@@ -0,0 +1,150 @@
+
+#include "../src/HashTable_OA_KVL.h"
+#include "../src/HashTable_CA_SCC.h"
+#include "../src/ParallelBuild.h"
+
+using namespace peloton;
+using namespace index;
+
+static constexpr uint64_t key_num = 100000;
+
+/*
+ * GetInput() - Returns the input for building tables
+ *
+ * Key i has value i, and even keys also have value i + 1. The two values
+ * are far apart in the input, so they are scattered by different threads
+ */
+std::vector<std::pair<uint64_t, uint64_t>> GetInput() {
+  std::vector<std::pair<uint64_t, uint64_t>> input{};
+  for(uint64_t i = 0;i < key_num;i++) {
+    input.push_back(std::make_pair(i, i));
+  }
+
+  for(uint64_t i = 0;i < key_num;i += 2) {
+    input.push_back(std::make_pair(i, i + 1));
+  }
+
+  return input;
+}
+
+/*
+ * OA_KVL_BuildTest() - Tests that values are in their input order after a
+ *                      parallel build
+ */
+void OA_KVL_BuildTest(uint64_t thread_count) {
+  dbg_printf("========== OA_KVL Build Test (%lu threads) ==========\n",
+             thread_count);
+
+  std::vector<std::pair<uint64_t, uint64_t>> input = GetInput();
+
+  HashTable_OA_KVL<uint64_t, uint64_t, SimpleInt64Hasher> ht{};
+  ParallelBuild(&ht, input.data(), input.size(), thread_count,
+                SimpleInt64Hasher{});
+
+  for(uint64_t i = 0;i < key_num;i++) {
+    auto ret = ht.GetValue(i);
+
+    assert(ret.second == ((i % 2 == 0) ? 2 : 1));
+    assert(ret.first[0] == i);
+    if(ret.second == 2) {
+      assert(ret.first[1] == i + 1);
+    }
+  }
+
+  assert(static_cast<uint64_t>(std::distance(ht.begin(), ht.end())) == \
+         input.size());
+
+  return;
+}
+
+/*
+ * CA_SCC_BuildTest() - Tests that all values are there after a parallel
+ *                      build
+ */
+void CA_SCC_BuildTest(uint64_t thread_count) {
+  dbg_printf("========== CA_SCC Build Test (%lu threads) ==========\n",
+             thread_count);
+
+  std::vector<std::pair<uint64_t, uint64_t>> input = GetInput();
+
+  HashTable_CA_SCC<uint64_t, uint64_t, SimpleInt64Hasher> ht{};
+  ParallelBuild(&ht, input.data(), input.size(), thread_count,
+                SimpleInt64Hasher{});
+
+  for(uint64_t i = 0;i < key_num;i++) {
+    std::vector<uint64_t> v{};
+    ht.GetValue(i, &v);
+
+    // Chains do not preserve the order of values
+    if(i % 2 == 0) {
+      assert(v.size() == 2);
+      assert(v[0] + v[1] == 2 * i + 1);
+    } else {
+      assert(v.size() == 1);
+      assert(v[0] == i);
+    }
+  }
+
+  assert(static_cast<uint64_t>(std::distance(ht.begin(), ht.end())) == \
+         input.size());
+
+  return;
+}
+
+/*
+ * class PartitionCountingTable - Counts private tables that are not empty
+ *                                when they are merged
+ *
+ * It uses std::hash, which is the identity for integer keys
+ */
+class PartitionCountingTable : public HashTable_OA_KVL<uint64_t, uint64_t> {
+ public:
+  static uint64_t non_empty_count;
+
+  void MergeDisjoint(PartitionCountingTable &&other) {
+    if(other.begin() != other.end()) {
+      non_empty_count++;
+    }
+
+    HashTable_OA_KVL<uint64_t, uint64_t>::MergeDisjoint(std::move(other));
+
+    return;
+  }
+};
+
+uint64_t PartitionCountingTable::non_empty_count = 0;
+
+/*
+ * DefaultHashPartitionTest() - Tests that keys are spread over partitions
+ *                              with the default hash function
+ */
+void DefaultHashPartitionTest() {
+  dbg_printf("========== Default Hash Partition Test ==========\n");
+
+  std::vector<std::pair<uint64_t, uint64_t>> input = GetInput();
+
+  PartitionCountingTable ht{};
+  ParallelBuild(&ht, input.data(), input.size(), 4);
+
+  // There are 4 partitions and keys are small integers
+  assert(PartitionCountingTable::non_empty_count == 4);
+
+  for(uint64_t i = 0;i < key_num;i++) {
+    assert(ht.GetValue(i).second == ((i % 2 == 0) ? 2U : 1U));
+  }
+
+  return;
+}
+
+int main() {
+  // Thread counts that are not a power of 2 own different number of
+  // partitions
+  for(uint64_t thread_count : {1, 3, 4}) {
+    OA_KVL_BuildTest(thread_count);
+    CA_SCC_BuildTest(thread_count);
+  }
+
+  DefaultHashPartitionTest();
+
+  return 0;
+}
@@ -2,10 +2,24 @@
 #include "../src/HashTable_OA_KVL.h"
 #include "../src/HashTable_CA_CC.h"
 #include "../src/HashTable_CA_SCC.h"
+#include "../src/HashTable_CA_SCC_Concurrent.h"
+#include "../src/ParallelBuild.h"
+#include "../src/HashAggregation.h"
+#include "../src/HybridHashJoin.h"
+#include "../src/StringArena.h"
 #include <iostream>
 #include <random>
 #include <chrono>
 #include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <cmath>
+#include <algorithm>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
 
 
 using namespace peloton;
@@ -201,6 +215,8 @@ void CA_CC_InsertTest(uint64_t key_num,
   std::cout << "HashTable_CA_CC: " << (1.0 * iter * key_num) / (1024 * 1024) / elapsed_seconds.count()
             << " million read/sec" << "\n";
 
+  test_map.GetChainStats().Print("HashTable_CA_CC");
+
   return;
 }
 
@@ -250,59 +266,1353 @@ void CA_SCC_InsertTest(uint64_t key_num,
   std::cout << "HashTable_CA_SCC: " << (1.0 * iter * key_num) / (1024 * 1024) / elapsed_seconds.count()
             << " million read/sec" << "\n";
 
+  test_map.GetChainStats().Print("HashTable_CA_SCC");
+
   return;
 }
 
 /*
- * main() - Main test routine
+ * OA_KVL_InterleavedTest() - Compares lookups issued one by one with
+ *                            interleaved lookups on HashTable_OA_KVL
+ */
+template <uint64_t group_size>
+void OA_KVL_InterleavedTest(uint64_t key_num,
+                            const std::vector<uint64_t> &probe_key_list) {
+  HashTable_OA_KVL<uint64_t,
+                   ValueType,
+                   Hasher,
+                   std::equal_to<uint64_t>,
+                   LoadFactorPercent<75>> test_map{1024};
+  for(uint64_t i = 0;i < key_num;i++) {
+    test_map.Insert(i, ValueType{});
+  }
+  
+  std::chrono::time_point<std::chrono::system_clock> start, end;
+  std::chrono::duration<double> elapsed_seconds;
+  
+  // Accumulate something from the value such that the loop is not
+  // optimized away
+  uint64_t found = 0;
+  
+  start = std::chrono::system_clock::now();
+  for(uint64_t key : probe_key_list) {
+    auto ret = test_map.GetValue(key);
+    found += ret.second;
+  }
+  end = std::chrono::system_clock::now();
+  
+  elapsed_seconds = end - start;
+  std::cout << "HashTable_OA_KVL (one by one): "
+            << (1.0 * probe_key_list.size()) / (1024 * 1024) / elapsed_seconds.count()
+            << " million read/sec" << "\n";
+  
+  start = std::chrono::system_clock::now();
+  test_map.GetValueInterleaved<group_size>(
+    probe_key_list.data(),
+    probe_key_list.size(),
+    [&found](uint64_t, std::pair<ValueType *, uint32_t> ret) {
+      found += ret.second;
+    });
+  end = std::chrono::system_clock::now();
+  
+  elapsed_seconds = end - start;
+  std::cout << "HashTable_OA_KVL (interleaved, group = " << group_size << "): "
+            << (1.0 * probe_key_list.size()) / (1024 * 1024) / elapsed_seconds.count()
+            << " million read/sec" << "\n";
+  
+  // Both rounds must have found all keys
+  assert(found == 2 * probe_key_list.size());
+  (void)found;
+  
+  return;
+}
+
+/*
+ * CA_SCC_InterleavedTest() - Compares lookups issued one by one with
+ *                            interleaved lookups on HashTable_CA_SCC
+ */
+template <uint64_t group_size>
+void CA_SCC_InterleavedTest(uint64_t key_num,
+                            const std::vector<uint64_t> &probe_key_list) {
+  HashTable_CA_SCC<uint64_t,
+                   ValueType,
+                   Hasher,
+                   std::equal_to<uint64_t>,
+                   LoadFactorPercent<400>> test_map{1024};
+  for(uint64_t i = 0;i < key_num;i++) {
+    test_map.Insert(i, ValueType{});
+  }
+  
+  std::chrono::time_point<std::chrono::system_clock> start, end;
+  std::chrono::duration<double> elapsed_seconds;
+  
+  uint64_t found = 0;
+  
+  start = std::chrono::system_clock::now();
+  for(uint64_t key : probe_key_list) {
+    test_map.GetValue(key,
+                      [&found](const std::pair<uint64_t, ValueType> &) {
+                        found++;
+                      });
+  }
+  end = std::chrono::system_clock::now();
+  
+  elapsed_seconds = end - start;
+  std::cout << "HashTable_CA_SCC (one by one): "
+            << (1.0 * probe_key_list.size()) / (1024 * 1024) / elapsed_seconds.count()
+            << " million read/sec" << "\n";
+  
+  start = std::chrono::system_clock::now();
+  test_map.GetValueInterleaved<group_size>(
+    probe_key_list.data(),
+    probe_key_list.size(),
+    [&found](uint64_t, const std::pair<uint64_t, ValueType> &) {
+      found++;
+    });
+  end = std::chrono::system_clock::now();
+  
+  elapsed_seconds = end - start;
+  std::cout << "HashTable_CA_SCC (interleaved, group = " << group_size << "): "
+            << (1.0 * probe_key_list.size()) / (1024 * 1024) / elapsed_seconds.count()
+            << " million read/sec" << "\n";
+  
+  assert(found == 2 * probe_key_list.size());
+  (void)found;
+  
+  return;
+}
+
+/*
+ * RunThreads() - Runs the given function on a number of threads, and
+ *                returns the elapsed time in seconds
  *
- * |------------------------|-----------------------------|
- * |       Command          |         Explanation         |
- * |------------------------|-----------------------------|
- * | ./benchmark            | Prints help message         |
- * | ./benchmark --seq      | Runs sequential test        |
- * | ./benchmark --random   | Runs random workload test   |
- * |------------------------|-----------------------------|
+ * The function is called with the thread index
  */
-int main(int argc, char **argv) {
-  // Make sure we have correct number of arguments
-  if(argc == 1) {
-    printf("Please use command line argument to run test suites!\n");
-    
-    return 0;
-  } else if(argc > 2) {
-    printf("Too many arguments\n");
+double RunThreads(int thread_num, std::function<void(int)> f) {
+  std::chrono::time_point<std::chrono::system_clock> start, end;
+  start = std::chrono::system_clock::now();
+
+  std::vector<std::thread> thread_list{};
+  for(int t = 0;t < thread_num;t++) {
+    thread_list.emplace_back(f, t);
+  }
+
+  for(std::thread &t : thread_list) {
+    t.join();
+  }
+
+  end = std::chrono::system_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+
+  return elapsed_seconds.count();
+}
+
+/*
+ * CA_SCC_ConcurrentTest() - Measures insert and read throughput of
+ *                           HashTable_CA_SCC_Concurrent on multiple threads
+ *
+ * Threads insert disjoint sets of keys, and then read all keys
+ */
+void CA_SCC_ConcurrentTest(uint64_t key_num, int thread_num) {
+  HashTable_CA_SCC_Concurrent<uint64_t,
+                              ValueType,
+                              Hasher,
+                              std::equal_to<uint64_t>,
+                              LoadFactorPercent<400>> test_map{1024};
+
+  double insert_time = RunThreads(thread_num, [&test_map, key_num, thread_num](int t) {
+    uint64_t thread_id = test_map.RegisterThread();
+    for(uint64_t i = t;i < key_num;i += thread_num) {
+      test_map.Insert(thread_id, i, ValueType{});
+    }
+
+    test_map.UnregisterThread(thread_id);
+  });
+
+  double read_time = RunThreads(thread_num, [&test_map, key_num, thread_num](int t) {
+    uint64_t thread_id = test_map.RegisterThread();
+    std::vector<ValueType> v{};
+    v.reserve(100);
+
+    for(uint64_t i = t;i < key_num;i += thread_num) {
+      test_map.GetValue(thread_id, i, &v);
+      v.clear();
+    }
+
+    test_map.UnregisterThread(thread_id);
+  });
+
+  std::cout << "HashTable_CA_SCC_Concurrent (" << thread_num << " threads): "
+            << 1.0 * key_num / (1024 * 1024) / insert_time
+            << " million insertion/sec; "
+            << 1.0 * key_num / (1024 * 1024) / read_time
+            << " million read/sec" << "\n";
+
+  return;
+}
+
+/*
+ * CA_SCC_MutexTest() - Same as CA_SCC_ConcurrentTest(), but uses
+ *                      HashTable_CA_SCC protected by a single mutex
+ */
+void CA_SCC_MutexTest(uint64_t key_num, int thread_num) {
+  HashTable_CA_SCC<uint64_t,
+                   ValueType,
+                   Hasher,
+                   std::equal_to<uint64_t>,
+                   LoadFactorPercent<400>> test_map{1024};
+  std::mutex table_lock{};
+
+  double insert_time = RunThreads(thread_num, [&](int t) {
+    for(uint64_t i = t;i < key_num;i += thread_num) {
+      std::lock_guard<std::mutex> lock{table_lock};
+      test_map.Insert(i, ValueType{});
+    }
+  });
+
+  double read_time = RunThreads(thread_num, [&](int t) {
+    std::vector<ValueType> v{};
+    v.reserve(100);
+
+    for(uint64_t i = t;i < key_num;i += thread_num) {
+      {
+        std::lock_guard<std::mutex> lock{table_lock};
+        test_map.GetValue(i, &v);
+      }
+
+      v.clear();
+    }
+  });
+
+  std::cout << "HashTable_CA_SCC + mutex (" << thread_num << " threads): "
+            << 1.0 * key_num / (1024 * 1024) / insert_time
+            << " million insertion/sec; "
+            << 1.0 * key_num / (1024 * 1024) / read_time
+            << " million read/sec" << "\n";
+
+  return;
+}
+
+/*
+ * ParallelBuildTest() - Measures the throughput of building a table with
+ *                       ParallelBuild(), including the final merge
+ */
+template <typename TableType>
+void ParallelBuildTest(const char *name, uint64_t key_num, int thread_num) {
+  std::vector<std::pair<uint64_t, ValueType>> input{};
+  input.reserve(key_num);
+  for(uint64_t i = 0;i < key_num;i++) {
+    input.push_back(std::make_pair(i, ValueType{}));
+  }
+
+  TableType test_map{};
+  double build_time = RunThreads(1, [&](int) {
+    ParallelBuild(&test_map, input.data(), key_num, thread_num, Hasher{});
+  });
+
+  std::cout << name << " (" << thread_num << " threads): "
+            << 1.0 * key_num / (1024 * 1024) / build_time
+            << " million insertion/sec" << "\n";
+
+  return;
+}
+
+/*
+ * GetZipfianKeyList() - Returns a list of keys in [0, key_num) following
+ *                       a Zipfian distribution with the given skew
+ *
+ * Key 0 is the most frequent one. The CDF is precomputed and sampled by
+ * binary search
+ */
+std::vector<uint64_t> GetZipfianKeyList(uint64_t key_num,
+                                        uint64_t probe_num,
+                                        double theta) {
+  std::vector<double> cdf{};
+  cdf.reserve(key_num);
+  
+  double sum = 0.0;
+  for(uint64_t i = 0;i < key_num;i++) {
+    sum += 1.0 / std::pow(static_cast<double>(i + 1), theta);
+    cdf.push_back(sum);
+  }
+  
+  std::random_device r{};
+  std::default_random_engine e1(r());
+  std::uniform_real_distribution<double> uniform_dist(0.0, sum);
+  
+  std::vector<uint64_t> key_list{};
+  key_list.reserve(probe_num);
+  for(uint64_t i = 0;i < probe_num;i++) {
+    auto it = std::upper_bound(cdf.begin(), cdf.end(), uniform_dist(e1));
+    uint64_t key = static_cast<uint64_t>(it - cdf.begin());
     
-    return 0;
+    key_list.push_back((key < key_num) ? key : key_num - 1);
   }
   
-  char *p = argv[1];
+  return key_list;
+}
+
+/*
+ * CA_SCC_SelfOrganizingTest() - Measures GetFirstValue() on HashTable_CA_SCC
+ *                               with a chain reorder policy
+ *
+ * Keys are inserted in increasing order, so frequent keys with small values
+ * start at the end of their chains. Counters are enabled to report the
+ * average walk length, which slows down lookups by the same amount for
+ * every policy
+ */
+template <typename ChainReorderPolicy>
+void CA_SCC_SelfOrganizingTest(const char *name,
+                               uint64_t key_num,
+                               const std::vector<uint64_t> &probe_key_list) {
+  HashTable_CA_SCC<uint64_t,
+                   ValueType,
+                   Hasher,
+                   std::equal_to<uint64_t>,
+                   LoadFactorPercent<400>,
+                   CountingStats,
+                   ChainReorderPolicy> test_map{1024};
+  for(uint64_t i = 0;i < key_num;i++) {
+    test_map.Insert(i, ValueType{});
+  }
   
-  if(strcmp(p, "--seq") == 0) {
-    uint64_t key_num = 6 * 1024 * 1024;
-    auto f = [](uint64_t i) { return i; };
+  test_map.ResetStats();
+  
+  uint64_t found = 0;
+  double read_time = RunThreads(1, [&](int) {
+    for(uint64_t key : probe_key_list) {
+      if(test_map.GetFirstValue(key) != nullptr) {
+        found++;
+      }
+    }
+  });
+  
+  assert(found == probe_key_list.size());
+  (void)found;
+  
+  std::cout << "HashTable_CA_SCC (" << name << "): "
+            << (1.0 * probe_key_list.size()) / (1024 * 1024) / read_time
+            << " million read/sec; "
+            << test_map.GetStats().GetPerLookup(StatsCounter::CHAIN_WALK)
+            << " entries walked per lookup" << "\n";
+  
+  return;
+}
 
-    dbg_printf("Key space = %lu\n", key_num);
+/*
+ * CA_SCC_CompactTest() - Measures lookups and full scans on HashTable_CA_SCC
+ *                        before and after Compact()
+ *
+ * Keys are inserted in random order, so entries on the same chain are
+ * allocated far apart
+ */
+void CA_SCC_CompactTest(uint64_t key_num) {
+  std::vector<uint64_t> key_list(key_num);
+  for(uint64_t i = 0;i < key_num;i++) {
+    key_list[i] = i;
+  }
+  
+  std::random_device r{};
+  std::default_random_engine e1(r());
+  std::shuffle(key_list.begin(), key_list.end(), e1);
+  
+  HashTable_CA_SCC<uint64_t,
+                   ValueType,
+                   Hasher,
+                   std::equal_to<uint64_t>,
+                   LoadFactorPercent<400>> test_map{1024};
+  for(uint64_t key : key_list) {
+    test_map.Insert(key, ValueType{});
+  }
+  
+  std::shuffle(key_list.begin(), key_list.end(), e1);
+  
+  for(int round = 0;round < 2;round++) {
+    const char *name = (round == 0) ? "before compact" : "after compact";
+    uint64_t found = 0;
+    
+    double read_time = RunThreads(1, [&](int) {
+      for(uint64_t key : key_list) {
+        test_map.GetValue(key,
+                          [&found](const std::pair<uint64_t, ValueType> &) {
+                            found++;
+                          });
+      }
+    });
+    
+    double scan_time = RunThreads(1, [&](int) {
+      for(auto it = test_map.begin();it != test_map.end();++it) {
+        found++;
+      }
+    });
+    
+    assert(found == 2 * key_num);
+    (void)found;
+    
+    std::cout << "HashTable_CA_SCC (" << name << "): "
+              << (1.0 * key_num) / (1024 * 1024) / read_time
+              << " million read/sec; "
+              << (1.0 * key_num) / (1024 * 1024) / scan_time
+              << " million scanned/sec" << "\n";
+    
+    if(round == 0) {
+      double compact_time = RunThreads(1, [&](int) {
+        test_map.Compact();
+      });
+      
+      std::cout << "Compact() takes " << compact_time << " sec" << "\n";
+    }
+  }
+  
+  return;
+}
 
-    OA_KVL_InsertTest(key_num, f);
-    UnorderedMultimapInsertTest(key_num, f);
-    CA_CC_InsertTest(key_num, f);
-    CA_SCC_InsertTest(key_num, f);
-  } else if(strcmp(p, "--random") == 0) {
-    uint64_t key_num = 6 * 1024 * 1024;
+/*
+ * class CountSumAggregate - COUNT(*) and SUM() for the aggregation test
+ */
+class CountSumAggregate {
+ public:
+  uint64_t count;
+  uint64_t sum;
+};
 
-    std::random_device r{};
-    std::default_random_engine e1(r());
-    std::uniform_int_distribution<int> uniform_dist(0, key_num - 1);
-    auto f = [&uniform_dist, &e1](uint64_t i) { return uniform_dist(e1); };
+/*
+ * class CountSumCombiner - Adds a partial aggregate into a group
+ */
+class CountSumCombiner {
+ public:
+  inline void operator()(CountSumAggregate *group_p,
+                         const CountSumAggregate &partial) const {
+    group_p->count += partial.count;
+    group_p->sum += partial.sum;
+
+    return;
+  }
+};
+
+/*
+ * HashAggregationTest() - Measures grouping throughput of HashAggregation
+ *                         under a memory budget
+ *
+ * Keys are drawn uniformly from group_num groups
+ */
+void HashAggregationTest(const std::vector<uint64_t> &key_list,
+                         uint64_t group_num,
+                         uint64_t memory_budget) {
+  HashAggregation<uint64_t,
+                  CountSumAggregate,
+                  CountSumCombiner,
+                  Hasher> agg{memory_budget};
+  uint64_t emitted = 0;
+  uint64_t total = 0;
+
+  double duration = RunThreads(1, [&](int) {
+    for(uint64_t key : key_list) {
+      agg.Add(key, CountSumAggregate{1, key});
+    }
+
+    agg.Finish([&emitted, &total](const uint64_t &,
+                                  const CountSumAggregate &group) {
+      emitted++;
+      total += group.count;
+    });
+  });
+
+  assert(emitted <= group_num);
+  assert(total == key_list.size());
+  (void)group_num;
+  (void)total;
+
+  std::cout << "HashAggregation (budget ";
+  if(memory_budget == UINT64_MAX) {
+    std::cout << "unlimited): ";
+  } else {
+    std::cout << memory_budget / (1024 * 1024) << " MB): ";
+  }
+
+  std::cout
+            << (1.0 * key_list.size()) / (1024 * 1024) / duration
+            << " million rows/sec; " << emitted << " groups; "
+            << agg.GetSpillCount() << " partitions spilled ("
+            << agg.GetSpilledRecordCount() << " records); max level "
+            << agg.GetMaxLevel() << "\n";
+
+  return;
+}
+
+/*
+ * HybridHashJoinTest() - Measures join throughput of HybridHashJoin under a
+ *                        memory budget
+ *
+ * Every build key has one value, and every probe key matches one build key
+ */
+template <typename TableType>
+void HybridHashJoinTest(const char *name,
+                        const std::vector<uint64_t> &build_key_list,
+                        const std::vector<uint64_t> &probe_key_list,
+                        uint64_t memory_budget) {
+  HybridHashJoin<uint64_t, uint64_t, uint64_t, TableType, Hasher> \
+    join{memory_budget};
+  uint64_t match = 0;
+  auto cb = [&match](const uint64_t &, const uint64_t &, const uint64_t &) {
+    match++;
+  };
+
+  double build_time = RunThreads(1, [&](int) {
+    for(uint64_t key : build_key_list) {
+      join.AddBuild(key, key);
+    }
+
+    join.FinishBuild();
+  });
+
+  uint64_t peak_memory = join.GetMemoryUsage();
+
+  double probe_time = RunThreads(1, [&](int) {
+    for(uint64_t key : probe_key_list) {
+      join.Probe(key, key, cb);
+    }
+
+    join.FinishProbe(cb);
+  });
+
+  assert(match == probe_key_list.size());
+  (void)match;
+
+  std::cout << name << " (budget ";
+  if(memory_budget == UINT64_MAX) {
+    std::cout << "unlimited): ";
+  } else {
+    std::cout << memory_budget / (1024 * 1024) << " MB): ";
+  }
+
+  std::cout << (1.0 * build_key_list.size()) / (1024 * 1024) / build_time
+            << " million build/sec; "
+            << (1.0 * probe_key_list.size()) / (1024 * 1024) / probe_time
+            << " million probe/sec (including spilled partitions); "
+            << peak_memory / (1024 * 1024) << " MB in memory after build; "
+            << join.GetSpillCount() << " partitions spilled ("
+            << join.GetSpilledBuildCount() << " build, "
+            << join.GetSpilledProbeCount() << " probe rows); max level "
+            << join.GetMaxLevel() << "\n";
+
+  return;
+}
+
+/*
+ * OuterJoinTest() - Measures probes that mark matched values and the scan
+ *                   of unmatched values for a right outer join
+ *
+ * Half of probe keys are not in the table. Probes are split among threads
+ * that mark values concurrently, and the baseline is probing a table that
+ * does not track matches
+ */
+void OuterJoinTest(uint64_t key_num,
+                   const std::vector<uint64_t> &probe_key_list,
+                   int thread_num) {
+  using BaseTable = HashTable_OA_KVL<uint64_t,
+                                     uint64_t,
+                                     Hasher,
+                                     std::equal_to<uint64_t>,
+                                     LoadFactorPercent<75>>;
+  using MatchTable = HashTable_OA_KVL<uint64_t,
+                                      uint64_t,
+                                      Hasher,
+                                      std::equal_to<uint64_t>,
+                                      LoadFactorPercent<75>,
+                                      NoStats,
+                                      TrackMatches>;
+  
+  BaseTable base_map{};
+  MatchTable match_map{};
+  for(uint64_t i = 0;i < key_num;i++) {
+    base_map.Insert(i, i);
+    match_map.Insert(i, i);
+  }
+  
+  uint64_t probe_num = probe_key_list.size();
+  uint64_t chunk_size = (probe_num + thread_num - 1) / thread_num;
+  std::atomic<uint64_t> match_count{0};
+  
+  double base_time = RunThreads(thread_num, [&](int t) {
+    uint64_t local_count = 0;
+    uint64_t end = std::min(probe_num, (t + 1) * chunk_size);
+    for(uint64_t i = t * chunk_size;i < end;i++) {
+      local_count += base_map.GetValue(probe_key_list[i]).second;
+    }
     
-    dbg_printf("Key space = %lu\n", key_num);
+    match_count.fetch_add(local_count);
+  });
+  
+  double probe_time = RunThreads(thread_num, [&](int t) {
+    uint64_t local_count = 0;
+    uint64_t end = std::min(probe_num, (t + 1) * chunk_size);
+    for(uint64_t i = t * chunk_size;i < end;i++) {
+      local_count += match_map.GetValueAndMark(probe_key_list[i],
+                                               [](const uint64_t &) {
+                                                 return true;
+                                               });
+    }
     
+    match_count.fetch_add(local_count);
+  });
+  
+  uint64_t unmatched_count = 0;
+  double scan_time = RunThreads(1, [&](int) {
+    unmatched_count = \
+      match_map.ForEachUnmatched([](const uint64_t &, const uint64_t &) {});
+  });
+  
+  std::cout << "HashTable_OA_KVL outer join (" << thread_num << " threads): "
+            << (1.0 * probe_num) / (1024 * 1024) / base_time
+            << " million probe/sec without tracking; "
+            << (1.0 * probe_num) / (1024 * 1024) / probe_time
+            << " million probe/sec with marking; "
+            << scan_time * 1000 << " ms to scan "
+            << unmatched_count << " unmatched values" << "\n";
+  
+  return;
+}
+
+/*
+ * class PairHasher - Hashes std::pair by combining std::hash of both members
+ *
+ * This is the usual way of hashing a composite key using the standard
+ * library, and the baseline for CompactIntsKey
+ */
+class PairHasher {
+ public:
+  inline uint64_t operator()(const std::pair<uint64_t, uint64_t> &key) const {
+    uint64_t h = std::hash<uint64_t>{}(key.first);
+    h ^= std::hash<uint64_t>{}(key.second) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    
+    return SimpleInt64Hasher{}(h);
+  }
+};
+
+/*
+ * CompositeKeyTest() - Measures build and probe of two column keys
+ *
+ * MakeKey converts the two columns into the key type of the table
+ */
+template <typename TableType, typename MakeKey>
+void CompositeKeyTest(const char *name,
+                      const std::vector<uint64_t> &key_list,
+                      MakeKey make_key) {
+  std::chrono::time_point<std::chrono::system_clock> start, end;
+  
+  TableType ht{};
+  
+  start = std::chrono::system_clock::now();
+  
+  for(uint64_t key : key_list) {
+    ht.Insert(make_key(key, ~key), key);
+  }
+  
+  end = std::chrono::system_clock::now();
+  std::chrono::duration<double> build_time = end - start;
+  
+  start = std::chrono::system_clock::now();
+  
+  uint64_t match_count = 0;
+  for(uint64_t key : key_list) {
+    match_count += ht.GetValue(make_key(key, ~key)).second;
+  }
+  
+  end = std::chrono::system_clock::now();
+  std::chrono::duration<double> probe_time = end - start;
+  
+  std::cout << "HashTable_OA_KVL " << name << ": "
+            << (1.0 * key_list.size()) / (1024 * 1024) / build_time.count()
+            << " million insert/sec; "
+            << (1.0 * key_list.size()) / (1024 * 1024) / probe_time.count()
+            << " million lookup/sec (" << match_count << " matches)" << "\n";
+  
+  return;
+}
+
+/*
+ * GetURLKeyList() - Returns distinct URLs sharing a few hosts and path
+ *                   segments, such that keys have long common prefixes
+ */
+std::vector<std::string> GetURLKeyList(uint64_t key_num) {
+  static const char *word_list[] = {
+    "news", "shop", "blog", "search", "video", "images", "maps", "mail",
+    "docs", "sports", "weather", "finance", "travel", "music", "games", "wiki",
+  };
+  
+  std::default_random_engine e1(1);
+  std::uniform_int_distribution<uint64_t> word_dist(0, 15);
+  std::uniform_int_distribution<uint64_t> ref_dist(0, 999);
+  
+  std::vector<std::string> key_list{};
+  key_list.reserve(key_num);
+  for(uint64_t i = 0;i < key_num;i++) {
+    std::string url = "https://www.";
+    url += word_list[word_dist(e1)];
+    url += ".com/";
+    url += word_list[word_dist(e1)];
+    url += "/";
+    url += word_list[word_dist(e1)];
+    url += "/item-" + std::to_string(i);
+    url += "?ref=" + std::to_string(ref_dist(e1));
+    
+    key_list.push_back(url);
+  }
+  
+  return key_list;
+}
+
+/*
+ * GetShortCodeKeyList() - Returns distinct 8 character base62 codes
+ */
+std::vector<std::string> GetShortCodeKeyList(uint64_t key_num) {
+  static const char alphabet[] = \
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  
+  std::vector<std::string> key_list{};
+  key_list.reserve(key_num);
+  for(uint64_t i = 0;i < key_num;i++) {
+    // Scrambles i such that codes are not sequential
+    uint64_t x = SimpleInt64Hasher{}(i);
+    std::string code(8, '0');
+    for(int j = 0;j < 8;j++) {
+      code[j] = alphabet[x % 62];
+      x /= 62;
+    }
+    
+    key_list.push_back(code);
+  }
+  
+  // Codes are distinct with high probability but not guaranteed
+  std::sort(key_list.begin(), key_list.end());
+  key_list.erase(std::unique(key_list.begin(), key_list.end()),
+                 key_list.end());
+  std::shuffle(key_list.begin(), key_list.end(), std::mt19937_64{1});
+  
+  return key_list;
+}
+
+/*
+ * GetLongTailKeyList() - Returns distinct strings of random bytes whose
+ *                        lengths follow a log-normal distribution
+ *
+ * The median length is 16 and about 1% of keys are longer than 128 bytes,
+ * up to 4096 bytes
+ */
+std::vector<std::string> GetLongTailKeyList(uint64_t key_num) {
+  std::default_random_engine e1(1);
+  std::lognormal_distribution<double> length_dist(std::log(16.0), 0.9);
+  std::uniform_int_distribution<int> byte_dist(0, 255);
+  
+  std::vector<std::string> key_list{};
+  key_list.reserve(key_num);
+  for(uint64_t i = 0;i < key_num;i++) {
+    uint64_t length = static_cast<uint64_t>(length_dist(e1));
+    length = std::min<uint64_t>(length, 4096);
+    length = std::max<uint64_t>(length, sizeof(uint64_t));
+    
+    std::string s(length, '\0');
+    for(uint64_t j = 0;j < length - sizeof(uint64_t);j++) {
+      s[j] = static_cast<char>(byte_dist(e1));
+    }
+    
+    // The last 8 bytes make keys distinct
+    memcpy(&s[length - sizeof(uint64_t)], &i, sizeof(i));
+    
+    key_list.push_back(s);
+  }
+  
+  return key_list;
+}
+
+/*
+ * StringKeyTest() - Measures insert and lookup of string keys
+ *
+ * Keys are copied into an arena on insert, and looked up with keys
+ * referring to the original strings
+ */
+template <typename TableType>
+void StringKeyTest(const char *name,
+                   const char *dist_name,
+                   const std::vector<std::string> &key_list) {
+  std::chrono::time_point<std::chrono::system_clock> start, end;
+  
+  StringArena arena{};
+  TableType ht{};
+  
+  start = std::chrono::system_clock::now();
+  
+  for(uint64_t i = 0;i < key_list.size();i++) {
+    const std::string &s = key_list[i];
+    ht.Insert(StringKey::Get(arena.Copy(s.data(), s.size()), s.size()), i);
+  }
+  
+  end = std::chrono::system_clock::now();
+  std::chrono::duration<double> build_time = end - start;
+  
+  start = std::chrono::system_clock::now();
+  
+  uint64_t match_count = 0;
+  for(const std::string &s : key_list) {
+    match_count += (ht.GetFirstValue(StringKey::Get(s.data(), s.size())) != \
+                    nullptr);
+  }
+  
+  end = std::chrono::system_clock::now();
+  std::chrono::duration<double> probe_time = end - start;
+  
+  std::cout << name << " " << dist_name << ": "
+            << (1.0 * key_list.size()) / (1024 * 1024) / build_time.count()
+            << " million insert/sec; "
+            << (1.0 * key_list.size()) / (1024 * 1024) / probe_time.count()
+            << " million lookup/sec (" << match_count << " matches)" << "\n";
+  
+  return;
+}
+
+/*
+ * UnorderedMapStringKeyTest() - Measures insert and lookup of string keys
+ *                               in std::unordered_map<std::string>
+ */
+void UnorderedMapStringKeyTest(const char *dist_name,
+                               const std::vector<std::string> &key_list) {
+  std::chrono::time_point<std::chrono::system_clock> start, end;
+  
+  std::unordered_map<std::string, uint64_t> test_map{};
+  
+  start = std::chrono::system_clock::now();
+  
+  for(uint64_t i = 0;i < key_list.size();i++) {
+    test_map.insert({key_list[i], i});
+  }
+  
+  end = std::chrono::system_clock::now();
+  std::chrono::duration<double> build_time = end - start;
+  
+  start = std::chrono::system_clock::now();
+  
+  uint64_t match_count = 0;
+  for(const std::string &s : key_list) {
+    match_count += (test_map.find(s) != test_map.end());
+  }
+  
+  end = std::chrono::system_clock::now();
+  std::chrono::duration<double> probe_time = end - start;
+  
+  std::cout << "std::unordered_map " << dist_name << ": "
+            << (1.0 * key_list.size()) / (1024 * 1024) / build_time.count()
+            << " million insert/sec; "
+            << (1.0 * key_list.size()) / (1024 * 1024) / probe_time.count()
+            << " million lookup/sec (" << match_count << " matches)" << "\n";
+  
+  return;
+}
+
+/*
+ * class BranchMissCounter - Counts branch mispredictions of this thread in
+ *                           user space through perf_event_open()
+ *
+ * The counter is not available if the kernel or the container does not
+ * allow perf events, in which case Stop() returns 0
+ */
+class BranchMissCounter {
+ private:
+  int fd;
+  
+ public:
+  BranchMissCounter() {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    
+    fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    
+    return;
+  }
+  
+  ~BranchMissCounter() {
+    if(fd >= 0) {
+      close(fd);
+    }
+    
+    return;
+  }
+  
+  inline bool IsAvailable() const {
+    return fd >= 0;
+  }
+  
+  void Start() {
+    if(fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    
+    return;
+  }
+  
+  uint64_t Stop() {
+    uint64_t count = 0;
+    if(fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      if(read(fd, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+    
+    return count;
+  }
+};
+
+/*
+ * class GenericUInt64Equal - Compares integers like std::equal_to, but is a
+ *                            different type such that OA_KVL uses the
+ *                            general probe loop as the baseline
+ */
+class GenericUInt64Equal {
+ public:
+  inline bool operator()(uint64_t a, uint64_t b) const {
+    return a == b;
+  }
+};
+
+/*
+ * ProbeLoopTest() - Measures lookups and branch misses of a table
+ *
+ * Half of probe keys are not in the table
+ */
+template <typename TableType>
+void ProbeLoopTest(const char *name,
+                   uint64_t key_num,
+                   const std::vector<uint64_t> &probe_key_list) {
+  TableType ht{};
+  for(uint64_t i = 0;i < key_num;i++) {
+    ht.Insert(i, i);
+  }
+  
+  BranchMissCounter counter{};
+  
+  std::chrono::time_point<std::chrono::system_clock> start, end;
+  start = std::chrono::system_clock::now();
+  counter.Start();
+  
+  uint64_t match_count = 0;
+  for(uint64_t key : probe_key_list) {
+    match_count += (ht.GetFirstValue(key) != nullptr);
+  }
+  
+  uint64_t miss_count = counter.Stop();
+  end = std::chrono::system_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  
+  std::cout << "HashTable_OA_KVL " << name << " (" << key_num << " keys): "
+            << (1.0 * probe_key_list.size()) / (1024 * 1024) / \
+               elapsed_seconds.count()
+            << " million lookup/sec; ";
+  
+  if(counter.IsAvailable() == true) {
+    std::cout << (1.0 * miss_count) / probe_key_list.size()
+              << " branch misses/lookup";
+  } else {
+    std::cout << "branch misses not available";
+  }
+  
+  std::cout << " (" << match_count << " matches)" << "\n";
+  
+  return;
+}
+
+/*
+ * DecodeTest() - Measures decoding packed tuple locations with
+ *                DecodeTuplePointers() against a word by word loop
+ *
+ * Values are decoded in runs of the given length, which is the number of
+ * values of a key in a key value list, and the array is decoded repeat times
+ */
+void DecodeTest(uint64_t value_num, uint64_t run_length, uint64_t repeat) {
+  std::vector<TuplePointer48> src{};
+  src.reserve(value_num);
+  for(uint64_t i = 0;i < value_num;i++) {
+    src.push_back(TuplePointer48::Get(static_cast<uint32_t>(i * 7),
+                                      static_cast<uint16_t>(i)));
+  }
+  
+  std::vector<uint64_t> dst(value_num);
+  uint64_t sum = 0;
+  
+  std::chrono::time_point<std::chrono::system_clock> start, end;
+  start = std::chrono::system_clock::now();
+  
+  for(uint64_t k = 0;k < repeat;k++) {
+    for(uint64_t i = 0;i < value_num;i += run_length) {
+      uint64_t count = std::min(run_length, value_num - i);
+      for(uint64_t j = 0;j < count;j++) {
+        dst[i + j] = src[i + j].ToUInt64();
+      }
+    }
+    sum += dst[value_num - 1 - k % value_num];
+  }
+  
+  end = std::chrono::system_clock::now();
+  std::chrono::duration<double> loop_seconds = end - start;
+  
+  start = std::chrono::system_clock::now();
+  
+  for(uint64_t k = 0;k < repeat;k++) {
+    for(uint64_t i = 0;i < value_num;i += run_length) {
+      DecodeTuplePointers(src.data() + i,
+                          std::min(run_length, value_num - i),
+                          dst.data() + i);
+    }
+    sum += dst[value_num - 1 - k % value_num];
+  }
+  
+  end = std::chrono::system_clock::now();
+  std::chrono::duration<double> decode_seconds = end - start;
+  
+  std::cout << "Run length " << run_length << ": word by word "
+            << 1.0 * value_num * repeat / (1024 * 1024) / loop_seconds.count()
+            << " million values/sec; DecodeTuplePointers() "
+            << 1.0 * value_num * repeat / (1024 * 1024) / decode_seconds.count()
+            << " million values/sec (checksum " << sum << ")" << "\n";
+  
+  return;
+}
+
+/*
+ * main() - Main test routine
+ *
+ * |-------------------------------|--------------------------------|
+ * |            Command            |          Explanation           |
+ * |-------------------------------|--------------------------------|
+ * | ./benchmark                   | Prints help message            |
+ * | ./benchmark --seq             | Runs sequential test           |
+ * | ./benchmark --random          | Runs random workload test      |
+ * | ./benchmark --interleaved     | Runs interleaved lookup test   |
+ * | ./benchmark --concurrent      | Runs multi-threaded test       |
+ * | ./benchmark --parallel-build  | Runs parallel build test       |
+ * | ./benchmark --self-organizing | Runs chain reorder test        |
+ * | ./benchmark --compact         | Runs chain compaction test     |
+ * | ./benchmark --aggregation     | Runs spilling aggregation test |
+ * | ./benchmark --hash-join       | Runs hybrid hash join test     |
+ * | ./benchmark --hash-join <MB>  | Runs it with one memory limit  |
+ * | ./benchmark --outer-join      | Runs outer join match test     |
+ * | ./benchmark --compact-key     | Runs composite key test        |
+ * | ./benchmark --string-key      | Runs string key test           |
+ * | ./benchmark --probe-loop      | Runs branch free probe test    |
+ * | ./benchmark --decode          | Runs packed value decode test  |
+ * |-------------------------------|--------------------------------|
+ */
+int main(int argc, char **argv) {
+  // Make sure we have correct number of arguments
+  if(argc == 1) {
+    printf("Please use command line argument to run test suites!\n");
+    
+    return 0;
+  }
+  
+  char *p = argv[1];
+  
+  // Only the hash join test takes a memory limit
+  if((argc > 3) || ((argc == 3) && (strcmp(p, "--hash-join") != 0))) {
+    printf("Too many arguments\n");
+    
+    return 0;
+  }
+  
+  if(strcmp(p, "--seq") == 0) {
+    uint64_t key_num = 6 * 1024 * 1024;
+    auto f = [](uint64_t i) { return i; };
+
+    dbg_printf("Key space = %lu\n", key_num);
+
     OA_KVL_InsertTest(key_num, f);
     UnorderedMultimapInsertTest(key_num, f);
     CA_CC_InsertTest(key_num, f);
     CA_SCC_InsertTest(key_num, f);
+  } else if(strcmp(p, "--random") == 0) {
+    uint64_t key_num = 6 * 1024 * 1024;
+
+    std::random_device r{};
+    std::default_random_engine e1(r());
+    std::uniform_int_distribution<int> uniform_dist(0, key_num - 1);
+    auto f = [&uniform_dist, &e1](uint64_t i) { return uniform_dist(e1); };
+    
+    dbg_printf("Key space = %lu\n", key_num);
     
+    OA_KVL_InsertTest(key_num, f);
+    UnorderedMultimapInsertTest(key_num, f);
+    CA_CC_InsertTest(key_num, f);
+    CA_SCC_InsertTest(key_num, f);
+    
+  } else if(strcmp(p, "--interleaved") == 0) {
+    uint64_t key_num = 6 * 1024 * 1024;
+
+    // Random probe keys are all in the table, such that every lookup
+    // is likely a cache miss
+    std::random_device r{};
+    std::default_random_engine e1(r());
+    std::uniform_int_distribution<uint64_t> uniform_dist(0, key_num - 1);
+    
+    std::vector<uint64_t> probe_key_list{};
+    probe_key_list.reserve(key_num);
+    for(uint64_t i = 0;i < key_num;i++) {
+      probe_key_list.push_back(uniform_dist(e1));
+    }
+    
+    dbg_printf("Key space = %lu\n", key_num);
+    
+    OA_KVL_InterleavedTest<4>(key_num, probe_key_list);
+    OA_KVL_InterleavedTest<8>(key_num, probe_key_list);
+    OA_KVL_InterleavedTest<16>(key_num, probe_key_list);
+    CA_SCC_InterleavedTest<4>(key_num, probe_key_list);
+    CA_SCC_InterleavedTest<8>(key_num, probe_key_list);
+    CA_SCC_InterleavedTest<16>(key_num, probe_key_list);
+  } else if(strcmp(p, "--concurrent") == 0) {
+    uint64_t key_num = 4 * 1024 * 1024;
+    
+    dbg_printf("Key space = %lu\n", key_num);
+    
+    for(int thread_num = 1;thread_num <= 8;thread_num <<= 1) {
+      CA_SCC_ConcurrentTest(key_num, thread_num);
+      CA_SCC_MutexTest(key_num, thread_num);
+    }
+  } else if(strcmp(p, "--parallel-build") == 0) {
+    uint64_t key_num = 4 * 1024 * 1024;
+    
+    dbg_printf("Key space = %lu\n", key_num);
+    
+    for(int thread_num = 1;thread_num <= 8;thread_num <<= 1) {
+      ParallelBuildTest<HashTable_OA_KVL<uint64_t,
+                                         ValueType,
+                                         Hasher,
+                                         std::equal_to<uint64_t>,
+                                         LoadFactorPercent<75>>>(
+        "HashTable_OA_KVL", key_num, thread_num);
+      ParallelBuildTest<HashTable_CA_SCC<uint64_t,
+                                         ValueType,
+                                         Hasher,
+                                         std::equal_to<uint64_t>,
+                                         LoadFactorPercent<400>>>(
+        "HashTable_CA_SCC", key_num, thread_num);
+    }
+  } else if(strcmp(p, "--self-organizing") == 0) {
+    uint64_t key_num = 4 * 1024 * 1024;
+    
+    std::vector<uint64_t> probe_key_list = \
+      GetZipfianKeyList(key_num, key_num, 0.99);
+    
+    dbg_printf("Key space = %lu\n", key_num);
+    
+    CA_SCC_SelfOrganizingTest<NoChainReorder>(
+      "no reorder", key_num, probe_key_list);
+    CA_SCC_SelfOrganizingTest<MoveToFrontAlways>(
+      "move to front", key_num, probe_key_list);
+    CA_SCC_SelfOrganizingTest<MoveToFrontEveryN<8>>(
+      "move to front every 8", key_num, probe_key_list);
+    CA_SCC_SelfOrganizingTest<MoveToFrontRandom<8>>(
+      "move to front with p = 1/8", key_num, probe_key_list);
+  } else if(strcmp(p, "--compact") == 0) {
+    uint64_t key_num = 4 * 1024 * 1024;
+    
+    dbg_printf("Key space = %lu\n", key_num);
+    
+    CA_SCC_CompactTest(key_num);
+  } else if(strcmp(p, "--aggregation") == 0) {
+    uint64_t key_num = 16 * 1024 * 1024;
+    uint64_t group_num = 4 * 1024 * 1024;
+
+    std::random_device r{};
+    std::default_random_engine e1(r());
+    std::uniform_int_distribution<uint64_t> uniform_dist(0, group_num - 1);
+
+    std::vector<uint64_t> key_list{};
+    key_list.reserve(key_num);
+    for(uint64_t i = 0;i < key_num;i++) {
+      key_list.push_back(uniform_dist(e1));
+    }
+
+    dbg_printf("Row count = %lu; Group count = %lu\n", key_num, group_num);
+
+    // The in-memory path does not spill
+    HashAggregationTest(key_list, group_num, UINT64_MAX);
+
+    for(uint64_t budget_mb : {256UL, 64UL, 16UL, 4UL}) {
+      HashAggregationTest(key_list, group_num, budget_mb * 1024 * 1024);
+    }
+  } else if(strcmp(p, "--hash-join") == 0) {
+    uint64_t key_num = 4 * 1024 * 1024;
+    uint64_t probe_num = 16 * 1024 * 1024;
+    
+    std::vector<uint64_t> build_key_list(key_num);
+    for(uint64_t i = 0;i < key_num;i++) {
+      build_key_list[i] = i;
+    }
+    
+    std::random_device r{};
+    std::default_random_engine e1(r());
+    std::shuffle(build_key_list.begin(), build_key_list.end(), e1);
+    
+    std::uniform_int_distribution<uint64_t> uniform_dist(0, key_num - 1);
+    std::vector<uint64_t> probe_key_list{};
+    probe_key_list.reserve(probe_num);
+    for(uint64_t i = 0;i < probe_num;i++) {
+      probe_key_list.push_back(uniform_dist(e1));
+    }
+    
+    // Budgets in MB; The first one is the in-memory path
+    std::vector<uint64_t> budget_list{UINT64_MAX, 64, 16, 4};
+    if(argc == 3) {
+      budget_list = {UINT64_MAX, strtoull(argv[2], nullptr, 10)};
+    }
+    
+    dbg_printf("Build rows = %lu; Probe rows = %lu\n", key_num, probe_num);
+    
+    for(uint64_t budget_mb : budget_list) {
+      uint64_t budget = budget_mb;
+      if(budget_mb != UINT64_MAX) {
+        budget = budget_mb * 1024 * 1024;
+      }
+      
+      HybridHashJoinTest<HashTable_OA_KVL<uint64_t,
+                                          uint64_t,
+                                          Hasher,
+                                          std::equal_to<uint64_t>,
+                                          LoadFactorPercent<75>>>(
+        "HybridHashJoin with HashTable_OA_KVL",
+        build_key_list,
+        probe_key_list,
+        budget);
+      HybridHashJoinTest<HashTable_CA_SCC<uint64_t,
+                                          uint64_t,
+                                          Hasher,
+                                          std::equal_to<uint64_t>,
+                                          LoadFactorPercent<400>>>(
+        "HybridHashJoin with HashTable_CA_SCC",
+        build_key_list,
+        probe_key_list,
+        budget);
+    }
+  } else if(strcmp(p, "--outer-join") == 0) {
+    uint64_t key_num = 4 * 1024 * 1024;
+    uint64_t probe_num = 16 * 1024 * 1024;
+    
+    std::random_device r{};
+    std::default_random_engine e1(r());
+    std::uniform_int_distribution<uint64_t> uniform_dist(0, 2 * key_num - 1);
+    
+    std::vector<uint64_t> probe_key_list{};
+    probe_key_list.reserve(probe_num);
+    for(uint64_t i = 0;i < probe_num;i++) {
+      probe_key_list.push_back(uniform_dist(e1));
+    }
+    
+    dbg_printf("Build rows = %lu; Probe rows = %lu\n", key_num, probe_num);
+    
+    for(int thread_num = 1;thread_num <= 8;thread_num <<= 1) {
+      OuterJoinTest(key_num, probe_key_list, thread_num);
+    }
+  } else if(strcmp(p, "--compact-key") == 0) {
+    uint64_t key_num = 4 * 1024 * 1024;
+    
+    std::vector<uint64_t> key_list{};
+    key_list.reserve(key_num);
+    for(uint64_t i = 0;i < key_num;i++) {
+      key_list.push_back(i);
+    }
+    
+    std::random_device r{};
+    std::shuffle(key_list.begin(), key_list.end(), std::mt19937_64{r()});
+    
+    using PairKey = std::pair<uint64_t, uint64_t>;
+    CompositeKeyTest<HashTable_OA_KVL<PairKey, uint64_t, PairHasher>>(
+      "std::pair", key_list, [](uint64_t a, uint64_t b) {
+        return PairKey{a, b};
+      });
+    
+    using CompactKey = CompactIntsKey<2>;
+    CompositeKeyTest<HashTable_OA_KVL<CompactKey,
+                                      uint64_t,
+                                      CompactIntsKeyHasher<2>>>(
+      "CompactIntsKey<2>", key_list, [](uint64_t a, uint64_t b) {
+        return CompactKey{{a, b}};
+      });
+  } else if(strcmp(p, "--string-key") == 0) {
+    uint64_t key_num = 1024 * 1024;
+    
+    using OA_KVL_StringTable = HashTable_OA_KVL<StringKey,
+                                                uint64_t,
+                                                StringKeyHasher,
+                                                StringKeyEqualityChecker>;
+    using CA_SCC_StringTable = HashTable_CA_SCC<StringKey,
+                                                uint64_t,
+                                                StringKeyHasher,
+                                                StringKeyEqualityChecker>;
+    
+    std::vector<std::pair<const char *, std::vector<std::string>>> dist_list{};
+    dist_list.push_back({"URL", GetURLKeyList(key_num)});
+    dist_list.push_back({"short code", GetShortCodeKeyList(key_num)});
+    dist_list.push_back({"long tail", GetLongTailKeyList(key_num)});
+    
+    for(const auto &dist : dist_list) {
+      uint64_t total_length = 0;
+      for(const std::string &s : dist.second) {
+        total_length += s.size();
+      }
+      
+      dbg_printf("%s: %lu keys; average length %f\n",
+                 dist.first,
+                 dist.second.size(),
+                 (1.0 * total_length) / dist.second.size());
+      
+      StringKeyTest<OA_KVL_StringTable>(
+        "HashTable_OA_KVL", dist.first, dist.second);
+      StringKeyTest<CA_SCC_StringTable>(
+        "HashTable_CA_SCC", dist.first, dist.second);
+      UnorderedMapStringKeyTest(dist.first, dist.second);
+    }
+  } else if(strcmp(p, "--probe-loop") == 0) {
+    uint64_t probe_num = 16 * 1024 * 1024;
+    
+    using BranchFreeTable = HashTable_OA_KVL<uint64_t,
+                                             uint64_t,
+                                             Hasher,
+                                             std::equal_to<uint64_t>,
+                                             LoadFactorPercent<75>>;
+    using GenericTable = HashTable_OA_KVL<uint64_t,
+                                          uint64_t,
+                                          Hasher,
+                                          GenericUInt64Equal,
+                                          LoadFactorPercent<75>>;
+    
+    // A table that fits in cache where branches dominate, and one that
+    // does not where cache misses dominate
+    for(uint64_t key_num : {64 * 1024UL, 4 * 1024 * 1024UL}) {
+      std::default_random_engine e1(1);
+      std::uniform_int_distribution<uint64_t> uniform_dist(0, 2 * key_num - 1);
+      
+      std::vector<uint64_t> probe_key_list{};
+      probe_key_list.reserve(probe_num);
+      for(uint64_t i = 0;i < probe_num;i++) {
+        probe_key_list.push_back(uniform_dist(e1));
+      }
+      
+      ProbeLoopTest<GenericTable>("general probe", key_num, probe_key_list);
+      ProbeLoopTest<BranchFreeTable>(
+        "branch free probe", key_num, probe_key_list);
+    }
+  } else if(strcmp(p, "--decode") == 0) {
+    // One run that stays in cache, and short runs of a large array
+    DecodeTest(4 * 1024, 4 * 1024, 4 * 1024);
+    for(uint64_t run_length : {4UL, 16UL, 64UL}) {
+      DecodeTest(16 * 1024 * 1024, run_length, 1);
+    }
   } else {
     printf("Unknown argument: %s\n", p);
   }